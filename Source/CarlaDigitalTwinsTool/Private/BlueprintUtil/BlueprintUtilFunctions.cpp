@@ -13,11 +13,19 @@
 #include "IAssetTools.h"
 #include "ObjectTools.h"
 #include "UObject/UObjectGlobals.h"
+#include "UObject/ObjectKey.h"
 #include "EditorAssetLibrary.h"
 #include "FileHelpers.h"
 
 DEFINE_LOG_CATEGORY(LogDigitalTwinsToolBlueprintUtil);
 
+#if WITH_EDITOR
+// Assets CopyAssetToPlugin returned, by source asset and plugin, so each one
+// goes through the asset registry or gets duplicated once per session. The
+// asset tools only run on the game thread, so no lock is needed
+static TMap<TPair<FObjectKey, FString>, TWeakObjectPtr<UObject>> CopiedAssets;
+#endif
+
 FString UBlueprintUtilFunctions::GetProjectName()
 {
   const UGeneralProjectSettings* ProjectSettings = GetDefault<UGeneralProjectSettings>();
@@ -31,6 +39,17 @@ UObject* UBlueprintUtilFunctions::CopyAssetToPlugin(UObject* SourceObject, FStri
     return nullptr;
   }
 
+  const TPair<FObjectKey, FString> CacheKey(FObjectKey(SourceObject), PluginName);
+  if (const TWeakObjectPtr<UObject>* CopiedAsset = CopiedAssets.Find(CacheKey))
+  {
+    // Stale if the copy was deleted or collected since
+    if (UObject* Asset = CopiedAsset->Get())
+    {
+      return Asset;
+    }
+    CopiedAssets.Remove(CacheKey);
+  }
+
   FString SourcePath = SourceObject->GetPathName();
   FString SourceAssetName = SourceObject->GetName();
 
@@ -48,6 +67,7 @@ UObject* UBlueprintUtilFunctions::CopyAssetToPlugin(UObject* SourceObject, FStri
     UObject* ExistingAsset = UEditorAssetLibrary::LoadAsset(TargetAssetPath);
     if (ExistingAsset)
     {
+      CopiedAssets.Add(CacheKey, ExistingAsset);
       return ExistingAsset;
     }
   }
@@ -139,9 +159,17 @@ UObject* UBlueprintUtilFunctions::CopyAssetToPlugin(UObject* SourceObject, FStri
 
   UEditorLoadingAndSavingUtils::SaveDirtyPackages(true, true);
 
+  CopiedAssets.Add(CacheKey, DuplicatedAsset);
   return DuplicatedAsset;
 
 #else
   return nullptr;
 #endif
 }
+
+void UBlueprintUtilFunctions::ClearCopiedAssets()
+{
+#if WITH_EDITOR
+  CopiedAssets.Empty();
+#endif
+}
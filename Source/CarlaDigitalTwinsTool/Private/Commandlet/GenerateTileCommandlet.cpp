@@ -86,8 +86,23 @@ int32 UGenerateTileCommandlet::Main(const FString &Params)
   OpenDriveMap->BaseLevelName = ParamsMap["BaseLevelName"];
   OpenDriveMap->OriginGeoCoordinates = FVector2D(FCString::Atof(*ParamsMap["GeoCoordsX"]),FCString::Atof(*ParamsMap["GeoCoordsY"]));
   OpenDriveMap->CurrentTilesInXY = FIntVector(FCString::Atof(*ParamsMap["CTileX"]),FCString::Atof(*ParamsMap["CTileY"]), 0);
+  // -PipelineTiles generates the geometry of the next PipelineDepth tiles
+  // while the current one is built, only useful together with -AllTiles
+  OpenDriveMap->bPipelineTiles = Switches.Contains(TEXT("PipelineTiles"));
+  if( ParamsMap.Contains(TEXT("PipelineDepth")) )
+  {
+    OpenDriveMap->PipelineTileQueueDepth = FMath::Max(FCString::Atoi(*ParamsMap["PipelineDepth"]), 1);
+  }
   // Parse Params
-  OpenDriveMap->GenerateTile();
+  if( Switches.Contains(TEXT("AllTiles")) )
+  {
+    // From CTileX, CTileY to the last tile of the map
+    OpenDriveMap->GenerateAllTiles();
+  }
+  else
+  {
+    OpenDriveMap->GenerateTile();
+  }
 
   return 0;
 }
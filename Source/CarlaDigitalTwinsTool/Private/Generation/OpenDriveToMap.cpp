@@ -9,11 +9,13 @@
 #include "DesktopPlatformModule.h"
 #endif
 #include "Misc/FileHelper.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
 #include "Engine/LevelBounds.h"
 #include "Engine/SceneCapture2D.h"
 #include "Runtime/Core/Public/Async/ParallelFor.h"
 #include "Kismet/KismetRenderingLibrary.h"
-#include "KismetProceduralMeshLibrary.h"
 #include "StaticMeshAttributes.h"
 #include "FileHelpers.h"
 #include "Online/CustomFileDownloader.h"
@@ -52,11 +54,13 @@
 #include "CarlaDigitalTwinsTool.h"
 #include "Kismet/GameplayStatics.h"
 #include "Generation/MapGenFunctionLibrary.h"
+#include "Generation/TerrainHeightField.h"
 #include "Carla/Geom/Simplification.h"
 #include "Carla/Geom/Deformation.h"
 #include "Generation/MapGenFunctionLibrary.h"
 #include "BlueprintUtil/BlueprintUtilFunctions.h"
 #include "Carla/OpenDrive/OpenDriveParser.h"
+#include "Carla/Road/MapCache.h"
 #include "Carla/RPC/String.h"
 #include "Carla/Road/element/RoadInfoSignal.h"
 #include "DrawDebugHelpers.h"
@@ -76,6 +80,46 @@ struct FTerrainMeshData
   TArray<FProcMeshTangent> Tangents;
 };
 
+// Normals and tangents of a regular grid of vertices from the central
+// differences of its heights, StrideX and StrideY being the distance between
+// two neighbour vertices along X and Y in the array. Replaces the tangent
+// pass of the procedural mesh library, which welds every vertex through a
+// hash map, for the terrain tiles
+static void ComputeGridNormalsAndTangents(
+    const TArray<FVector>& Vertices,
+    int32 VertsX,
+    int32 VertsY,
+    int32 StrideX,
+    int32 StrideY,
+    TArray<FVector>& Normals,
+    TArray<FProcMeshTangent>& Tangents)
+{
+  Normals.SetNumUninitialized(Vertices.Num());
+  Tangents.SetNumUninitialized(Vertices.Num());
+  for (int32 iy = 0; iy < VertsY; ++iy)
+  {
+    for (int32 ix = 0; ix < VertsX; ++ix)
+    {
+      const int32 Index = ix * StrideX + iy * StrideY;
+      const FVector& PreviousX = Vertices[FMath::Max(ix - 1, 0) * StrideX + iy * StrideY];
+      const FVector& NextX = Vertices[FMath::Min(ix + 1, VertsX - 1) * StrideX + iy * StrideY];
+      const FVector& PreviousY = Vertices[ix * StrideX + FMath::Max(iy - 1, 0) * StrideY];
+      const FVector& NextY = Vertices[ix * StrideX + FMath::Min(iy + 1, VertsY - 1) * StrideY];
+      const FVector AlongX = NextX - PreviousX;
+      const FVector AlongY = NextY - PreviousY;
+
+      FVector Normal = FVector::CrossProduct(AlongX, AlongY).GetSafeNormal(SMALL_NUMBER, FVector::UpVector);
+      if (Normal.Z < 0)
+      {
+        Normal = -Normal;
+      }
+      const FVector Tangent = (AlongX - Normal * FVector::DotProduct(AlongX, Normal)).GetSafeNormal(SMALL_NUMBER, FVector::ForwardVector);
+      Normals[Index] = Normal;
+      Tangents[Index] = FProcMeshTangent(Tangent, false);
+    }
+  }
+}
+
 UOpenDriveToMap::UOpenDriveToMap()
 {
   AddToRoot();
@@ -246,18 +290,26 @@ void UOpenDriveToMap::CreateTerrain(const int NumberOfTerrainX, const int Number
       TArray<FVector>& Normals = MeshData.Normals;
       TArray<FProcMeshTangent>& Tangents = MeshData.Tangents;
 
-      Vertices.Reserve(VertsX * VertsY);
+      Vertices.SetNum(VertsX * VertsY);
       UVs.Reserve(VertsX * VertsY);
       Triangles.Reserve((VertsX - 1) * (VertsY - 1) * 6);
 
+      // Line traces have to run on the game thread, the height field can be
+      // sampled from any thread
+      ParallelFor(VertsX * VertsY, [&](int32 VertexIndex)
+      {
+        const int32 ix = VertexIndex % VertsX;
+        const int32 iy = VertexIndex / VertsX;
+        float X = ix * StepX;
+        float Y = iy * StepY;
+        float Height = GetHeightForLandscape(FVector(Offset.X + X, Offset.Y + Y, 0));
+        Vertices[VertexIndex] = FVector(X, Y, Height);
+      }, !TerrainHeightField.IsValid());
+
       for (int32 iy = 0; iy < VertsY; ++iy)
       {
         for (int32 ix = 0; ix < VertsX; ++ix)
         {
-          float X = ix * StepX;
-          float Y = iy * StepY;
-          float Height = GetHeightForLandscape(FVector(Offset.X + X, Offset.Y + Y, 0));
-          Vertices.Add(FVector(X, Y, Height));
           UVs.Add(FVector2D(static_cast<float>(ix) / MeshGridResolution, static_cast<float>(iy) / MeshGridResolution));
         }
       }
@@ -280,26 +332,37 @@ void UOpenDriveToMap::CreateTerrain(const int NumberOfTerrainX, const int Number
           Triangles.Add(i2);
         }
       }
+
+      ComputeGridNormalsAndTangents(Vertices, VertsX, VertsY, 1, VertsX, Normals, Tangents);
     }
   }
 
+  TArray<FMapGenMeshRequest> MeshRequests;
+  MeshRequests.Reserve(AllMeshData.Num());
+  UMaterialInstance* DuplicatedLandscapeMaterial = Cast<UMaterialInstance>(UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultLandscapeMaterial, MapName));
   for (const FTerrainMeshData& MeshData : AllMeshData)
   {
-    TArray<FVector> Normals;
-    TArray<FProcMeshTangent> Tangents;
+    // Trees are snapped onto the terrain too
+    TerrainHeightField.AddMesh(MeshData.Vertices, MeshData.Triangles, FVector(MeshData.Offset.X, MeshData.Offset.Y, 0));
 
-    UKismetProceduralMeshLibrary::CalculateTangentsForMesh(MeshData.Vertices, MeshData.Triangles, MeshData.UVs, Normals, Tangents);
+    FMapGenMeshRequest& Request = MeshRequests.AddDefaulted_GetRef();
+    Request.Data.Normals = MeshData.Normals;
+    Request.Tangents = MeshData.Tangents;
 
-    FProceduralCustomMesh ProcMeshData;
-    ProcMeshData.Vertices = MeshData.Vertices;
-    ProcMeshData.Triangles = MeshData.Triangles;
-    ProcMeshData.Normals = Normals;
-    ProcMeshData.UV0 = MeshData.UVs;
+    Request.Data.Vertices = MeshData.Vertices;
+    Request.Data.Triangles = MeshData.Triangles;
+    Request.Data.UV0 = MeshData.UVs;
 
-    UObject* DuplicatedMaterialObject = UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultLandscapeMaterial, MapName);
-    UMaterialInstance* DuplicatedLandscapeMaterial = Cast<UMaterialInstance>(DuplicatedMaterialObject);
+    Request.MaterialInstance = DuplicatedLandscapeMaterial;
+    Request.FolderName = "Terrain";
+    Request.MeshName = FName(*FString::Printf(TEXT("SM_LandscapeMesh_%d%s"), MeshData.MeshIndex, *GetStringForCurrentTile()));
+  }
 
-    UStaticMesh* StaticMesh = UMapGenFunctionLibrary::CreateMesh(ProcMeshData, Tangents, DuplicatedLandscapeMaterial, MapName, "Terrain", FName(*FString::Printf(TEXT("SM_LandscapeMesh_%d%s"), MeshData.MeshIndex, *GetStringForCurrentTile())));
+  const TArray<UStaticMesh*> StaticMeshes = UMapGenFunctionLibrary::CreateMeshes(MeshRequests, MapName);
+  for (int32 MeshIndex = 0; MeshIndex < AllMeshData.Num(); ++MeshIndex)
+  {
+    const FTerrainMeshData& MeshData = AllMeshData[MeshIndex];
+    UStaticMesh* StaticMesh = StaticMeshes[MeshIndex];
 
     if (!StaticMesh) continue;
 
@@ -394,13 +457,8 @@ void UOpenDriveToMap::CreateTerrainMesh(const int MeshIndex, const FVector2D Off
     }
   }
 
-  UKismetProceduralMeshLibrary::CalculateTangentsForMesh(
-    Vertices,
-    Triangles,
-    UVs,
-    Normals,
-    Tangents
-  );
+  // Vertices are added along Y first
+  ComputeGridNormalsAndTangents(Vertices, VerticesInLineX, VerticesInLineY, VerticesInLineY, 1, Normals, Tangents);
 
   FProceduralCustomMesh MeshData;
   MeshData.Vertices = Vertices;
@@ -449,8 +507,10 @@ void UOpenDriveToMap::GenerateTileStandalone(){
 #else
   GenerateTile();
 #endif
+  const double SaveStart = FPlatformTime::Seconds();
   UEditorLoadingAndSavingUtils::SaveDirtyPackages(true, true);
   UEditorLevelLibrary::SaveCurrentLevel();
+  TileSaveSeconds += FPlatformTime::Seconds() - SaveStart;
 }
 
 void UOpenDriveToMap::GenerateTile(){
@@ -460,13 +520,8 @@ void UOpenDriveToMap::GenerateTile(){
     return;
   }
 
-  FString FileContent;
-  FFileHelper::LoadFileToString(FileContent, *FilePath);
-  std::string opendrive_xml = carla::rpc::FromLongFString(FileContent);
   UE_LOG(LogCarlaDigitalTwinsTool, Warning, TEXT("UOpenDriveToMap::GenerateTile() Loading File..... "));
-  CarlaMap = carla::opendrive::OpenDriveParser::Load(opendrive_xml);
-
-  if (!CarlaMap.has_value())
+  if (!LoadCarlaMap())
   {
     UE_LOG(LogCarlaDigitalTwinsTool, Error, TEXT("Invalid Map"));
   }
@@ -476,6 +531,7 @@ void UOpenDriveToMap::GenerateTile(){
     MapName = FPaths::GetCleanFilename(FilePath);
     MapName.RemoveFromEnd(".xodr", ESearchCase::Type::IgnoreCase);
     UE_LOG(LogCarlaDigitalTwinsTool, Warning, TEXT("MapName %s"), *MapName);
+    DuplicateDefaultMaterials();
 
 #if ENGINE_MAJOR_VERSION < 5
     UEditorLevelLibrary::LoadLevel(*BaseLevelName);
@@ -500,16 +556,17 @@ void UOpenDriveToMap::GenerateTile(){
 
       UEditorLevelLibrary::LoadLevel(CarlaTile.Name);
 #endif
-      MinPosition = FVector(CurrentTilesInXY.X * TileSize, CurrentTilesInXY.Y * -TileSize, 0.0f);
-      MaxPosition = FVector((CurrentTilesInXY.X + 1.0f ) * TileSize, (CurrentTilesInXY.Y + 1.0f) * -TileSize, 0.0f);
-      
+      GetTileBounds(CurrentTilesInXY, MinPosition, MaxPosition);
+
       WorldOriginPosition = FVector(0,0,0);
       WorldEndPosition = FVector(UMapGenFunctionLibrary::GetTransversemercProjection(
         FinalGeoCoordinates.X, FinalGeoCoordinates.Y, 
         OriginGeoCoordinates.X, OriginGeoCoordinates.Y), 0);
 
-      GenerateAll(CarlaMap, MinPosition, MaxPosition);
-      
+      const TSharedPtr<FTileGeometry> Geometry = TakeCurrentTileGeometry();
+      const double AssetStart = FPlatformTime::Seconds();
+      GenerateAll(CarlaMap, MinPosition, MaxPosition, *Geometry);
+      TileAssetSeconds += FPlatformTime::Seconds() - AssetStart;
 
       bHasStarted = true;
       bRoadsFinished = true;
@@ -520,29 +577,146 @@ void UOpenDriveToMap::GenerateTile(){
       UE_LOG(LogCarlaDigitalTwinsTool, Error, TEXT("Largemapmanager not found ") );
     }
 #endif
+    const double SaveStart = FPlatformTime::Seconds();
     UEditorLoadingAndSavingUtils::SaveDirtyPackages(true, true);
     UEditorLevelLibrary::SaveCurrentLevel();
+    TileSaveSeconds += FPlatformTime::Seconds() - SaveStart;
 
 #if ENGINE_MAJOR_VERSION < 5
 #if PLATFORM_LINUX
-    RemoveFromRoot();
+    if( !bGeneratingAllTiles ){
+      RemoveFromRoot();
+    }
 #endif
 #endif
   }
 }
 
+bool UOpenDriveToMap::InitTileGrid(){
+  if( TileSize > 0.0f && NumTilesInXY.X > 0 && NumTilesInXY.Y > 0 ){
+    return true;
+  }
+
+#if ENGINE_MAJOR_VERSION < 5
+  UEditorLevelLibrary::LoadLevel(*BaseLevelName);
+#endif
+  AActor* QueryActor = UGameplayStatics::GetActorOfClass(
+                          GetEditorWorld(),
+                          ALargeMapManager::StaticClass() );
+  if( QueryActor != nullptr ){
+    ALargeMapManager* LmManager = Cast<ALargeMapManager>(QueryActor);
+    LmManager->GenerateMap_Editor();
+    NumTilesInXY  = LmManager->GetNumTilesInXY();
+    TileSize = LmManager->GetTileSize();
+    Tile0Offset = LmManager->GetTile0Offset();
+  }else{
+#if ENGINE_MAJOR_VERSION < 5
+    UE_LOG(LogCarlaDigitalTwinsTool, Error, TEXT("UOpenDriveToMap::InitTileGrid(): Largemapmanager not found") );
+    return false;
+#else
+    if( !LoadCarlaMap() ){
+      UE_LOG(LogCarlaDigitalTwinsTool, Error, TEXT("UOpenDriveToMap::InitTileGrid(): Invalid Map") );
+      return false;
+    }
+    if( TileSize <= 0.0f ){
+      TileSize = GetMutableDefault<ALargeMapManager>()->GetTileSize();
+    }
+    // Tiles grow along +X and -Y from the origin, see GetTileBounds
+    float MaxX = 0.0f;
+    float MinY = 0.0f;
+    for( const auto& Element : CarlaMap->GetRtreeElements() ){
+      MaxX = FMath::Max3(MaxX, Element.first.first.get<0>(), Element.first.second.get<0>());
+      MinY = FMath::Min3(MinY, Element.first.first.get<1>(), Element.first.second.get<1>());
+    }
+    NumTilesInXY = FIntVector(
+      FMath::Max(FMath::CeilToInt(MaxX * 100.0f / TileSize), 1),
+      FMath::Max(FMath::CeilToInt(-MinY * 100.0f / TileSize), 1),
+      0);
+    Tile0Offset = FVector(0,0,0);
+#endif
+  }
+  UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::InitTileGrid(): %s tiles of %f"),
+    *NumTilesInXY.ToString(), TileSize );
+  return TileSize > 0.0f && NumTilesInXY.X > 0 && NumTilesInXY.Y > 0;
+}
+
 bool UOpenDriveToMap::GoNextTile(){
-  CurrentTilesInXY.X++;
-  if( CurrentTilesInXY.X >= NumTilesInXY.X ){
-    CurrentTilesInXY.X = 0;
-    CurrentTilesInXY.Y++;
-    if( CurrentTilesInXY.Y >= NumTilesInXY.Y ){
+  return GetNextTile(CurrentTilesInXY);
+}
+
+bool UOpenDriveToMap::GetNextTile(FIntVector& Tile) const{
+  Tile.X++;
+  if( Tile.X >= NumTilesInXY.X ){
+    Tile.X = 0;
+    Tile.Y++;
+    if( Tile.Y >= NumTilesInXY.Y ){
       return false;
     }
   }
   return true;
 }
 
+void UOpenDriveToMap::GetTileBounds(const FIntVector& Tile, FVector& OutMin, FVector& OutMax) const{
+  OutMin = FVector(Tile.X * TileSize, Tile.Y * -TileSize, 0.0f);
+  OutMax = FVector((Tile.X + 1.0f ) * TileSize, (Tile.Y + 1.0f) * -TileSize, 0.0f);
+}
+
+FTileGeometrySettings UOpenDriveToMap::GetTileGeometrySettings() const{
+  FTileGeometrySettings Settings;
+  Settings.RoadParameters = opg_parameters;
+  Settings.RoadParameters.vertex_distance = 0.5f;
+  Settings.RoadParameters.vertex_width_resolution = 8.0f;
+#if ENGINE_MAJOR_VERSION < 5
+  Settings.RoadParameters.simplification_percentage = 50.0f;
+#else
+  Settings.RoadParameters.simplification_percentage = 0.0f;
+#endif
+  Settings.LaneMarkParameters = opg_parameters;
+  Settings.LaneMarkParameters.vertex_distance = 0.5f;
+  Settings.LaneMarkParameters.vertex_width_resolution = 8.0f;
+  Settings.LaneMarkParameters.simplification_percentage = 15.0f;
+  Settings.DistanceBetweenTrees = DistanceBetweenTrees;
+  Settings.DistanceFromRoadEdge = DistanceFromRoadEdge;
+  return Settings;
+}
+
+void UOpenDriveToMap::DuplicateDefaultMaterials(){
+  const double Start = FPlatformTime::Seconds();
+  UMaterialInstance* DefaultMaterials[] = {
+    DefaultRoadMaterial,
+    DefaultLaneMarksWhiteMaterial,
+    DefaultLaneMarksYellowMaterial,
+    DefaultSidewalksMaterial,
+    DefaultLandscapeMaterial
+  };
+  for (UMaterialInstance* DefaultMaterial : DefaultMaterials)
+  {
+    if (DefaultMaterial)
+    {
+      UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultMaterial, MapName);
+    }
+  }
+  UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::DuplicateDefaultMaterials(): Default materials copied to %s in %f seconds."),
+    *MapName, FPlatformTime::Seconds() - Start );
+}
+
+TSharedPtr<FTileGeometry> UOpenDriveToMap::TakeCurrentTileGeometry(){
+  const FTileGeometrySettings Settings = GetTileGeometrySettings();
+  TSharedPtr<FTileGeometry> Geometry = TilePipeline.Take(*CarlaMap, Settings, CurrentTilesInXY, MinPosition, MaxPosition);
+  TileGeometrySeconds += Geometry->GenerationSeconds;
+
+  if( bPipelineTiles ){
+    // The next tiles are generated while this one is built and saved
+    FIntVector NextTile = CurrentTilesInXY;
+    for( int32 i = 0; i < PipelineTileQueueDepth && GetNextTile(NextTile); ++i ){
+      FVector NextMin, NextMax;
+      GetTileBounds(NextTile, NextMin, NextMax);
+      TilePipeline.Prefetch(*CarlaMap, Settings, PipelineTileQueueDepth, NextTile, NextMin, NextMax);
+    }
+  }
+  return Geometry;
+}
+
 void UOpenDriveToMap::ReturnToMainLevel(){
   FEditorFileUtils::SaveDirtyPackages(false, true, true, false, false, false, nullptr);
   UEditorLevelLibrary::LoadLevel(*BaseLevelName);
@@ -614,19 +788,131 @@ UWorld* UOpenDriveToMap::GetGameWorld()
   return nullptr;
 }
 
+bool UOpenDriveToMap::LoadCarlaMap()
+{
+  const FDateTime FileTimeStamp = IFileManager::Get().GetTimeStamp(*FilePath);
+  if( bReuseParsedMap && CarlaMap.has_value() &&
+      LoadedMapFilePath == FilePath && LoadedMapTimeStamp == FileTimeStamp )
+  {
+    UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::LoadCarlaMap(): Reusing resident map for %s"), *FilePath );
+    return true;
+  }
+
+  // The prefetched tiles are generated from the map about to be replaced
+  TilePipeline.Flush();
+
+  double start = FPlatformTime::Seconds();
+  FString FileContent;
+  FFileHelper::LoadFileToString(FileContent, *FilePath);
+  std::string opendrive_xml = carla::rpc::FromLongFString(FileContent);
+  double end = FPlatformTime::Seconds();
+  UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::LoadCarlaMap(): Read %s in %f seconds."), *FilePath, end - start );
+
+  start = FPlatformTime::Seconds();
+  const FString CachePath = FilePath + TEXT(".bin");
+  const uint64 ContentHash = carla::road::MapCache::ComputeHash(opendrive_xml);
+  bool bCacheHit = false;
+  if( bUseMapCache )
+  {
+    // The cache is read straight from the mapped file, without copying it
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    TUniquePtr<IMappedFileHandle> CacheHandle(PlatformFile.OpenMapped(*CachePath));
+    TUniquePtr<IMappedFileRegion> CacheRegion(CacheHandle ? CacheHandle->MapRegion() : nullptr);
+    if( CacheRegion )
+    {
+      carla::road::MapCache Cache(CacheRegion->GetMappedPtr(), CacheRegion->GetMappedSize());
+      if( Cache.IsValidFor(ContentHash) )
+      {
+        CarlaMap = carla::opendrive::OpenDriveParser::Load(opendrive_xml, Cache);
+        bCacheHit = true;
+      }
+      else
+      {
+        UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::LoadCarlaMap(): Outdated map cache %s, parsing from XML."), *CachePath );
+      }
+    }
+  }
+  if( !bCacheHit )
+  {
+    CarlaMap = carla::opendrive::OpenDriveParser::Load(opendrive_xml);
+  }
+  end = FPlatformTime::Seconds();
+  UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::LoadCarlaMap(): Parsed and built map in %f seconds (cache %s)."),
+    end - start, bCacheHit ? TEXT("hit") : TEXT("miss") );
+
+  if( !CarlaMap.has_value() )
+  {
+    LoadedMapFilePath.Empty();
+    return false;
+  }
+
+  if( bUseMapCache && !bCacheHit )
+  {
+    const std::vector<uint8_t> CacheData = carla::road::MapCache::Serialize(*CarlaMap, ContentHash);
+    if( !FFileHelper::SaveArrayToFile(TArrayView<const uint8>(CacheData.data(), CacheData.size()), *CachePath) )
+    {
+      UE_LOG(LogCarlaDigitalTwinsTool, Warning, TEXT("UOpenDriveToMap::LoadCarlaMap(): Failed to write map cache %s"), *CachePath );
+    }
+  }
+  LoadedMapFilePath = FilePath;
+  LoadedMapTimeStamp = FileTimeStamp;
+  return true;
+}
+
+void UOpenDriveToMap::GenerateAllTiles()
+{
+  // GetNextTile stops at NumTilesInXY, which has to be known before the
+  // first tile
+  if( !InitTileGrid() ){
+    UE_LOG(LogCarlaDigitalTwinsTool, Error, TEXT("UOpenDriveToMap::GenerateAllTiles(): No tile grid to generate") );
+    return;
+  }
+  const double SweepStart = FPlatformTime::Seconds();
+  int32 NumGeneratedTiles = 0;
+  TileGeometrySeconds = 0.0;
+  TileAssetSeconds = 0.0;
+  TileSaveSeconds = 0.0;
+  TilePipeline.ResetStats();
+  bGeneratingAllTiles = true;
+  do{
+    const double TileStart = FPlatformTime::Seconds();
+    GenerateTileStandalone();
+    const double TileEnd = FPlatformTime::Seconds();
+    UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::GenerateAllTiles(): Tile %s generated in %f seconds."),
+      *CurrentTilesInXY.ToString(), TileEnd - TileStart );
+    ++NumGeneratedTiles;
+  }while(GoNextTile());
+  bGeneratingAllTiles = false;
+  TilePipeline.Flush();
+
+  // With the pipeline the geometry runs on the thread pool, so its share and
+  // the game thread ones can add up to more than 100%
+  const double SweepSeconds = FMath::Max(FPlatformTime::Seconds() - SweepStart, SMALL_NUMBER);
+  const double WaitSeconds = TilePipeline.GetWaitSeconds();
+  UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::GenerateAllTiles(): %d tiles generated in %f seconds%s."),
+    NumGeneratedTiles, SweepSeconds, bPipelineTiles ? TEXT(" (pipelined)") : TEXT("") );
+  UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::GenerateAllTiles(): Geometry %f s (%.1f%%), assets %f s (%.1f%%), save %f s (%.1f%%), waiting for geometry %f s (%.1f%%)."),
+    TileGeometrySeconds, 100.0 * TileGeometrySeconds / SweepSeconds,
+    TileAssetSeconds, 100.0 * TileAssetSeconds / SweepSeconds,
+    TileSaveSeconds, 100.0 * TileSaveSeconds / SweepSeconds,
+    WaitSeconds, 100.0 * WaitSeconds / SweepSeconds );
+
+#if ENGINE_MAJOR_VERSION < 5
+#if PLATFORM_LINUX
+  // Once for the whole sweep, as GenerateTile does for a single tile
+  RemoveFromRoot();
+#endif
+#endif
+}
+
 void UOpenDriveToMap::LoadMap()
 {
   if( FilePath.IsEmpty() ){
     return;
   }
 
-  FString FileContent;
   UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::LoadMap(): File to load %s"), *FilePath );
-  FFileHelper::LoadFileToString(FileContent, *FilePath);
-  std::string opendrive_xml = carla::rpc::FromLongFString(FileContent);
-  CarlaMap = carla::opendrive::OpenDriveParser::Load(opendrive_xml);
-  
-  if (!CarlaMap.has_value())
+  if (!LoadCarlaMap())
   {
     UE_LOG(LogCarlaDigitalTwinsTool, Error, TEXT("Invalid Map"));
   }
@@ -636,6 +922,7 @@ void UOpenDriveToMap::LoadMap()
     MapName = FPaths::GetCleanFilename(FilePath);
     MapName.RemoveFromEnd(".xodr", ESearchCase::Type::IgnoreCase);
     UE_LOG(LogCarlaDigitalTwinsTool, Warning, TEXT("MapName %s"), *MapName);
+    DuplicateDefaultMaterials();
 
     AActor* QueryActor = UGameplayStatics::GetActorOfClass(
                                 GetEditorWorld(),
@@ -651,9 +938,7 @@ void UOpenDriveToMap::LoadMap()
       CurrentTilesInXY = FIntVector(0,0,0);
       ULevel* PersistantLevel = GetEditorWorld()->PersistentLevel;
       BaseLevelName = LargeMapManager->LargeMapTilePath + "/" + LargeMapManager->LargeMapName;
-      do{
-        GenerateTileStandalone();
-      }while(GoNextTile());
+      GenerateAllTiles();
       ReturnToMainLevel();
       
     }
@@ -665,9 +950,7 @@ void UOpenDriveToMap::LoadMap()
       HeightmapPixels = HeightmapCopy->AsG16();
     }
 
-    do{
-      GenerateTileStandalone();
-    }while(GoNextTile());
+    GenerateAllTiles();
 
     RemoveFromRoot();
     UWorld* World = GEditor->GetEditorWorldContext().World();
@@ -689,15 +972,13 @@ TArray<AActor*> UOpenDriveToMap::GenerateMiscActors(float Offset, FVector MinLoc
 
   std::vector<std::pair<carla::geom::Transform, std::string>>
     Locations = CarlaMap->GetTreesTransform(CarlaMinLocation, CarlaMaxLocation, DistanceBetweenTrees, DistanceFromRoadEdge, Offset);
+  TArray<FTransform> Transforms = GetSnappedPositions(Locations);
   TArray<AActor*> Returning;
   static int i = 0;
-  for (auto& cl : Locations)
+  for (size_t LocationIndex = 0; LocationIndex < Locations.size(); ++LocationIndex)
   {
-    const FVector scale{ 1.0f, 1.0f, 1.0f };
-    cl.first.location.z = GetHeight(cl.first.location.x, cl.first.location.y) / 100.0f;
-    FTransform NewTransform ( FRotator(cl.first.rotation), FVector(cl.first.location), scale );
-
-    NewTransform = GetSnappedPosition(NewTransform);
+    const auto& cl = Locations[LocationIndex];
+    const FTransform& NewTransform = Transforms[LocationIndex];
 
     AActor* Spawner = GetEditorWorld()->SpawnActor<AStaticMeshActor>(AStaticMeshActor::StaticClass(),
       NewTransform.GetLocation(), NewTransform.Rotator());
@@ -715,45 +996,47 @@ TArray<AActor*> UOpenDriveToMap::GenerateMiscActors(float Offset, FVector MinLoc
 
 void UOpenDriveToMap::GenerateAll(const boost::optional<carla::road::Map>& ParamCarlaMap,
   FVector MinLocation,
-  FVector MaxLocation )
+  FVector MaxLocation,
+  const FTileGeometry& Geometry )
 {
+  UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::GenerateAll() Geometry of tile %s generated in %f seconds."),
+    *Geometry.Tile.ToString(), Geometry.GenerationSeconds);
+  if (bUseTerrainHeightField)
+  {
+    // Same area CreateTerrain covers
+    const FVector2D HeightFieldMin(MinPosition.X, MaxPosition.Y);
+    TerrainHeightField.Init(FBox2D(HeightFieldMin, HeightFieldMin + FVector2D(TileSize, TileSize)), TerrainHeightFieldCellSize);
+  }
+  else
+  {
+    TerrainHeightField.Reset();
+  }
+
   UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::GenerateAll() Generating Roads..... "));
-  GenerateRoadMesh(ParamCarlaMap, MinLocation, MaxLocation);
+  GenerateRoadMesh(ParamCarlaMap, Geometry);
   UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::GenerateAll() Generating Lane Marks..... "));
-  GenerateLaneMarks(ParamCarlaMap, MinLocation, MaxLocation);
+  GenerateLaneMarks(ParamCarlaMap, Geometry);
   // GenerateSpawnPoints(ParamCarlaMap, MinLocation, MaxLocation);
   UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::GenerateAll() Generating Terrain..... "));
   CreateTerrain(5,5, 64);
   UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::GenerateAll() Generating Tree positions..... "));
-  GenerateTreePositions(ParamCarlaMap, MinLocation, MaxLocation);
+  GenerateTreePositions(Geometry);
   UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("UOpenDriveToMap::GenerateAll() Generating Misc stuff..... "));
   GenerationFinished(MinLocation, MaxLocation);
+  TerrainHeightField.Reset();
 }
 
-void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>& ParamCarlaMap, FVector MinLocation, FVector MaxLocation )
+void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>& ParamCarlaMap, const FTileGeometry& Geometry )
 {
-  opg_parameters.vertex_distance = 0.5f;
-  opg_parameters.vertex_width_resolution = 8.0f;
-#if ENGINE_MAJOR_VERSION < 5
-  opg_parameters.simplification_percentage = 50.0f;
-#else
-  opg_parameters.simplification_percentage = 0.0f;
-#endif
-  double start = FPlatformTime::Seconds();
+  const auto& Meshes = Geometry.RoadMeshes;
 
-  carla::geom::Vector3D CarlaMinLocation(MinLocation.X / 100, MinLocation.Y / 100, MinLocation.Z /100);
-  carla::geom::Vector3D CarlaMaxLocation(MaxLocation.X / 100, MaxLocation.Y / 100, MaxLocation.Z /100);
-  UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT(" Generating roads between %s  and %s"), *(CarlaMinLocation.ToFVector().ToString()), *(CarlaMaxLocation.ToFVector().ToString()) );
-  const auto Meshes = ParamCarlaMap->GenerateOrderedChunkedMeshInLocations(opg_parameters, CarlaMinLocation, CarlaMaxLocation);
-  double end = FPlatformTime::Seconds();
-  UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT(" GenerateOrderedChunkedMesh code executed in %f seconds. Simplification percentage is %f"), end - start, opg_parameters.simplification_percentage);
-
-  start = FPlatformTime::Seconds();
+  double start = FPlatformTime::Seconds();
   static int index = 0;
 
   struct FPreparedMeshData
   {
     FProceduralCustomMesh MeshData;
+    TArray<FProcMeshTangent> Tangents;
     FVector MeshCentroid;
     carla::road::Lane::LaneType LaneType;
     int32 Index;
@@ -768,6 +1051,28 @@ void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>&
     const auto& LaneType = PairMap.first;
     const auto& MeshList = PairMap.second;
 
+    // Distances to the lane border of the vertices of every driving mesh, in
+    // one batched query. VertexOffsets[i] is the first vertex of mesh i.
+    std::vector<size_t> VertexOffsets(MeshList.size() + 1, 0);
+    std::vector<float> BorderDistances;
+    if (LaneType == carla::road::Lane::LaneType::Driving)
+    {
+      std::vector<carla::geom::Location> VertexLocations;
+      for (size_t i = 0; i < MeshList.size(); ++i)
+      {
+        VertexOffsets[i] = VertexLocations.size();
+        if (MeshList[i]->IsValid())
+        {
+          for (const auto& Vertex : MeshList[i]->GetVertices())
+          {
+            VertexLocations.emplace_back(Vertex.ToFVector());
+          }
+        }
+      }
+      VertexOffsets[MeshList.size()] = VertexLocations.size();
+      BorderDistances = DistancesToLaneBorder(ParamCarlaMap, VertexLocations);
+    }
+
     ParallelFor(MeshList.size(), [&](int32 i)
     {
       const auto& Mesh = MeshList[i];
@@ -776,13 +1081,22 @@ void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>&
 
       auto& Vertices = Mesh->GetVertices();
 
+      // The heights bend the surface MeshFactory generated the normals and
+      // tangents of, so they are bent the same way from the slope of the
+      // heights at each vertex, keeping the vertices split at the curbs
+      std::vector<carla::geom::Vector2D> Slopes(Vertices.size());
       if (LaneType == carla::road::Lane::LaneType::Driving)
       {
-        for (auto& Vertex : Vertices)
+        const float* MeshBorderDistances = BorderDistances.data() + VertexOffsets[i];
+        for (size_t v = 0; v < Vertices.size(); ++v)
         {
-          FVector FV = Vertex.ToFVector();
-          Vertex.z += GetHeight(Vertex.x * 100.0f, Vertex.y * 100.0f, DistanceToLaneBorder(ParamCarlaMap, FV) > 65.0f) / 100.0f;
+          auto& Vertex = Vertices[v];
+          const bool bDrivingLane = MeshBorderDistances[v] > 65.0f;
+          const FVector2D Slope = GetHeightSlope(Vertex.x * 100.0f, Vertex.y * 100.0f, bDrivingLane);
+          Slopes[v] = carla::geom::Vector2D(Slope.X, Slope.Y);
+          Vertex.z += GetHeight(Vertex.x * 100.0f, Vertex.y * 100.0f, bDrivingLane) / 100.0f;
         }
+        Mesh->DisplaceNormalsAndTangents(Slopes);
 #if ENGINE_MAJOR_VERSION < 5
         carla::geom::Simplification Simplify(0.15);
         Simplify.Simplificate(Mesh);
@@ -790,10 +1104,14 @@ void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>&
       }
       else
       {
-        for (auto& Vertex : Vertices)
+        for (size_t v = 0; v < Vertices.size(); ++v)
         {
+          auto& Vertex = Vertices[v];
+          const FVector2D Slope = GetHeightSlope(Vertex.x * 100.0f, Vertex.y * 100.0f, false);
+          Slopes[v] = carla::geom::Vector2D(Slope.X, Slope.Y);
           Vertex.z += (GetHeight(Vertex.x * 100.0f, Vertex.y * 100.0f, false) + 0.15f) / 100.0f;
         }
+        Mesh->DisplaceNormalsAndTangents(Slopes);
       }
 
       FVector Centroid(0);
@@ -808,7 +1126,7 @@ void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>&
       }
 
       FPreparedMeshData Data;
-      Data.MeshData = *Mesh;
+      Mesh->ToProceduralMesh(Data.MeshData, Data.Tangents);
       Data.MeshCentroid = Centroid;
       Data.LaneType = LaneType;
 
@@ -822,6 +1140,15 @@ void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>&
     });
   }
 
+  TArray<FMapGenMeshRequest> MeshRequests;
+  TArray<UStaticMeshComponent*> RequestComponents;
+  MeshRequests.Reserve(PreparedMeshes.Num());
+  RequestComponents.Reserve(PreparedMeshes.Num());
+
+  // Copied to the plugin once for every mesh of the tile
+  UMaterialInstance* DuplicatedRoadMaterial = Cast<UMaterialInstance>(UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultRoadMaterial, MapName));
+  UMaterialInstance* DuplicatedSidewalkMaterial = Cast<UMaterialInstance>(UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultSidewalksMaterial, MapName));
+
   for (FPreparedMeshData& Entry : PreparedMeshes)
   {
     const FProceduralCustomMesh& Mesh = Entry.MeshData;
@@ -830,8 +1157,7 @@ void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>&
     const carla::road::Lane::LaneType LaneType = Entry.LaneType;
 
 
-    TArray<FProcMeshTangent> Tangents;
-    UKismetProceduralMeshLibrary::CalculateTangentsForMesh(Entry.MeshData.Vertices, Entry.MeshData.Triangles, Entry.MeshData.UV0, Entry.MeshData.Normals, Tangents);
+    TerrainHeightField.AddMesh(Entry.MeshData.Vertices, Entry.MeshData.Triangles, Centroid * 100);
 
     AStaticMeshActor* TempActor = GetEditorWorld()->SpawnActor<AStaticMeshActor>();
     UStaticMeshComponent* StaticMeshComponent = TempActor->GetStaticMeshComponent();
@@ -847,9 +1173,6 @@ void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>&
 
     if (LaneType == carla::road::Lane::LaneType::Driving && DefaultRoadMaterial)
     {
-      UObject* DuplicatedMaterialObject = UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultRoadMaterial, MapName);
-      UMaterialInstance* DuplicatedRoadMaterial = Cast<UMaterialInstance>(DuplicatedMaterialObject);
-
       StaticMeshComponent->SetMaterial(0, DuplicatedRoadMaterial);
       StaticMeshComponent->CastShadow = false;
       TempActor->SetActorLabel(FString("SM_DrivingLane_") + FString::FromInt(Index));
@@ -857,31 +1180,32 @@ void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>&
 
     if (LaneType == carla::road::Lane::LaneType::Sidewalk && DefaultSidewalksMaterial)
     {
-      UObject* DuplicatedMaterialObject = UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultRoadMaterial, MapName);
-      UMaterialInstance* DuplicatedSidewalkMaterial = Cast<UMaterialInstance>(DuplicatedMaterialObject);
-
       StaticMeshComponent->SetMaterial(0, DuplicatedSidewalkMaterial);
       TempActor->SetActorLabel(FString("SM_Sidewalk_") + FString::FromInt(Index));
     }
 
-    UStaticMesh* FinalMesh = nullptr;
-
+    // The static meshes are created all at once after the loop
     if (LaneType == carla::road::Lane::LaneType::Sidewalk)
     {
-      UObject* DuplicatedMaterialObject = UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultSidewalksMaterial, MapName);
-      UMaterialInstance* DuplicatedSidewalkMaterial = Cast<UMaterialInstance>(DuplicatedMaterialObject);
-
-      FinalMesh = UMapGenFunctionLibrary::CreateMesh(Entry.MeshData, Tangents, DuplicatedSidewalkMaterial, MapName, "Sidewalk", FName(TEXT("SM_SidewalkMesh" + FString::FromInt(Index) + GetStringForCurrentTile())));
+      FMapGenMeshRequest& Request = MeshRequests.AddDefaulted_GetRef();
+      Request.Data = MoveTemp(Entry.MeshData);
+      Request.Tangents = MoveTemp(Entry.Tangents);
+      Request.MaterialInstance = DuplicatedSidewalkMaterial;
+      Request.FolderName = "Sidewalk";
+      Request.MeshName = FName(TEXT("SM_SidewalkMesh" + FString::FromInt(Index) + GetStringForCurrentTile()));
+      RequestComponents.Add(StaticMeshComponent);
     }
     else if (LaneType == carla::road::Lane::LaneType::Driving)
     {
-      UObject* DuplicatedMaterialObject = UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultRoadMaterial, MapName);
-      UMaterialInstance* DuplicatedRoadMaterial = Cast<UMaterialInstance>(DuplicatedMaterialObject);
-
-      FinalMesh = UMapGenFunctionLibrary::CreateMesh(Entry.MeshData, Tangents, DuplicatedRoadMaterial, MapName, "DrivingLane", FName(TEXT("SM_DrivingLaneMesh" + FString::FromInt(Index) + GetStringForCurrentTile())));
+      FMapGenMeshRequest& Request = MeshRequests.AddDefaulted_GetRef();
+      Request.Data = MoveTemp(Entry.MeshData);
+      Request.Tangents = MoveTemp(Entry.Tangents);
+      Request.MaterialInstance = DuplicatedRoadMaterial;
+      Request.FolderName = "DrivingLane";
+      Request.MeshName = FName(TEXT("SM_DrivingLaneMesh" + FString::FromInt(Index) + GetStringForCurrentTile()));
+      RequestComponents.Add(StaticMeshComponent);
     }
 
-    StaticMeshComponent->SetStaticMesh(FinalMesh);
     TempActor->SetActorLocation(Centroid * 100);
     TempActor->Tags.Add(FName("RoadLane"));
     TempActor->SetActorEnableCollision(true);
@@ -891,7 +1215,13 @@ void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>&
 #endif
   }
 
-  end = FPlatformTime::Seconds();
+  const TArray<UStaticMesh*> FinalMeshes = UMapGenFunctionLibrary::CreateMeshes(MeshRequests, MapName);
+  for (int32 i = 0; i < FinalMeshes.Num(); ++i)
+  {
+    RequestComponents[i]->SetStaticMesh(FinalMeshes[i]);
+  }
+
+  double end = FPlatformTime::Seconds();
   UE_LOG(LogCarlaDigitalTwinsTool, Log, TEXT("Mesh spawnning and translation code executed in %f seconds."), end - start);
 
   UWorld* World = GEditor->GetEditorWorldContext().World();
@@ -904,116 +1234,165 @@ void UOpenDriveToMap::GenerateRoadMesh( const boost::optional<carla::road::Map>&
 }
 
 
-void UOpenDriveToMap::GenerateLaneMarks(const boost::optional<carla::road::Map>& ParamCarlaMap, FVector MinLocation, FVector MaxLocation )
+void UOpenDriveToMap::GenerateLaneMarks(const boost::optional<carla::road::Map>& ParamCarlaMap, const FTileGeometry& Geometry )
 {
-  opg_parameters.vertex_distance = 0.5f;
-  opg_parameters.vertex_width_resolution = 8.0f;
-  opg_parameters.simplification_percentage = 15.0f;
-  std::vector<std::string> lanemarkinfo;
-  carla::geom::Vector3D CarlaMinLocation(MinLocation.X / 100, MinLocation.Y / 100, MinLocation.Z /100);
-  carla::geom::Vector3D CarlaMaxLocation(MaxLocation.X / 100, MaxLocation.Y / 100, MaxLocation.Z /100);
-  auto MarkingMeshes = ParamCarlaMap->GenerateLineMarkings(opg_parameters, CarlaMinLocation, CarlaMaxLocation, lanemarkinfo);
-  TArray<AActor*> LaneMarkerActorList;
   static int meshindex = 0;
-  int index = 0;
-  for (const auto& Mesh : MarkingMeshes)
-  {
 
-    if ( !Mesh->GetVertices().size() )
+  // Distances to the lane border of the vertices of every batch and of the
+  // center of every dash, in one batched query. LocationOffsets[i] is the
+  // first location of batch i, its dashes follow its vertices.
+  std::vector<size_t> LocationOffsets;
+  LocationOffsets.reserve(Geometry.LaneMarkBatches.size());
+  std::vector<carla::geom::Location> Locations;
+  for (const auto& Batch : Geometry.LaneMarkBatches)
+  {
+    LocationOffsets.push_back(Locations.size());
+    for (const auto& Vertex : Batch.mesh.GetVertices())
     {
-      index++;
-      continue;
+      Locations.emplace_back(Vertex.ToFVector());
     }
-    if ( !Mesh->IsValid() ) {
-      index++;
-      continue;
+    for (const auto& Dash : Batch.dashes)
+    {
+      Locations.emplace_back(Dash.location.ToFVector());
     }
+  }
+  const std::vector<float> BorderDistances = DistancesToLaneBorder(ParamCarlaMap, Locations);
 
-    FVector MeshCentroid = FVector(0, 0, 0);
-    for (auto& Vertex : Mesh->GetVertices())
+  auto GetLaneMarkMaterial = [this](const std::string& Material) -> UMaterialInstance*
+  {
+    UMaterialInstance* DefaultMaterial = Material.find("yellow") != std::string::npos
+        ? DefaultLaneMarksYellowMaterial
+        : DefaultLaneMarksWhiteMaterial;
+    if (!DefaultMaterial)
     {
-      FVector VertexFVector = Vertex.ToFVector();
-      Vertex.z += GetHeight(Vertex.x * 100.0f, Vertex.y * 100.0f, DistanceToLaneBorder(ParamCarlaMap,VertexFVector) > 65.0f ) / 100.0f + 0.01f;
-      MeshCentroid += Vertex.ToFVector();
+      return nullptr;
     }
+    return Cast<UMaterialInstance>(UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultMaterial, MapName));
+  };
 
-    MeshCentroid /= Mesh->GetVertices().size();
+  UStaticMesh* DashMesh = DefaultLaneMarkDashMesh;
+  if (!DashMesh)
+  {
+    DashMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Plane.Plane"));
+  }
 
-    for (auto& Vertex : Mesh->GetVertices())
-    {
-      Vertex.x -= MeshCentroid.X;
-      Vertex.y -= MeshCentroid.Y;
-      Vertex.z -= MeshCentroid.Z;
-    }
+  TArray<FMapGenMeshRequest> MeshRequests;
+  TArray<UStaticMeshComponent*> RequestComponents;
+  UMaterialInstance* DuplicatedLandscapeMaterial = Cast<UMaterialInstance>(UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultLandscapeMaterial, MapName));
 
-    // TODO: Improve this code
-    float MinDistance = 99999999.9f;
-    for(auto SpawnedActor : LaneMarkerActorList)
+  for (size_t BatchIndex = 0; BatchIndex < Geometry.LaneMarkBatches.size(); ++BatchIndex)
+  {
+    const auto& Batch = Geometry.LaneMarkBatches[BatchIndex];
+    const float* BatchBorderDistances = BorderDistances.data() + LocationOffsets[BatchIndex];
+    UMaterialInstance* LaneMarkMaterial = GetLaneMarkMaterial(Batch.material);
+
+    // Every solid mark of the tile with this material, in a single mesh
+    if (Batch.mesh.GetVerticesNum() != 0 && Batch.mesh.IsValid())
     {
-      float VectorDistance = FVector::Distance(MeshCentroid*100, SpawnedActor->GetActorLocation());
-      if(VectorDistance < MinDistance)
+      carla::geom::Mesh Mesh = Batch.mesh;
+      FVector MeshCentroid = FVector(0, 0, 0);
+      for (size_t v = 0; v < Mesh.GetVertices().size(); ++v)
       {
-        MinDistance = VectorDistance;
+        auto& Vertex = Mesh.GetVertices()[v];
+        Vertex.z += GetHeight(Vertex.x * 100.0f, Vertex.y * 100.0f, BatchBorderDistances[v] > 65.0f ) / 100.0f + 0.01f;
+        MeshCentroid += Vertex.ToFVector();
       }
-    }
 
-    if(MinDistance < 250)
-    {
-      UE_LOG(LogCarlaDigitalTwinsTool, VeryVerbose, TEXT("Skkipped is %f."), MinDistance);
-      index++;
-      continue;
-    }
+      MeshCentroid /= Mesh.GetVertices().size();
 
-    AStaticMeshActor* TempActor = GetEditorWorld()->SpawnActor<AStaticMeshActor>();
-    UStaticMeshComponent* StaticMeshComponent = TempActor->GetStaticMeshComponent();
-    TempActor->SetActorLabel(FString("SM_LaneMark_") + FString::FromInt(meshindex));
-    StaticMeshComponent->CastShadow = false;
-    if (lanemarkinfo[index].find("yellow") != std::string::npos) {
-      if(DefaultLaneMarksYellowMaterial)
+      for (auto& Vertex : Mesh.GetVertices())
       {
-        UObject* DuplicatedMaterialObject = UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultLaneMarksYellowMaterial, MapName);
-        UMaterialInstance* DuplicatedLaneMarksYellowMaterial = Cast<UMaterialInstance>(DuplicatedMaterialObject);
-
-        StaticMeshComponent->SetMaterial(0, DuplicatedLaneMarksYellowMaterial);
+        Vertex.x -= MeshCentroid.X;
+        Vertex.y -= MeshCentroid.Y;
+        Vertex.z -= MeshCentroid.Z;
       }
-    }else{
-      if(DefaultLaneMarksWhiteMaterial)
-      {
-        UObject* DuplicatedMaterialObject = UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultLaneMarksWhiteMaterial, MapName);
-        UMaterialInstance* DuplicatedLaneMarksWhiteMaterial = Cast<UMaterialInstance>(DuplicatedMaterialObject);
+      // The merged marks carry no generated normals, ToProceduralMesh
+      // computes them from the displaced triangles
 
-        StaticMeshComponent->SetMaterial(0, DuplicatedLaneMarksWhiteMaterial);
+      AStaticMeshActor* TempActor = GetEditorWorld()->SpawnActor<AStaticMeshActor>();
+      UStaticMeshComponent* StaticMeshComponent = TempActor->GetStaticMeshComponent();
+      TempActor->SetActorLabel(FString("SM_LaneMark_") + FString::FromInt(meshindex));
+      StaticMeshComponent->CastShadow = false;
+      if (LaneMarkMaterial)
+      {
+        StaticMeshComponent->SetMaterial(0, LaneMarkMaterial);
       }
-    }
 
-    const FProceduralCustomMesh MeshData = *Mesh;
-    TArray<FVector> Normals;
-    TArray<FProcMeshTangent> Tangents;
-    UKismetProceduralMeshLibrary::CalculateTangentsForMesh(
-      MeshData.Vertices,
-      MeshData.Triangles,
-      MeshData.UV0,
-      Normals,
-      Tangents
-    );
+      FMapGenMeshRequest& Request = MeshRequests.AddDefaulted_GetRef();
+      Mesh.ToProceduralMesh(Request.Data, Request.Tangents);
 
-    UObject* DuplicatedMaterialObject = UBlueprintUtilFunctions::CopyAssetToPlugin(DefaultLandscapeMaterial, MapName);
-    UMaterialInstance* DuplicatedLandscapeMaterial = Cast<UMaterialInstance>(DuplicatedMaterialObject);
+      Request.MaterialInstance = DuplicatedLandscapeMaterial;
+      Request.FolderName = "LaneMark";
+      Request.MeshName = FName(TEXT("SM_LaneMarkMesh" + FString::FromInt(meshindex) + GetStringForCurrentTile() ));
+      RequestComponents.Add(StaticMeshComponent);
 
-    UStaticMesh* MeshToSet = UMapGenFunctionLibrary::CreateMesh(MeshData,  Tangents, DuplicatedLandscapeMaterial, MapName, "LaneMark", FName(TEXT("SM_LaneMarkMesh" + FString::FromInt(meshindex) + GetStringForCurrentTile() )));
-    StaticMeshComponent->SetStaticMesh(MeshToSet);
-    
-    TempActor->SetActorLocation(MeshCentroid * 100);
-    TempActor->Tags.Add(*FString(lanemarkinfo[index].c_str()));
-    TempActor->Tags.Add(FName("RoadLane"));
+      TempActor->SetActorLocation(MeshCentroid * 100);
+      TempActor->Tags.Add(*FString(Batch.material.c_str()));
+      TempActor->Tags.Add(FName("RoadLane"));
 #if ENGINE_MAJOR_VERSION > 4
       TempActor->SetIsSpatiallyLoaded(true);
 #endif
-    LaneMarkerActorList.Add(TempActor);
-    index++;
-    meshindex++;
-    TempActor->SetActorEnableCollision(false);
-    StaticMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+      meshindex++;
+      TempActor->SetActorEnableCollision(false);
+      StaticMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+    }
+
+    // The dashes, as instances of a quad of 1x1 meters scaled to each one
+    if (!Batch.dashes.empty() && DashMesh)
+    {
+      const float* DashBorderDistances = BatchBorderDistances + Batch.mesh.GetVerticesNum();
+      const FBox DashBounds = DashMesh->GetBoundingBox();
+      const FVector DashSize = DashBounds.GetSize();
+      const float DashMeshLength = DashSize.X > 0.0f ? DashSize.X : 100.0f;
+      const float DashMeshWidth = DashSize.Y > 0.0f ? DashSize.Y : 100.0f;
+
+      TArray<FTransform> DashTransforms;
+      DashTransforms.Reserve(Batch.dashes.size());
+      for (size_t d = 0; d < Batch.dashes.size(); ++d)
+      {
+        const auto& Dash = Batch.dashes[d];
+        FVector Location = Dash.location.ToFVector() * 100.0f;
+        Location.Z += GetHeight(Location.X, Location.Y, DashBorderDistances[d] > 65.0f) + 1.0f;
+        DashTransforms.Add(FTransform(
+            FRotator(0.0f, Dash.yaw, 0.0f),
+            Location,
+            FVector(Dash.length * 100.0f / DashMeshLength, Dash.width * 100.0f / DashMeshWidth, 1.0f)));
+      }
+
+      AActor* DashActor = GetEditorWorld()->SpawnActor<AActor>();
+      USceneComponent* RootComponent = NewObject<USceneComponent>(DashActor, TEXT("DashRootComponent"));
+      DashActor->SetRootComponent(RootComponent);
+      RootComponent->RegisterComponent();
+      UHierarchicalInstancedStaticMeshComponent* DashComponent =
+          NewObject<UHierarchicalInstancedStaticMeshComponent>(DashActor);
+      DashComponent->SetupAttachment(RootComponent);
+      DashComponent->RegisterComponent();
+      DashActor->AddInstanceComponent(DashComponent);
+
+      DashComponent->SetStaticMesh(DashMesh);
+      if (LaneMarkMaterial)
+      {
+        DashComponent->SetMaterial(0, LaneMarkMaterial);
+      }
+      DashComponent->CastShadow = false;
+      DashComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+      DashComponent->AddInstances(DashTransforms, false, true);
+
+      DashActor->SetActorLabel(FString("HISM_LaneMarkDashes_") + FString::FromInt(meshindex) + GetStringForCurrentTile());
+      DashActor->Tags.Add(*FString(Batch.material.c_str()));
+      DashActor->Tags.Add(FName("RoadLane"));
+#if ENGINE_MAJOR_VERSION > 4
+      DashActor->SetIsSpatiallyLoaded(true);
+#endif
+      DashActor->SetActorEnableCollision(false);
+      meshindex++;
+    }
+  }
+
+  const TArray<UStaticMesh*> MeshesToSet = UMapGenFunctionLibrary::CreateMeshes(MeshRequests, MapName);
+  for (int32 i = 0; i < MeshesToSet.Num(); ++i)
+  {
+    RequestComponents[i]->SetStaticMesh(MeshesToSet[i]);
   }
   UWorld* World = GEditor->GetEditorWorldContext().World();
   if (World)
@@ -1045,20 +1424,15 @@ void UOpenDriveToMap::GenerateSpawnPoints( const boost::optional<carla::road::Ma
 }
   */
 
-void UOpenDriveToMap::GenerateTreePositions( const boost::optional<carla::road::Map>& ParamCarlaMap, FVector MinLocation, FVector MaxLocation  )
+void UOpenDriveToMap::GenerateTreePositions( const FTileGeometry& Geometry )
 {
-  carla::geom::Vector3D CarlaMinLocation(MinLocation.X / 100, MinLocation.Y / 100, MinLocation.Z /100);
-  carla::geom::Vector3D CarlaMaxLocation(MaxLocation.X / 100, MaxLocation.Y / 100, MaxLocation.Z /100);
-
-  std::vector<std::pair<carla::geom::Transform, std::string>> Locations =
-    ParamCarlaMap->GetTreesTransform(CarlaMinLocation, CarlaMaxLocation,DistanceBetweenTrees, DistanceFromRoadEdge );
+  std::vector<std::pair<carla::geom::Transform, std::string>> Locations = Geometry.TreeTransforms;
+  TArray<FTransform> Transforms = GetSnappedPositions(Locations);
   int i = 0;
-  for (auto &cl : Locations)
+  for (size_t LocationIndex = 0; LocationIndex < Locations.size(); ++LocationIndex)
   {
-    const FVector scale{ 1.0f, 1.0f, 1.0f };
-    cl.first.location.z  = GetHeight(cl.first.location.x, cl.first.location.y) / 100.0f;
-    FTransform NewTransform ( FRotator(cl.first.rotation), FVector(cl.first.location), scale );
-    NewTransform = GetSnappedPosition(NewTransform);
+    const auto& cl = Locations[LocationIndex];
+    const FTransform& NewTransform = Transforms[LocationIndex];
 
     AActor* Spawner = GetEditorWorld()->SpawnActor<AStaticMeshActor>(AStaticMeshActor::StaticClass(),
       NewTransform.GetLocation(), NewTransform.Rotator());
@@ -1121,9 +1495,37 @@ float UOpenDriveToMap::GetHeight(float PosX, float PosY, bool bDrivingLane){
   }
 }
 
+TArray<FTransform> UOpenDriveToMap::GetSnappedPositions(
+  std::vector<std::pair<carla::geom::Transform, std::string>>& Locations )
+{
+  TArray<FTransform> Transforms;
+  Transforms.SetNum(Locations.size());
+  ParallelFor(Transforms.Num(), [&](int32 Index)
+  {
+    auto& cl = Locations[Index];
+    const FVector scale{ 1.0f, 1.0f, 1.0f };
+    cl.first.location.z = GetHeight(cl.first.location.x, cl.first.location.y) / 100.0f;
+    FTransform NewTransform ( FRotator(cl.first.rotation), FVector(cl.first.location), scale );
+    Transforms[Index] = GetSnappedPosition(NewTransform);
+  }, !TerrainHeightField.IsValid());
+  return Transforms;
+}
+
 FTransform UOpenDriveToMap::GetSnappedPosition( FTransform Origin )
 {
   FTransform ToReturn = Origin;
+  if (TerrainHeightField.IsValid())
+  {
+    const FVector Location = Origin.GetLocation();
+    float Height;
+    if (!TerrainHeightField.GetHeight(Location.X, Location.Y, Height))
+    {
+      Height = GetHeight(Location.X, Location.Y, false);
+    }
+    ToReturn.SetLocation(FVector(Location.X, Location.Y, Height));
+    return ToReturn;
+  }
+
   FVector Start = Origin.GetLocation() + FVector( 0, 0, MaxHeight + 10000.0f);
   FVector End = Origin.GetLocation() - FVector( 0, 0, MinHeight - 10000.0f);
   FHitResult HitResult;
@@ -1158,7 +1560,25 @@ FTransform UOpenDriveToMap::GetSnappedPosition( FTransform Origin )
   return ToReturn;
 }
 
+FVector2D UOpenDriveToMap::GetHeightSlope(float PosX, float PosY, bool bDrivingLane){
+  const float Step = 50.0f;
+  return FVector2D(
+      (GetHeight(PosX + Step, PosY, bDrivingLane) - GetHeight(PosX - Step, PosY, bDrivingLane)) / (2.0f * Step),
+      (GetHeight(PosX, PosY + Step, bDrivingLane) - GetHeight(PosX, PosY - Step, bDrivingLane)) / (2.0f * Step));
+}
+
 float UOpenDriveToMap::GetHeightForLandscape( FVector Origin ){
+  if (TerrainHeightField.IsValid())
+  {
+    // Only the roads are rasterized while the terrain is being created
+    float RoadHeight;
+    if (TerrainHeightField.GetHeight(Origin.X, Origin.Y, RoadHeight))
+    {
+      return RoadHeight - 100.0f;
+    }
+    return GetHeight(Origin.X, Origin.Y, false) - 2.0f;
+  }
+
   FVector Start = Origin + FVector( 0, 0, MaxHeight + 5000.0f);
   FVector End = Origin - FVector( 0, 0, MinHeight - 5000.0f);
   FHitResult HitResult;
@@ -1198,6 +1618,22 @@ float UOpenDriveToMap::DistanceToLaneBorder(
   return 100000.0f;
 }
 
+std::vector<float> UOpenDriveToMap::DistancesToLaneBorder(
+  const boost::optional<carla::road::Map>& ParamCarlaMap,
+  const std::vector<carla::geom::Location>& Locations, int32_t lane_type ) const
+{
+  const auto Closest = ParamCarlaMap->GetClosestWaypointsOnRoad(Locations, lane_type);
+  std::vector<float> Distances(Locations.size(), 100000.0f);
+  for (size_t i = 0; i < Locations.size(); ++i)
+  {
+    if (Closest[i])
+    {
+      Distances[i] = Locations[i].Distance(Closest[i]->transform.location) - Closest[i]->lane_width;
+    }
+  }
+  return Distances;
+}
+
 bool UOpenDriveToMap::IsInRoad(
   const boost::optional<carla::road::Map>& ParamCarlaMap,
   FVector &location) const
@@ -0,0 +1,116 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "Generation/TerrainHeightField.h"
+
+namespace
+{
+  // Cells not covered by any mesh
+  constexpr float NoSurface = TNumericLimits<float>::Lowest();
+
+  // Tolerance of the barycentric test, so that the cells lying on the shared
+  // edge of two triangles are not missed because of rounding
+  constexpr float EdgeTolerance = 1e-4f;
+}
+
+void FTerrainHeightField::Init(const FBox2D& Bounds, float InCellSize)
+{
+  Reset();
+  if (!Bounds.bIsValid || InCellSize <= 0.0f)
+  {
+    return;
+  }
+  CellSize = InCellSize;
+  Origin = Bounds.Min;
+  const FVector2D Size = Bounds.GetSize();
+  NumCellsX = FMath::Max(FMath::CeilToInt(Size.X / CellSize), 1);
+  NumCellsY = FMath::Max(FMath::CeilToInt(Size.Y / CellSize), 1);
+  Heights.Init(NoSurface, NumCellsX * NumCellsY);
+}
+
+void FTerrainHeightField::Reset()
+{
+  NumCellsX = 0;
+  NumCellsY = 0;
+  Heights.Empty();
+}
+
+void FTerrainHeightField::AddMesh(const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const FVector& Offset)
+{
+  if (!IsValid())
+  {
+    return;
+  }
+  for (int32 i = 0; i + 2 < Triangles.Num(); i += 3)
+  {
+    const int32 I0 = Triangles[i];
+    const int32 I1 = Triangles[i + 1];
+    const int32 I2 = Triangles[i + 2];
+    if (!Vertices.IsValidIndex(I0) || !Vertices.IsValidIndex(I1) || !Vertices.IsValidIndex(I2))
+    {
+      continue;
+    }
+    AddTriangle(Vertices[I0] + Offset, Vertices[I1] + Offset, Vertices[I2] + Offset);
+  }
+}
+
+void FTerrainHeightField::AddTriangle(const FVector& A, const FVector& B, const FVector& C)
+{
+  const float Det = (B.Y - C.Y) * (A.X - C.X) + (C.X - B.X) * (A.Y - C.Y);
+  if (FMath::Abs(Det) < KINDA_SMALL_NUMBER)
+  {
+    // Vertical or degenerate, a trace from above would not hit it either
+    return;
+  }
+
+  // Range of cells whose center lies inside the bounding box of the triangle
+  const auto FirstCell = [this](float Min, float CellOrigin) {
+    return FMath::CeilToInt((Min - CellOrigin) / CellSize - 0.5f);
+  };
+  const auto LastCell = [this](float Max, float CellOrigin) {
+    return FMath::FloorToInt((Max - CellOrigin) / CellSize - 0.5f);
+  };
+  const int32 X0 = FMath::Max(FirstCell(FMath::Min3(A.X, B.X, C.X), Origin.X), 0);
+  const int32 X1 = FMath::Min(LastCell(FMath::Max3(A.X, B.X, C.X), Origin.X), NumCellsX - 1);
+  const int32 Y0 = FMath::Max(FirstCell(FMath::Min3(A.Y, B.Y, C.Y), Origin.Y), 0);
+  const int32 Y1 = FMath::Min(LastCell(FMath::Max3(A.Y, B.Y, C.Y), Origin.Y), NumCellsY - 1);
+
+  const float InvDet = 1.0f / Det;
+  for (int32 y = Y0; y <= Y1; ++y)
+  {
+    const float PY = Origin.Y + (y + 0.5f) * CellSize;
+    for (int32 x = X0; x <= X1; ++x)
+    {
+      const float PX = Origin.X + (x + 0.5f) * CellSize;
+      const float L0 = ((B.Y - C.Y) * (PX - C.X) + (C.X - B.X) * (PY - C.Y)) * InvDet;
+      const float L1 = ((C.Y - A.Y) * (PX - C.X) + (A.X - C.X) * (PY - C.Y)) * InvDet;
+      const float L2 = 1.0f - L0 - L1;
+      if (L0 < -EdgeTolerance || L1 < -EdgeTolerance || L2 < -EdgeTolerance)
+      {
+        continue;
+      }
+      float& Height = Heights[x + y * NumCellsX];
+      Height = FMath::Max(Height, L0 * A.Z + L1 * B.Z + L2 * C.Z);
+    }
+  }
+}
+
+bool FTerrainHeightField::GetHeight(float X, float Y, float& OutHeight) const
+{
+  if (!IsValid())
+  {
+    return false;
+  }
+  const int32 CellX = FMath::FloorToInt((X - Origin.X) / CellSize);
+  const int32 CellY = FMath::FloorToInt((Y - Origin.Y) / CellSize);
+  if (CellX < 0 || CellX >= NumCellsX || CellY < 0 || CellY >= NumCellsY)
+  {
+    return false;
+  }
+  const float Height = Heights[CellX + CellY * NumCellsX];
+  if (Height == NoSurface)
+  {
+    return false;
+  }
+  OutHeight = Height;
+  return true;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "Generation/TileGeometryPipeline.h"
+
+#include "Async/Async.h"
+
+TSharedPtr<FTileGeometry> FTileGeometryPipeline::Generate(
+    const carla::road::Map& Map,
+    const FTileGeometrySettings& Settings,
+    const FIntVector& Tile,
+    const FVector& MinLocation,
+    const FVector& MaxLocation)
+{
+  const double Start = FPlatformTime::Seconds();
+  const carla::geom::Vector3D CarlaMinLocation(MinLocation.X / 100, MinLocation.Y / 100, MinLocation.Z / 100);
+  const carla::geom::Vector3D CarlaMaxLocation(MaxLocation.X / 100, MaxLocation.Y / 100, MaxLocation.Z / 100);
+
+  TSharedPtr<FTileGeometry> Geometry = MakeShared<FTileGeometry>();
+  Geometry->Tile = Tile;
+  Geometry->RoadMeshes = Map.GenerateOrderedChunkedMeshInLocations(
+      Settings.RoadParameters, CarlaMinLocation, CarlaMaxLocation);
+  Geometry->LaneMarkBatches = Map.GenerateLaneMarkBatches(
+      Settings.LaneMarkParameters, CarlaMinLocation, CarlaMaxLocation);
+  Geometry->TreeTransforms = Map.GetTreesTransform(
+      CarlaMinLocation, CarlaMaxLocation, Settings.DistanceBetweenTrees, Settings.DistanceFromRoadEdge);
+  Geometry->GenerationSeconds = FPlatformTime::Seconds() - Start;
+  return Geometry;
+}
+
+void FTileGeometryPipeline::Prefetch(
+    const carla::road::Map& Map,
+    const FTileGeometrySettings& Settings,
+    int32 QueueDepth,
+    const FIntVector& Tile,
+    const FVector& MinLocation,
+    const FVector& MaxLocation)
+{
+  if (Queue.Num() >= QueueDepth)
+  {
+    return;
+  }
+  for (const FQueuedTile& Queued : Queue)
+  {
+    if (Queued.Tile == Tile && Queued.Map == &Map)
+    {
+      return;
+    }
+  }
+  const carla::road::Map* MapPtr = &Map;
+  Queue.Add(FQueuedTile{MapPtr, Tile, Async(EAsyncExecution::ThreadPool,
+      [MapPtr, Settings, Tile, MinLocation, MaxLocation]()
+      {
+        return Generate(*MapPtr, Settings, Tile, MinLocation, MaxLocation);
+      })});
+}
+
+TSharedPtr<FTileGeometry> FTileGeometryPipeline::Take(
+    const carla::road::Map& Map,
+    const FTileGeometrySettings& Settings,
+    const FIntVector& Tile,
+    const FVector& MinLocation,
+    const FVector& MaxLocation)
+{
+  // Tiles are taken in the order they were prefetched, anything else means
+  // the sweep changed and the queue is stale
+  if (Queue.Num() > 0 && (Queue[0].Tile != Tile || Queue[0].Map != &Map))
+  {
+    Flush();
+  }
+  if (Queue.Num() == 0)
+  {
+    return Generate(Map, Settings, Tile, MinLocation, MaxLocation);
+  }
+  const double Start = FPlatformTime::Seconds();
+  TSharedPtr<FTileGeometry> Geometry = Queue[0].Geometry.Get();
+  WaitSeconds += FPlatformTime::Seconds() - Start;
+  Queue.RemoveAt(0);
+  return Geometry;
+}
+
+void FTileGeometryPipeline::Flush()
+{
+  for (FQueuedTile& Queued : Queue)
+  {
+    Queued.Geometry.Wait();
+  }
+  Queue.Empty();
+}
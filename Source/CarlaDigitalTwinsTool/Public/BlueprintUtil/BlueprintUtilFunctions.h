@@ -20,9 +20,16 @@ class CARLADIGITALTWINSTOOL_API UBlueprintUtilFunctions : public UBlueprintFunct
 
 public:
 
+  /// Copy of @a SourceObject in the plugin @a PluginName, duplicated the
+  /// first time. The copies are remembered until ClearCopiedAssets.
   UFUNCTION(BlueprintPure)
   static UObject* CopyAssetToPlugin(UObject* SourceObject, FString PluginName);
 
+  /// Forgets the copies CopyAssetToPlugin returned, e.g. after deleting the
+  /// plugin folders, so they are looked up again.
+  UFUNCTION(BlueprintCallable)
+  static void ClearCopiedAssets();
+
   UFUNCTION(BlueprintCallable)
   static FString GetProjectName();
 
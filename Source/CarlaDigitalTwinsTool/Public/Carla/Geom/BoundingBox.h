@@ -15,7 +15,9 @@
 #include <array>
 #include <algorithm>
 
+#ifndef LIBCARLA_HEADLESS
 #include "Actor/BoundingBox.h"
+#endif // LIBCARLA_HEADLESS
 
 
 namespace carla {
@@ -87,6 +87,8 @@ namespace geom {
     // -- Conversions to UE4 types ---------------------------------------------
     // =========================================================================
 
+#ifndef LIBCARLA_HEADLESS
+
     Location(const FVector &vector) // from centimeters to meters.
       : Location(1e-2f * vector.X, 1e-2f * vector.Y, 1e-2f * vector.Z) {}
 
@@ -94,6 +96,8 @@ namespace geom {
       return FVector{1e2f * x, 1e2f * y, 1e2f * z}; // from meters to centimeters.
     }
 
+#endif // LIBCARLA_HEADLESS
+
   };
 
 } // namespace geom
@@ -12,12 +12,119 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <type_traits>
 
 #include <Carla/Geom/Math.h>
 
 namespace carla {
 namespace geom {
 
+namespace {
+
+  /// Buffered writer of binary files, so that the exporters can stream a
+  /// mesh without building the whole file in memory. Values are written in
+  /// the byte order of the host, little endian on every supported platform.
+  class BinaryFileWriter {
+  public:
+
+    explicit BinaryFileWriter(const std::string &path)
+      : _file(std::fopen(path.c_str(), "wb")),
+        _buffer(new char[BufferSize]) {}
+
+    BinaryFileWriter(const BinaryFileWriter &) = delete;
+    BinaryFileWriter &operator=(const BinaryFileWriter &) = delete;
+
+    ~BinaryFileWriter() {
+      Close();
+    }
+
+    bool IsOpen() const {
+      return _file != nullptr;
+    }
+
+    void Write(const void *data, size_t size) {
+      if (_size + size > BufferSize) {
+        Flush();
+      }
+      if (size > BufferSize) {
+        _good &= std::fwrite(data, 1u, size, _file) == size;
+        return;
+      }
+      std::memcpy(_buffer.get() + _size, data, size);
+      _size += size;
+    }
+
+    void Write(const std::string &text) {
+      Write(text.data(), text.size());
+    }
+
+    template <typename T>
+    void Write(const T &value) {
+      static_assert(std::is_arithmetic<T>::value, "Only numbers are written as raw bytes");
+      Write(&value, sizeof(T));
+    }
+
+    /// Flushes and closes the file, returns whether every write succeeded.
+    bool Close() {
+      if (_file == nullptr) {
+        return false;
+      }
+      Flush();
+      _good &= std::fclose(_file) == 0;
+      _file = nullptr;
+      return _good;
+    }
+
+  private:
+
+    void Flush() {
+      if (_size != 0u) {
+        _good &= std::fwrite(_buffer.get(), 1u, _size, _file) == _size;
+        _size = 0u;
+      }
+    }
+
+    static constexpr size_t BufferSize = 1u << 16;
+
+    std::FILE *_file;
+
+    std::unique_ptr<char[]> _buffer;
+
+    size_t _size = 0u;
+
+    bool _good = true;
+  };
+
+  /// Range of indexes exported as a single glTF primitive, material -1 is
+  /// the indexes outside of every material.
+  struct IndexRange {
+    size_t first;
+    size_t count;
+    int material;
+  };
+
+  std::string EscapeJson(const std::string &text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (const char c : text) {
+      if (c == '"' || c == '\\') {
+        escaped += '\\';
+      }
+      if (static_cast<unsigned char>(c) >= 0x20u) {
+        escaped += c;
+      }
+    }
+    return escaped;
+  }
+
+} // namespace
+
   bool Mesh::IsValid() const {
     // should be at least some one vertex
     if (_vertices.empty()) {
@@ -95,10 +202,38 @@ namespace geom {
     std::copy(vertices.begin(), vertices.end(), std::back_inserter(_vertices));
   }
 
+  void Mesh::AddVertices(std::vector<Mesh::vertex_type> &&vertices) {
+    if (_vertices.empty()) {
+      _vertices = std::move(vertices);
+    } else {
+      AddVertices(vertices);
+    }
+  }
+
   void Mesh::AddNormal(normal_type normal) {
     _normals.push_back(normal);
   }
 
+  void Mesh::AddNormals(std::vector<normal_type> &&normals) {
+    if (_normals.empty()) {
+      _normals = std::move(normals);
+    } else {
+      _normals.insert(_normals.end(), normals.begin(), normals.end());
+    }
+  }
+
+  void Mesh::AddTangent(tangent_type tangent) {
+    _tangents.push_back(tangent);
+  }
+
+  void Mesh::AddTangents(std::vector<tangent_type> &&tangents) {
+    if (_tangents.empty()) {
+      _tangents = std::move(tangents);
+    } else {
+      _tangents.insert(_tangents.end(), tangents.begin(), tangents.end());
+    }
+  }
+
   void Mesh::AddIndex(index_type index) {
     _indexes.push_back(index);
   }
@@ -111,6 +246,41 @@ namespace geom {
     std::copy(uv.begin(), uv.end(), std::back_inserter(_uvs));
   }
 
+  void Mesh::AddUVs(std::vector<uv_type> &&uv) {
+    if (_uvs.empty()) {
+      _uvs = std::move(uv);
+    } else {
+      AddUVs(uv);
+    }
+  }
+
+  void Mesh::Reserve(size_t vertex_count, size_t index_count) {
+    _vertices.reserve(_vertices.size() + vertex_count);
+    _indexes.reserve(_indexes.size() + index_count);
+  }
+
+  void Mesh::ReserveToMerge(const std::vector<std::unique_ptr<Mesh>> &meshes) {
+    size_t vertex_count = 0u;
+    size_t normal_count = 0u;
+    size_t tangent_count = 0u;
+    size_t index_count = 0u;
+    size_t uv_count = 0u;
+    size_t material_count = 0u;
+    for (const auto &mesh : meshes) {
+      vertex_count += mesh->GetVerticesNum();
+      normal_count += mesh->GetNormals().size();
+      tangent_count += mesh->GetTangents().size();
+      index_count += mesh->GetIndexesNum();
+      uv_count += mesh->GetUVs().size();
+      material_count += mesh->GetMaterials().size();
+    }
+    Reserve(vertex_count, index_count);
+    _normals.reserve(_normals.size() + normal_count);
+    _tangents.reserve(_tangents.size() + tangent_count);
+    _uvs.reserve(_uvs.size() + uv_count);
+    _materials.reserve(_materials.size() + material_count);
+  }
+
   void Mesh::AddMaterial(const std::string &material_name) {
     const size_t open_index = _indexes.size();
     if (!_materials.empty()) {
@@ -144,6 +314,98 @@ namespace geom {
     _materials.back().index_end = close_index;
   }
 
+  bool Mesh::HasNormalsAndTangents() const {
+    return !_vertices.empty() &&
+        _normals.size() == _vertices.size() &&
+        _tangents.size() == _vertices.size();
+  }
+
+  void Mesh::ComputeNormalsAndTangents(
+      std::vector<normal_type> &normals,
+      std::vector<tangent_type> &tangents) const {
+    const size_t vertex_count = _vertices.size();
+    const bool has_uvs = _uvs.size() == vertex_count;
+    normals.assign(vertex_count, normal_type());
+    tangents.assign(vertex_count, tangent_type());
+
+    for (size_t i = 0u; i + 2u < _indexes.size(); i += 3u) {
+      const size_t i0 = _indexes[i] - 1u;
+      const size_t i1 = _indexes[i + 1u] - 1u;
+      const size_t i2 = _indexes[i + 2u] - 1u;
+      if (i0 >= vertex_count || i1 >= vertex_count || i2 >= vertex_count) {
+        continue;
+      }
+      const Vector3D edge1 = _vertices[i1] - _vertices[i0];
+      const Vector3D edge2 = _vertices[i2] - _vertices[i0];
+      // As long as twice the area of the triangle, so bigger ones weigh more
+      Vector3D normal = Math::Cross(edge1, edge2);
+      if (normal.z < 0.0f) {
+        normal *= -1.0f;
+      }
+
+      Vector3D tangent(1.0f, 0.0f, 0.0f);
+      if (has_uvs) {
+        const float du1 = _uvs[i1].x - _uvs[i0].x;
+        const float dv1 = _uvs[i1].y - _uvs[i0].y;
+        const float du2 = _uvs[i2].x - _uvs[i0].x;
+        const float dv2 = _uvs[i2].y - _uvs[i0].y;
+        const float determinant = du1 * dv2 - du2 * dv1;
+        if (std::abs(determinant) > std::numeric_limits<float>::epsilon()) {
+          tangent = (edge1 * dv2 - edge2 * dv1) * (1.0f / determinant);
+        }
+      }
+      tangent = tangent.MakeSafeUnitVector(std::numeric_limits<float>::epsilon()) * normal.Length();
+
+      for (const size_t vertex : {i0, i1, i2}) {
+        normals[vertex] += normal;
+        tangents[vertex] += tangent;
+      }
+    }
+
+    for (size_t v = 0u; v < vertex_count; ++v) {
+      Vector3D &normal = normals[v];
+      if (normal.SquaredLength() <= std::numeric_limits<float>::min()) {
+        normal = Vector3D(0.0f, 0.0f, 1.0f);
+      }
+      normal = normal.MakeUnitVector();
+      // Orthogonal to the normal, falling back to the X or Y axis
+      Vector3D &tangent = tangents[v];
+      tangent -= normal * Math::Dot(tangent, normal);
+      if (tangent.SquaredLength() <= 1e-12f) {
+        tangent = std::abs(normal.x) < 0.9f ? Vector3D(1.0f, 0.0f, 0.0f) : Vector3D(0.0f, 1.0f, 0.0f);
+        tangent -= normal * Math::Dot(tangent, normal);
+      }
+      tangent = tangent.MakeUnitVector();
+    }
+  }
+
+  void Mesh::ComputeNormalsAndTangents() {
+    std::vector<normal_type> normals;
+    std::vector<tangent_type> tangents;
+    ComputeNormalsAndTangents(normals, tangents);
+    _normals = std::move(normals);
+    _tangents = std::move(tangents);
+  }
+
+  void Mesh::DisplaceNormalsAndTangents(const std::vector<Vector2D> &slopes) {
+    if (!HasNormalsAndTangents() || slopes.size() != _vertices.size()) {
+      ComputeNormalsAndTangents();
+      return;
+    }
+    // z' = z + h(x, y) maps the tangents of the surface by its Jacobian and
+    // the normals by the inverse transpose, which keeps them orthogonal
+    for (size_t v = 0u; v < _vertices.size(); ++v) {
+      const Vector2D &slope = slopes[v];
+      Vector3D &normal = _normals[v];
+      normal.x -= slope.x * normal.z;
+      normal.y -= slope.y * normal.z;
+      normal = normal.MakeSafeUnitVector(std::numeric_limits<float>::epsilon());
+      Vector3D &tangent = _tangents[v];
+      tangent.z += slope.x * tangent.x + slope.y * tangent.y;
+      tangent = tangent.MakeSafeUnitVector(std::numeric_limits<float>::epsilon());
+    }
+  }
+
   std::string Mesh::GenerateOBJ() const {
     if (!IsValid()) {
       return "";
@@ -151,27 +413,27 @@ namespace geom {
     std::stringstream out;
     out << std::fixed; // Avoid using scientific notation
 
-    out << "# List of geometric vertices, with (x, y, z) coordinates." << std::endl;
+    out << "# List of geometric vertices, with (x, y, z) coordinates." << '\n';
     for (auto &v : _vertices) {
-      out << "v " << v.x << " " << v.y << " " << v.z << std::endl;
+      out << "v " << v.x << " " << v.y << " " << v.z << '\n';
     }
 
     if (!_uvs.empty()) {
-      out << std::endl << "# List of texture coordinates, in (u, v) coordinates, these will vary between 0 and 1." << std::endl;
+      out << '\n' << "# List of texture coordinates, in (u, v) coordinates, these will vary between 0 and 1." << '\n';
       for (auto &vt : _uvs) {
-        out << "vt " << vt.x << " " << vt.y << std::endl;
+        out << "vt " << vt.x << " " << vt.y << '\n';
       }
     }
 
     if (!_normals.empty()) {
-      out << std::endl << "# List of vertex normals in (x, y, z) form; normals might not be unit vectors." << std::endl;
+      out << '\n' << "# List of vertex normals in (x, y, z) form; normals might not be unit vectors." << '\n';
       for (auto &vn : _normals) {
-        out << "vn " << vn.x << " " << vn.y << " " << vn.z << std::endl;
+        out << "vn " << vn.x << " " << vn.y << " " << vn.z << '\n';
       }
     }
 
     if (!_indexes.empty()) {
-      out << std::endl << "# Polygonal face element." << std::endl;
+      out << '\n' << "# Polygonal face element." << '\n';
       auto it_m = _materials.begin();
       auto it = _indexes.begin();
       size_t index_counter = 0u;
@@ -184,14 +446,14 @@ namespace geom {
           }
           // If the current material start at this index
           if (it_m->index_start == index_counter) {
-            out << "\nusemtl " << it_m->name << std::endl;
+            out << "\nusemtl " << it_m->name << '\n';
           }
         }
 
         // Add the actual face using the 3 consecutive indices
         out << "f " << *it; ++it;
         out << " " << *it; ++it;
-        out << " " << *it << std::endl; ++it;
+        out << " " << *it << '\n'; ++it;
 
         index_counter += 3;
       }
@@ -207,14 +469,14 @@ namespace geom {
     std::stringstream out;
     out << std::fixed; // Avoid using scientific notation
 
-    out << "# List of geometric vertices, with (x, y, z) coordinates." << std::endl;
+    out << "# List of geometric vertices, with (x, y, z) coordinates." << '\n';
     for (auto &v : _vertices) {
       // Switched "y" and "z" for Recast library
-      out << "v " << v.x << " " << v.z << " " << v.y << std::endl;
+      out << "v " << v.x << " " << v.z << " " << v.y << '\n';
     }
 
     if (!_indexes.empty()) {
-      out << std::endl << "# Polygonal face element." << std::endl;
+      out << '\n' << "# Polygonal face element." << '\n';
       auto it_m = _materials.begin();
       auto it = _indexes.begin();
       size_t index_counter = 0u;
@@ -227,7 +489,7 @@ namespace geom {
           }
           // If the current material start at this index
           if (it_m->index_start == index_counter) {
-            out << "\nusemtl " << it_m->name << std::endl;
+            out << "\nusemtl " << it_m->name << '\n';
           }
         }
         // Add the actual face using the 3 consecutive indices
@@ -236,7 +498,7 @@ namespace geom {
         out << "f " << *it; ++it;
         const auto i_2 = *it; ++it;
         const auto i_3 = *it; ++it;
-        out << " " << i_3 << " " << i_2 << std::endl;
+        out << " " << i_3 << " " << i_2 << '\n';
         index_counter += 3;
       }
     }
@@ -248,11 +510,271 @@ namespace geom {
     if (!IsValid()) {
       return "Invalid Mesh";
     }
-    // Generate header
+    const bool has_normals = _normals.size() == _vertices.size();
+    const bool has_uvs = _uvs.size() == _vertices.size();
     std::stringstream out;
+    out << std::fixed; // Avoid using scientific notation
+
+    // Generate header
+    out << "ply\nformat ascii 1.0\n"
+        << "element vertex " << _vertices.size() << "\n"
+        << "property float x\nproperty float y\nproperty float z\n";
+    if (has_normals) {
+      out << "property float nx\nproperty float ny\nproperty float nz\n";
+    }
+    if (has_uvs) {
+      out << "property float s\nproperty float t\n";
+    }
+    out << "element face " << _indexes.size() / 3u << "\n"
+        << "property list uchar uint vertex_indices\n"
+        << "end_header\n";
+
+    for (size_t i = 0u; i < _vertices.size(); ++i) {
+      const auto &v = _vertices[i];
+      out << v.x << " " << v.y << " " << v.z;
+      if (has_normals) {
+        out << " " << _normals[i].x << " " << _normals[i].y << " " << _normals[i].z;
+      }
+      if (has_uvs) {
+        out << " " << _uvs[i].x << " " << _uvs[i].y;
+      }
+      out << "\n";
+    }
+    // PLY indexes start from 0
+    for (size_t i = 0u; i + 2u < _indexes.size(); i += 3u) {
+      out << "3 " << _indexes[i] - 1u << " " << _indexes[i + 1u] - 1u << " " << _indexes[i + 2u] - 1u << "\n";
+    }
     return out.str();
   }
 
+  bool Mesh::WritePLY(const std::string &path) const {
+    if (!IsValid() || _vertices.size() > std::numeric_limits<uint32_t>::max()) {
+      return false;
+    }
+    BinaryFileWriter out(path);
+    if (!out.IsOpen()) {
+      return false;
+    }
+    const bool has_normals = _normals.size() == _vertices.size();
+    const bool has_uvs = _uvs.size() == _vertices.size();
+
+    std::ostringstream header;
+    header << "ply\nformat binary_little_endian 1.0\n"
+           << "comment Units are in meters\n";
+    for (const auto &material : _materials) {
+      header << "comment material " << material.name << " faces "
+             << material.index_start / 3u << " " << material.index_end / 3u << "\n";
+    }
+    header << "element vertex " << _vertices.size() << "\n"
+           << "property float x\nproperty float y\nproperty float z\n";
+    if (has_normals) {
+      header << "property float nx\nproperty float ny\nproperty float nz\n";
+    }
+    if (has_uvs) {
+      header << "property float s\nproperty float t\n";
+    }
+    header << "element face " << _indexes.size() / 3u << "\n"
+           << "property list uchar uint vertex_indices\n"
+           << "end_header\n";
+    out.Write(header.str());
+
+    for (size_t i = 0u; i < _vertices.size(); ++i) {
+      out.Write(_vertices[i].x);
+      out.Write(_vertices[i].y);
+      out.Write(_vertices[i].z);
+      if (has_normals) {
+        out.Write(_normals[i].x);
+        out.Write(_normals[i].y);
+        out.Write(_normals[i].z);
+      }
+      if (has_uvs) {
+        out.Write(_uvs[i].x);
+        out.Write(_uvs[i].y);
+      }
+    }
+    // PLY indexes start from 0
+    for (size_t i = 0u; i + 2u < _indexes.size(); i += 3u) {
+      out.Write(static_cast<uint8_t>(3u));
+      out.Write(static_cast<uint32_t>(_indexes[i] - 1u));
+      out.Write(static_cast<uint32_t>(_indexes[i + 1u] - 1u));
+      out.Write(static_cast<uint32_t>(_indexes[i + 2u] - 1u));
+    }
+    return out.Close();
+  }
+
+  bool Mesh::WriteGLB(const std::string &path) const {
+    if (!IsValid() || _vertices.size() > std::numeric_limits<uint32_t>::max()) {
+      return false;
+    }
+    const bool has_normals = _normals.size() == _vertices.size();
+    const bool has_uvs = _uvs.size() == _vertices.size();
+
+    // A primitive per material range, and per range of faces in between
+    std::vector<std::string> material_names;
+    std::vector<IndexRange> ranges;
+    size_t cursor = 0u;
+    for (const auto &material : _materials) {
+      if (material.index_start > cursor) {
+        ranges.push_back({cursor, material.index_start - cursor, -1});
+      }
+      auto name = std::find(material_names.begin(), material_names.end(), material.name);
+      if (name == material_names.end()) {
+        name = material_names.insert(material_names.end(), material.name);
+      }
+      ranges.push_back({
+          material.index_start,
+          material.index_end - material.index_start,
+          static_cast<int>(std::distance(material_names.begin(), name))});
+      cursor = material.index_end;
+    }
+    if (cursor < _indexes.size()) {
+      ranges.push_back({cursor, _indexes.size() - cursor, -1});
+    }
+
+    // Same space as GenerateOBJForRecast, y and z switched
+    float min[3] = {
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max()};
+    float max[3] = {
+        std::numeric_limits<float>::lowest(),
+        std::numeric_limits<float>::lowest(),
+        std::numeric_limits<float>::lowest()};
+    for (const auto &v : _vertices) {
+      const float position[3] = {v.x, v.z, v.y};
+      for (int k = 0; k < 3; ++k) {
+        min[k] = std::min(min[k], position[k]);
+        max[k] = std::max(max[k], position[k]);
+      }
+    }
+
+    // Binary chunk: positions, normals, uvs and indexes, all 4 byte aligned
+    const size_t vertex_count = _vertices.size();
+    const size_t positions_size = vertex_count * 3u * sizeof(float);
+    const size_t normals_size = has_normals ? positions_size : 0u;
+    const size_t uvs_size = has_uvs ? vertex_count * 2u * sizeof(float) : 0u;
+    const size_t indexes_size = _indexes.size() * sizeof(uint32_t);
+    const size_t binary_size = positions_size + normals_size + uvs_size + indexes_size;
+
+    std::ostringstream json;
+    json << std::setprecision(std::numeric_limits<float>::max_digits10);
+    json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"carla::geom::Mesh\"},"
+         << "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+         << "\"buffers\":[{\"byteLength\":" << binary_size << "}],";
+
+    size_t view_offset = 0u;
+    int view_count = 0;
+    const auto add_view = [&](size_t size, int target) {
+      json << (view_count == 0 ? "" : ",")
+           << "{\"buffer\":0,\"byteOffset\":" << view_offset
+           << ",\"byteLength\":" << size << ",\"target\":" << target << "}";
+      view_offset += size;
+      return view_count++;
+    };
+    json << "\"bufferViews\":[";
+    const int position_view = add_view(positions_size, 34962);
+    const int normal_view = has_normals ? add_view(normals_size, 34962) : -1;
+    const int uv_view = has_uvs ? add_view(uvs_size, 34962) : -1;
+    const int index_view = indexes_size != 0u ? add_view(indexes_size, 34963) : -1;
+    json << "],";
+
+    int accessor_count = 0;
+    const auto add_accessor = [&](int view, size_t offset, int component, size_t count, const char *type) {
+      json << (accessor_count == 0 ? "" : ",")
+           << "{\"bufferView\":" << view << ",\"byteOffset\":" << offset
+           << ",\"componentType\":" << component << ",\"count\":" << count
+           << ",\"type\":\"" << type << "\"";
+      if (accessor_count == 0) {
+        json << ",\"min\":[" << min[0] << "," << min[1] << "," << min[2] << "]"
+             << ",\"max\":[" << max[0] << "," << max[1] << "," << max[2] << "]";
+      }
+      json << "}";
+      return accessor_count++;
+    };
+    json << "\"accessors\":[";
+    const int position_accessor = add_accessor(position_view, 0u, 5126, vertex_count, "VEC3");
+    const int normal_accessor = has_normals ? add_accessor(normal_view, 0u, 5126, vertex_count, "VEC3") : -1;
+    const int uv_accessor = has_uvs ? add_accessor(uv_view, 0u, 5126, vertex_count, "VEC2") : -1;
+    std::vector<int> index_accessors;
+    for (const auto &range : ranges) {
+      index_accessors.push_back(
+          add_accessor(index_view, range.first * sizeof(uint32_t), 5125, range.count, "SCALAR"));
+    }
+    json << "],";
+
+    std::ostringstream attributes;
+    attributes << "\"attributes\":{\"POSITION\":" << position_accessor;
+    if (has_normals) {
+      attributes << ",\"NORMAL\":" << normal_accessor;
+    }
+    if (has_uvs) {
+      attributes << ",\"TEXCOORD_0\":" << uv_accessor;
+    }
+    attributes << "}";
+    json << "\"meshes\":[{\"primitives\":[";
+    if (ranges.empty()) {
+      json << "{" << attributes.str() << "}";
+    }
+    for (size_t i = 0u; i < ranges.size(); ++i) {
+      json << (i == 0u ? "" : ",") << "{" << attributes.str()
+           << ",\"indices\":" << index_accessors[i];
+      if (ranges[i].material >= 0) {
+        json << ",\"material\":" << ranges[i].material;
+      }
+      json << "}";
+    }
+    json << "]}]";
+    if (!material_names.empty()) {
+      json << ",\"materials\":[";
+      for (size_t i = 0u; i < material_names.size(); ++i) {
+        json << (i == 0u ? "" : ",") << "{\"name\":\"" << EscapeJson(material_names[i]) << "\"}";
+      }
+      json << "]";
+    }
+    json << "}";
+    std::string json_chunk = json.str();
+    json_chunk.resize((json_chunk.size() + 3u) & ~size_t(3u), ' ');
+
+    BinaryFileWriter out(path);
+    if (!out.IsOpen()) {
+      return false;
+    }
+    out.Write(uint32_t(0x46546C67u)); // glTF
+    out.Write(uint32_t(2u));
+    out.Write(static_cast<uint32_t>(12u + 8u + json_chunk.size() + 8u + binary_size));
+    out.Write(static_cast<uint32_t>(json_chunk.size()));
+    out.Write(uint32_t(0x4E4F534Au)); // JSON
+    out.Write(json_chunk);
+    out.Write(static_cast<uint32_t>(binary_size));
+    out.Write(uint32_t(0x004E4942u)); // BIN
+
+    for (const auto &v : _vertices) {
+      out.Write(v.x);
+      out.Write(v.z);
+      out.Write(v.y);
+    }
+    if (has_normals) {
+      for (const auto &n : _normals) {
+        out.Write(n.x);
+        out.Write(n.z);
+        out.Write(n.y);
+      }
+    }
+    if (has_uvs) {
+      for (const auto &uv : _uvs) {
+        out.Write(uv.x);
+        out.Write(uv.y);
+      }
+    }
+    // glTF indexes start from 0, the faces are clockwise in the switched space
+    for (size_t i = 0u; i + 2u < _indexes.size(); i += 3u) {
+      out.Write(static_cast<uint32_t>(_indexes[i] - 1u));
+      out.Write(static_cast<uint32_t>(_indexes[i + 2u] - 1u));
+      out.Write(static_cast<uint32_t>(_indexes[i + 1u] - 1u));
+    }
+    return out.Close();
+  }
+
   const std::vector<Mesh::vertex_type> &Mesh::GetVertices() const {
     return _vertices;
   }
@@ -269,6 +791,14 @@ namespace geom {
     return _normals;
   }
 
+  std::vector<Mesh::normal_type> &Mesh::GetNormals() {
+    return _normals;
+  }
+
+  const std::vector<Mesh::tangent_type> &Mesh::GetTangents() const {
+    return _tangents;
+  }
+
   const std::vector<Mesh::index_type> &Mesh::GetIndexes() const {
     return _indexes;
   }
@@ -310,6 +840,11 @@ namespace geom {
       rhs.GetNormals().begin(),
       rhs.GetNormals().end());
 
+    _tangents.insert(
+      _tangents.end(),
+      rhs.GetTangents().begin(),
+      rhs.GetTangents().end());
+
     const size_t vertex_to_start_concating = v_num - num_vertices_to_link;
     for( size_t i = 1; i < num_vertices_to_link; ++i ) {
       _indexes.push_back( vertex_to_start_concating + i );
@@ -359,6 +894,11 @@ namespace geom {
         rhs.GetNormals().begin(),
         rhs.GetNormals().end());
 
+    _tangents.insert(
+        _tangents.end(),
+        rhs.GetTangents().begin(),
+        rhs.GetTangents().end());
+
     std::transform(
         rhs.GetIndexes().begin(),
         rhs.GetIndexes().end(),
@@ -383,6 +923,14 @@ namespace geom {
     return *this;
   }
 
+  Mesh &Mesh::operator+=(Mesh &&rhs) {
+    if (_vertices.empty() && _normals.empty() && _tangents.empty() &&
+        _indexes.empty() && _uvs.empty() && _materials.empty()) {
+      return *this = std::move(rhs);
+    }
+    return *this += static_cast<const Mesh &>(rhs);
+  }
+
   Mesh operator+(const Mesh &lhs, const Mesh &rhs) {
     Mesh m = lhs;
     return m += rhs;
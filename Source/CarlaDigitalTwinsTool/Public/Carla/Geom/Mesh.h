@@ -6,13 +6,17 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <string>
 #include <Carla/Geom/Vector3D.h>
 #include <Carla/Geom/Vector2D.h>
 
 
+#ifndef LIBCARLA_HEADLESS
 #include "Actor/ProceduralCustomMesh.h"
+#include "ProceduralMeshComponent.h"
+#endif // LIBCARLA_HEADLESS
 
 
 namespace carla {
@@ -44,6 +48,7 @@ namespace geom {
 
     using vertex_type = Vector3D;
     using normal_type = Vector3D;
+    using tangent_type = Vector3D;
     using index_type = size_t;
     using uv_type = Vector2D;
     using material_type = MeshMaterial;
@@ -84,9 +89,25 @@ namespace geom {
     /// Appends a vertex to the vertices list.
     void AddVertices(const std::vector<vertex_type> &vertices);
 
+    /// Appends the vertices, taking the buffer of @a vertices if the mesh has
+    /// none yet.
+    void AddVertices(std::vector<vertex_type> &&vertices);
+
     /// Appends a normal to the normal list.
     void AddNormal(normal_type normal);
 
+    /// Appends normals, taking the buffer of @a normals if the mesh has none
+    /// yet.
+    void AddNormals(std::vector<normal_type> &&normals);
+
+    /// Appends a tangent, the direction in which the U of the UVs grows, to
+    /// the tangent list.
+    void AddTangent(tangent_type tangent);
+
+    /// Appends tangents, taking the buffer of @a tangents if the mesh has
+    /// none yet.
+    void AddTangents(std::vector<tangent_type> &&tangents);
+
     /// Appends a index to the indexes list.
     void AddIndex(index_type index);
 
@@ -96,12 +117,44 @@ namespace geom {
     /// Appends uvs.
     void AddUVs(const std::vector<uv_type> & uv);
 
+    /// Appends uvs, taking the buffer of @a uv if the mesh has none yet.
+    void AddUVs(std::vector<uv_type> &&uv);
+
+    /// Reserves room for @a vertex_count more vertices and @a index_count
+    /// more indexes.
+    void Reserve(size_t vertex_count, size_t index_count);
+
+    /// Reserves room to append every mesh of @a meshes, so that merging them
+    /// with operator+= reallocates nothing.
+    void ReserveToMerge(const std::vector<std::unique_ptr<Mesh>> &meshes);
+
     /// Starts applying a new material to the new added triangles.
     void AddMaterial(const std::string &material_name);
 
     /// Stops applying the material to the new added triangles.
     void EndMaterial();
 
+    /// Whether every vertex has a normal and a tangent.
+    bool HasNormalsAndTangents() const;
+
+    /// Computes a normal and a tangent per vertex from the triangles that
+    /// use it, weighted by their area, in a single pass over the indexes.
+    /// Vertices are not welded by position, so split vertices keep the
+    /// normal of their own triangles. Normals face upwards, as the roads.
+    /// The tangents follow the U of the UVs, or the X axis if there are none.
+    void ComputeNormalsAndTangents(
+        std::vector<normal_type> &normals,
+        std::vector<tangent_type> &tangents) const;
+
+    /// Replaces the normals and tangents of the mesh with the computed ones.
+    void ComputeNormalsAndTangents();
+
+    /// Bends the normals and tangents as adding a height field to the Z of
+    /// the vertices bends the surface. @a slopes holds the derivatives of
+    /// the heights along X and Y at each vertex. A mesh without normals and
+    /// tangents gets them computed from its triangles instead.
+    void DisplaceNormalsAndTangents(const std::vector<Vector2D> &slopes);
+
     // =========================================================================
     // -- Export methods -------------------------------------------------------
     // =========================================================================
@@ -120,6 +173,19 @@ namespace geom {
     /// Units are in meters.
     std::string GeneratePLY() const;
 
+    /// Writes the mesh to @a path as binary little endian PLY, streaming it
+    /// to the file instead of building it in memory. Units are in meters.
+    /// The material ranges are listed as comments of the header. Returns
+    /// false if the mesh is not valid or the file could not be written.
+    bool WritePLY(const std::string &path) const;
+
+    /// Writes the mesh to @a path as binary glTF (GLB), streaming it to the
+    /// file instead of building it in memory, with a primitive per material
+    /// range. Units are in meters, in the Y up space of glTF, like
+    /// GenerateOBJForRecast. Returns false if the mesh is not valid or the
+    /// file could not be written.
+    bool WriteGLB(const std::string &path) const;
+
     // =========================================================================
     // -- Other methods --------------------------------------------------------
     // =========================================================================
@@ -132,6 +198,10 @@ namespace geom {
 
     const std::vector<normal_type> &GetNormals() const;
 
+    std::vector<normal_type> &GetNormals();
+
+    const std::vector<tangent_type> &GetTangents() const;
+
     const std::vector<index_type>& GetIndexes() const;
 
     std::vector<index_type> &GetIndexes();
@@ -151,75 +221,79 @@ namespace geom {
     /// Merges two meshes into a single mesh
     Mesh &operator+=(const Mesh &rhs);
 
+    /// Merges two meshes into a single mesh, taking the buffers of @a rhs if
+    /// this mesh is empty.
+    Mesh &operator+=(Mesh &&rhs);
+
     friend Mesh operator+(const Mesh &lhs, const Mesh &rhs);
 
     // =========================================================================
     // -- Conversions to UE4 types ---------------------------------------------
     // =========================================================================
 
-    operator FProceduralCustomMesh() const {
-      FProceduralCustomMesh Mesh;
+#ifndef LIBCARLA_HEADLESS
 
-      // Build the mesh
-      for (const auto Vertex : GetVertices())
+    /// Converts the mesh to Unreal, from meters to centimeters, with its
+    /// normals and tangents, or the ones computed by
+    /// ComputeNormalsAndTangents if it has none. Every array is sized up
+    /// front.
+    void ToProceduralMesh(
+        FProceduralCustomMesh &OutMesh,
+        TArray<FProcMeshTangent> &OutTangents) const {
+      const int32 VertexCount = static_cast<int32>(_vertices.size());
+      const int32 IndexCount = static_cast<int32>(_indexes.size() - _indexes.size() % 3u);
+
+      OutMesh.Vertices.SetNumUninitialized(VertexCount);
+      for (int32 i = 0; i < VertexCount; ++i)
       {
         // From meters to centimeters
-        Mesh.Vertices.Add(FVector{1e2f * Vertex.x, 1e2f * Vertex.y, 1e2f * Vertex.z});
+        const auto &Vertex = _vertices[i];
+        OutMesh.Vertices[i] = FVector{1e2f * Vertex.x, 1e2f * Vertex.y, 1e2f * Vertex.z};
       }
 
-      const auto Indexes = GetIndexes();
-      TArray<FTriIndices> TriIndices;
-      for (auto i = 0u; i < Indexes.size(); i += 3)
+      OutMesh.Triangles.SetNumUninitialized(IndexCount);
+      for (int32 i = 0; i < IndexCount; i += 3)
       {
-        FTriIndices Triangle;
         // "-1" since mesh indexes in Unreal starts from index 0.
-        Mesh.Triangles.Add(Indexes[i]     - 1);
+        OutMesh.Triangles[i]     = static_cast<int32>(_indexes[i]) - 1;
         // Since Unreal's coords are left handed, invert the last 2 indices.
-        Mesh.Triangles.Add(Indexes[i + 2] - 1);
-        Mesh.Triangles.Add(Indexes[i + 1] - 1);
+        OutMesh.Triangles[i + 1] = static_cast<int32>(_indexes[i + 2]) - 1;
+        OutMesh.Triangles[i + 2] = static_cast<int32>(_indexes[i + 1]) - 1;
+      }
 
-        Triangle.v0 = Indexes[i]     - 1;
-        Triangle.v1 = Indexes[i + 2] - 1;
-        Triangle.v2 = Indexes[i + 1] - 1;
-        TriIndices.Add(Triangle);
+      std::vector<normal_type> ComputedNormals;
+      std::vector<tangent_type> ComputedTangents;
+      if (!HasNormalsAndTangents())
+      {
+        ComputeNormalsAndTangents(ComputedNormals, ComputedTangents);
       }
+      const auto &Normals = HasNormalsAndTangents() ? _normals : ComputedNormals;
+      const auto &Tangents = HasNormalsAndTangents() ? _tangents : ComputedTangents;
 
-      // Compute the normals
-      TArray<FVector> Normals;
-      Mesh.Normals.Init(FVector::UpVector, Mesh.Vertices.Num());
-
-      for (const auto &Triangle : TriIndices) {
-        FVector Normal;
-        const FVector U = Mesh.Vertices[Triangle.v1] - Mesh.Vertices[Triangle.v0];
-        const FVector V = Mesh.Vertices[Triangle.v2] - Mesh.Vertices[Triangle.v0];
-        Normal.X = (U.Y * V.Z) - (U.Z * V.Y);
-        Normal.Y = (U.Z * V.X) - (U.X * V.Z);
-        Normal.Z = (U.X * V.Y) - (U.Y * V.X);
-        Normal = -Normal;
-        Normal = Normal.GetSafeNormal(.0001f);
-        if (Normal != FVector::ZeroVector)
-        {
-          // fix to prevent ugly x-fighting in geometries with very large curvatures,
-          // ensures that all road geometry is facing upwards
-          if (FVector::DotProduct(Normal, FVector(0,0,1)) < 0)
-          {
-            Normal = -Normal;
-          }
-          Mesh.Normals[Triangle.v0] = Normal;
-          Mesh.Normals[Triangle.v1] = Normal;
-          Mesh.Normals[Triangle.v2] = Normal;
-        }
+      OutMesh.Normals.SetNumUninitialized(VertexCount);
+      OutTangents.SetNumUninitialized(VertexCount);
+      for (int32 i = 0; i < VertexCount; ++i)
+      {
+        OutMesh.Normals[i] = FVector{Normals[i].x, Normals[i].y, Normals[i].z};
+        OutTangents[i] = FProcMeshTangent(FVector{Tangents[i].x, Tangents[i].y, Tangents[i].z}, false);
       }
 
-      for (const auto uv : GetUVs())
+      OutMesh.UV0.SetNumUninitialized(static_cast<int32>(_uvs.size()));
+      for (int32 i = 0; i < OutMesh.UV0.Num(); ++i)
       {
-        // From meters to centimeters
-        Mesh.UV0.Add(FVector2D{uv.x, uv.y});
+        OutMesh.UV0[i] = FVector2D{_uvs[i].x, _uvs[i].y};
       }
+    }
 
+    operator FProceduralCustomMesh() const {
+      FProceduralCustomMesh Mesh;
+      TArray<FProcMeshTangent> Tangents;
+      ToProceduralMesh(Mesh, Tangents);
       return Mesh;
     }
 
+#endif // LIBCARLA_HEADLESS
+
   private:
 
     // =========================================================================
@@ -230,6 +304,8 @@ namespace geom {
 
     std::vector<normal_type> _normals;
 
+    std::vector<tangent_type> _tangents;
+
     std::vector<index_type> _indexes;
 
     std::vector<uv_type> _uvs;
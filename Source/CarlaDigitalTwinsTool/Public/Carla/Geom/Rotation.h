@@ -9,7 +9,9 @@
 
 #include "Carla/Geom/Math.h"
 #include "Carla/Geom/Vector3D.h"
+#ifndef LIBCARLA_HEADLESS
 #include "Math/Rotator.h"
+#endif // LIBCARLA_HEADLESS
 
 namespace carla {
 namespace geom {
@@ -134,6 +136,8 @@ namespace geom {
     // -- Conversions to UE4 types ---------------------------------------------
     // =========================================================================
 
+#ifndef LIBCARLA_HEADLESS
+
     Rotation(const FRotator &rotator)
       : Rotation(rotator.Pitch, rotator.Yaw, rotator.Roll) {}
 
@@ -141,6 +145,8 @@ namespace geom {
       return FRotator{pitch, yaw, roll};
     }
 
+#endif // LIBCARLA_HEADLESS
+
 
   };
 
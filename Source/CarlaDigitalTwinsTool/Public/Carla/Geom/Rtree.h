@@ -30,7 +30,10 @@ namespace geom {
   /// Rtree class working with 3D point clouds.
   /// Asociates a T element with a 3D point
   /// Useful to perform fast k-NN searches
-  template <typename T, size_t Dimension = 3>
+  /// @a Parameters is the boost balancing algorithm and node size (linear,
+  /// quadratic or rstar).
+  template <typename T, size_t Dimension = 3,
+      typename Parameters = boost::geometry::index::linear<16>>
   class PointCloudRtree {
   public:
 
@@ -79,14 +82,18 @@ namespace geom {
 
   private:
 
-    boost::geometry::index::rtree<TreeElement, boost::geometry::index::linear<16>> _rtree;
+    boost::geometry::index::rtree<TreeElement, Parameters> _rtree;
 
   };
 
   /// Rtree class working with 3D segment clouds.
   /// Stores a pair of T elements (one for each end of the segment)
   /// Useful to perform fast k-NN searches.
-  template <typename T, size_t Dimension = 3>
+  /// @a Parameters is the boost balancing algorithm and node size (linear,
+  /// quadratic or rstar). It only decides the shape of the tree when the
+  /// elements are inserted one by one, BulkLoad only uses the node size.
+  template <typename T, size_t Dimension = 3,
+      typename Parameters = boost::geometry::index::linear<16>>
   class SegmentCloudRtree {
   public:
 
@@ -106,6 +113,17 @@ namespace geom {
       _rtree.insert(elements.begin(), elements.end());
     }
 
+    /// Replaces the content of the tree with @a elements, building it with
+    /// the packing algorithm, which is faster than inserting one by one.
+    void BulkLoad(const std::vector<TreeElement> &elements) {
+      _rtree = RtreeType(elements.begin(), elements.end());
+    }
+
+    /// Return all the elements stored in the tree, in no particular order.
+    std::vector<TreeElement> GetElements() const {
+      return std::vector<TreeElement>(_rtree.begin(), _rtree.end());
+    }
+
     /// Return nearest neighbors with a user defined filter.
     /// The filter reveices as an argument a TreeElement value and needs to
     /// return a bool to accept or reject the value
@@ -150,7 +168,49 @@ namespace geom {
 
   private:
 
-    boost::geometry::index::rtree<TreeElement, boost::geometry::index::linear<16>> _rtree;
+    using RtreeType = boost::geometry::index::rtree<TreeElement, Parameters>;
+
+    RtreeType _rtree;
+
+  };
+
+  /// Rtree class working with axis aligned boxes.
+  /// Asociates a T element with the box it covers
+  /// Useful to find every element overlapping a region.
+  template <typename T, size_t Dimension = 2,
+      typename Parameters = boost::geometry::index::linear<16>>
+  class BoxCloudRtree {
+  public:
+
+    typedef boost::geometry::model::point<float, Dimension, boost::geometry::cs::cartesian> BPoint;
+    typedef boost::geometry::model::box<BPoint> BBox;
+    typedef std::pair<BBox, T> TreeElement;
+
+    /// Replaces the content of the tree with @a elements, building it with
+    /// the packing algorithm.
+    void BulkLoad(const std::vector<TreeElement> &elements) {
+      _rtree = RtreeType(elements.begin(), elements.end());
+    }
+
+    /// Returns the elements whose box intersects @a box, touching
+    /// included.
+    std::vector<TreeElement> GetIntersections(const BBox &box) const {
+      std::vector<TreeElement> query_result;
+      _rtree.query(
+          boost::geometry::index::intersects(box),
+          std::back_inserter(query_result));
+      return query_result;
+    }
+
+    size_t GetTreeSize() const {
+      return _rtree.size();
+    }
+
+  private:
+
+    using RtreeType = boost::geometry::index::rtree<TreeElement, Parameters>;
+
+    RtreeType _rtree;
 
   };
 
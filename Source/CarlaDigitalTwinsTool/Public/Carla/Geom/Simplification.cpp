@@ -5,51 +5,490 @@
 // For a copy, see <https://opensource.org/licenses/MIT>.
 
 #include "Carla/Geom/Simplification.h"
-#include "Carla/Simplify/Simplify.h"
+#include "Carla/WorkStealingPool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
 
 namespace carla {
 namespace geom {
 
-  void Simplification::Simplificate(const std::unique_ptr<geom::Mesh>& pmesh){
-    Simplify::SimplificationObject Simplification;
-    for (carla::geom::Vector3D& current_vertex : pmesh->GetVertices()) {
-      Simplify::Vertex v;
-      v.p.x = current_vertex.x;
-      v.p.y = current_vertex.y;
-      v.p.z = current_vertex.z;
-      Simplification.vertices.push_back(v);
+namespace {
+
+  /// Symmetric 4x4 matrix giving the sum of the squared distances of a point
+  /// to a set of planes.
+  struct Quadric {
+
+    double aa = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double bb = 0.0, bc = 0.0, bd = 0.0;
+    double cc = 0.0, cd = 0.0;
+    double dd = 0.0;
+
+    /// Plane a*x + b*y + c*z + d = 0, with (a, b, c) normalized.
+    static Quadric FromPlane(double a, double b, double c, double d, double weight) {
+      Quadric q;
+      q.aa = weight * a * a; q.ab = weight * a * b; q.ac = weight * a * c; q.ad = weight * a * d;
+      q.bb = weight * b * b; q.bc = weight * b * c; q.bd = weight * b * d;
+      q.cc = weight * c * c; q.cd = weight * c * d;
+      q.dd = weight * d * d;
+      return q;
+    }
+
+    Quadric &operator+=(const Quadric &rhs) {
+      aa += rhs.aa; ab += rhs.ab; ac += rhs.ac; ad += rhs.ad;
+      bb += rhs.bb; bc += rhs.bc; bd += rhs.bd;
+      cc += rhs.cc; cd += rhs.cd;
+      dd += rhs.dd;
+      return *this;
+    }
+
+    /// Error of @a lhs + @a rhs at @a p.
+    static double Evaluate(const Quadric &lhs, const Quadric &rhs, const Vector3D &p) {
+      const double x = p.x, y = p.y, z = p.z;
+      const double error =
+          (lhs.aa + rhs.aa) * x * x + 2.0 * (lhs.ab + rhs.ab) * x * y +
+          2.0 * (lhs.ac + rhs.ac) * x * z + 2.0 * (lhs.ad + rhs.ad) * x +
+          (lhs.bb + rhs.bb) * y * y + 2.0 * (lhs.bc + rhs.bc) * y * z +
+          2.0 * (lhs.bd + rhs.bd) * y +
+          (lhs.cc + rhs.cc) * z * z + 2.0 * (lhs.cd + rhs.cd) * z +
+          (lhs.dd + rhs.dd);
+      return std::max(0.0, error);
+    }
+  };
+
+  /// Moving vertex @a from onto its neighbour @a to. @a stamp tells whether
+  /// the neighbourhood of @a from changed since it was computed.
+  struct Collapse {
+
+    double cost;
+
+    uint32_t from;
+
+    uint32_t to;
+
+    uint32_t stamp;
+
+    bool operator>(const Collapse &rhs) const {
+      return cost != rhs.cost ? cost > rhs.cost : from > rhs.from;
+    }
+  };
+
+  /// Half edge collapses of a mesh ordered by a binary heap. Every vertex
+  /// that can be removed keeps a single entry with its cheapest valid
+  /// collapse; after a collapse only the entries of the vertices around it
+  /// are recomputed, the outdated ones are skipped when popped.
+  class EdgeCollapser {
+  public:
+
+    explicit EdgeCollapser(const Mesh &mesh)
+      : _positions(mesh.GetVertices()) {
+      const auto &indexes = mesh.GetIndexes();
+      const size_t vertex_count = _positions.size();
+      const size_t triangle_count = indexes.size() / 3u;
+
+      _triangles.resize(triangle_count);
+      _alive.assign(triangle_count, 0u);
+      _materials.assign(triangle_count, -1);
+      const auto &materials = mesh.GetMaterials();
+      for (size_t m = 0u; m < materials.size(); ++m) {
+        const size_t end = std::min(triangle_count,
+            (materials[m].index_end != 0u ? materials[m].index_end : indexes.size()) / 3u);
+        for (size_t t = materials[m].index_start / 3u; t < end; ++t) {
+          _materials[t] = static_cast<int32_t>(m);
+        }
+      }
+
+      // Triangles out of range or with a repeated vertex are dropped
+      for (size_t t = 0u; t < triangle_count; ++t) {
+        auto &triangle = _triangles[t];
+        bool valid = true;
+        for (size_t k = 0u; k < 3u; ++k) {
+          const size_t index = indexes[3u * t + k];
+          valid = valid && index >= 1u && index <= vertex_count;
+          triangle[k] = valid ? static_cast<uint32_t>(index - 1u) : 0u;
+        }
+        if (valid && triangle[0] != triangle[1] && triangle[1] != triangle[2] &&
+            triangle[0] != triangle[2]) {
+          _alive[t] = 1u;
+          ++_alive_count;
+        }
+      }
+
+      _quadrics.resize(vertex_count);
+      _locked.assign(vertex_count, 0u);
+      _removed.assign(vertex_count, 0u);
+      _stamps.assign(vertex_count, 0u);
+      _marks.assign(vertex_count, 0u);
+      _vertex_triangles.resize(vertex_count);
+
+      std::vector<uint32_t> triangle_counts(vertex_count, 0u);
+      std::vector<int32_t> vertex_materials(vertex_count, std::numeric_limits<int32_t>::min());
+      std::vector<std::pair<uint32_t, uint32_t>> edges;
+      edges.reserve(3u * _alive_count);
+      for (size_t t = 0u; t < triangle_count; ++t) {
+        if (!_alive[t]) {
+          continue;
+        }
+        const auto &triangle = _triangles[t];
+        const Vector3D &p0 = _positions[triangle[0]];
+        const Vector3D &p1 = _positions[triangle[1]];
+        const Vector3D &p2 = _positions[triangle[2]];
+        const std::array<double, 3> normal = Normal(p0, p1, p2);
+        const double length = std::sqrt(
+            normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        Quadric quadric;
+        if (length > 0.0) {
+          const double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+          quadric = Quadric::FromPlane(a, b, c, -(a * p0.x + b * p0.y + c * p0.z), 0.5 * length);
+        }
+        for (size_t k = 0u; k < 3u; ++k) {
+          const uint32_t vertex = triangle[k];
+          _quadrics[vertex] += quadric;
+          ++triangle_counts[vertex];
+          if (vertex_materials[vertex] == std::numeric_limits<int32_t>::min()) {
+            vertex_materials[vertex] = _materials[t];
+          } else if (vertex_materials[vertex] != _materials[t]) {
+            _locked[vertex] = 1u;
+          }
+          const uint32_t next = triangle[(k + 1u) % 3u];
+          edges.emplace_back(std::min(vertex, next), std::max(vertex, next));
+        }
+      }
+
+      // Edges not shared by exactly two triangles are borders, UV seams or
+      // non manifold
+      std::sort(edges.begin(), edges.end());
+      for (size_t i = 0u; i < edges.size();) {
+        size_t j = i + 1u;
+        while (j < edges.size() && edges[j] == edges[i]) {
+          ++j;
+        }
+        if (j - i != 2u) {
+          _locked[edges[i].first] = 1u;
+          _locked[edges[i].second] = 1u;
+        }
+        i = j;
+      }
+
+      for (size_t v = 0u; v < vertex_count; ++v) {
+        _vertex_triangles[v].reserve(triangle_counts[v]);
+      }
+      for (size_t t = 0u; t < triangle_count; ++t) {
+        if (_alive[t]) {
+          for (uint32_t vertex : _triangles[t]) {
+            _vertex_triangles[vertex].push_back(static_cast<uint32_t>(t));
+          }
+        }
+      }
+    }
+
+    /// Collapses edges until at most @a target_triangles are left or no
+    /// valid collapse remains.
+    void Run(size_t target_triangles) {
+      if (_alive_count <= target_triangles) {
+        return;
+      }
+      std::vector<Collapse> heap_storage;
+      heap_storage.reserve(_positions.size());
+      _heap = Heap(std::greater<Collapse>(), std::move(heap_storage));
+      for (size_t v = 0u; v < _positions.size(); ++v) {
+        if (!_locked[v] && !_vertex_triangles[v].empty()) {
+          UpdateCollapse(static_cast<uint32_t>(v));
+        }
+      }
+      std::vector<uint32_t> affected;
+      while (_alive_count > target_triangles && !_heap.empty()) {
+        const Collapse collapse = _heap.top();
+        _heap.pop();
+        if (_removed[collapse.from] || collapse.stamp != _stamps[collapse.from]) {
+          continue;
+        }
+        Neighbours(collapse.from, _neighbours);
+        if (!IsValid(collapse.from, collapse.to, _neighbours)) {
+          UpdateCollapse(collapse.from, true);
+          continue;
+        }
+        Apply(collapse.from, collapse.to);
+        Neighbours(collapse.to, affected);
+        if (!_locked[collapse.to]) {
+          UpdateCollapse(collapse.to);
+        }
+        for (uint32_t vertex : affected) {
+          if (!_locked[vertex]) {
+            UpdateCollapse(vertex);
+          }
+        }
+      }
+      _heap = Heap();
+    }
+
+    /// Returns the simplified copy of @a mesh, the one this was built from.
+    Mesh Build(const Mesh &mesh) const {
+      const size_t vertex_count = _positions.size();
+      std::vector<uint32_t> remap(vertex_count, std::numeric_limits<uint32_t>::max());
+      for (size_t t = 0u; t < _triangles.size(); ++t) {
+        if (_alive[t]) {
+          for (uint32_t vertex : _triangles[t]) {
+            remap[vertex] = 0u;
+          }
+        }
+      }
+      const bool has_normals = mesh.GetNormals().size() == vertex_count;
+      const bool has_tangents = mesh.GetTangents().size() == vertex_count;
+      const bool has_uvs = mesh.GetUVs().size() == vertex_count;
+      std::vector<Mesh::vertex_type> vertices;
+      std::vector<Mesh::normal_type> normals;
+      std::vector<Mesh::tangent_type> tangents;
+      std::vector<Mesh::uv_type> uvs;
+      uint32_t next_vertex = 0u;
+      for (size_t v = 0u; v < vertex_count; ++v) {
+        if (remap[v] == 0u) {
+          remap[v] = next_vertex++;
+          vertices.push_back(_positions[v]);
+          if (has_normals) {
+            normals.push_back(mesh.GetNormals()[v]);
+          }
+          if (has_tangents) {
+            tangents.push_back(mesh.GetTangents()[v]);
+          }
+          if (has_uvs) {
+            uvs.push_back(mesh.GetUVs()[v]);
+          }
+        }
+      }
+
+      Mesh out(vertices, normals, {}, uvs);
+      out.AddTangents(std::move(tangents));
+      out.Reserve(0u, 3u * _alive_count);
+      auto add_triangles = [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; ++t) {
+          if (_alive[t]) {
+            for (uint32_t vertex : _triangles[t]) {
+              out.AddIndex(remap[vertex] + 1u);
+            }
+          }
+        }
+      };
+      // The material ranges are kept in the same order, without the ones
+      // left empty
+      const size_t triangle_count = _triangles.size();
+      size_t next = 0u;
+      for (const auto &material : mesh.GetMaterials()) {
+        const size_t start = std::max(next, std::min(triangle_count, material.index_start / 3u));
+        const size_t end = std::max(start, std::min(triangle_count,
+            (material.index_end != 0u ? material.index_end : 3u * triangle_count) / 3u));
+        add_triangles(next, start);
+        if (std::any_of(_alive.begin() + start, _alive.begin() + end, [](uint8_t a) { return a != 0u; })) {
+          out.AddMaterial(material.name);
+          add_triangles(start, end);
+          out.EndMaterial();
+        }
+        next = end;
+      }
+      add_triangles(next, triangle_count);
+      return out;
     }
 
-    for (size_t i = 0; i < pmesh->GetIndexes().size() - 2; i += 3) {
-      Simplify::Triangle t;
-      t.material = 0;
-      auto indices = pmesh->GetIndexes();
-      t.v[0] = (indices[i]) - 1;
-      t.v[1] = (indices[i + 1]) - 1;
-      t.v[2] = (indices[i + 2]) - 1;
-      Simplification.triangles.push_back(t);
+  private:
+
+    using Heap = std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>>;
+
+    static constexpr double EdgeLengthWeight = 1e-4;
+
+    static std::array<double, 3> Normal(const Vector3D &p0, const Vector3D &p1, const Vector3D &p2) {
+      const double ux = p1.x - p0.x, uy = p1.y - p0.y, uz = p1.z - p0.z;
+      const double vx = p2.x - p0.x, vy = p2.y - p0.y, vz = p2.z - p0.z;
+      return {uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx};
+    }
+
+    bool Contains(uint32_t triangle, uint32_t vertex) const {
+      const auto &t = _triangles[triangle];
+      return t[0] == vertex || t[1] == vertex || t[2] == vertex;
+    }
+
+    /// Neighbours of @a vertex, in no particular order. Drops the removed
+    /// triangles from its list on the way.
+    void Neighbours(uint32_t vertex, std::vector<uint32_t> &out) {
+      auto &triangles = _vertex_triangles[vertex];
+      triangles.erase(
+          std::remove_if(triangles.begin(), triangles.end(), [this](uint32_t t) { return !_alive[t]; }),
+          triangles.end());
+      out.clear();
+      const uint32_t mark = NextMark();
+      for (uint32_t t : triangles) {
+        for (uint32_t other : _triangles[t]) {
+          if (other != vertex && _marks[other] != mark) {
+            _marks[other] = mark;
+            out.push_back(other);
+          }
+        }
+      }
     }
 
-    // Reduce to the X% of the polys
-    float target_size = Simplification.triangles.size();
-    Simplification.simplify_mesh((target_size * simplification_percentage));
+    /// Whether moving @a from onto @a to keeps the surface manifold and
+    /// doesn't fold any triangle. @a from_neighbours are the neighbours of
+    /// @a from.
+    bool IsValid(uint32_t from, uint32_t to, const std::vector<uint32_t> &from_neighbours) {
+      // Link condition, both vertices share only the two opposite vertices
+      // of the edge
+      const uint32_t neighbour_mark = NextMark();
+      for (uint32_t vertex : from_neighbours) {
+        _marks[vertex] = neighbour_mark;
+      }
+      const uint32_t shared_mark = NextMark();
+      size_t shared = 0u;
+      for (uint32_t t : _vertex_triangles[to]) {
+        if (!_alive[t]) {
+          continue;
+        }
+        for (uint32_t vertex : _triangles[t]) {
+          if (vertex != to && _marks[vertex] == neighbour_mark) {
+            _marks[vertex] = shared_mark;
+            ++shared;
+          }
+        }
+      }
+      if (shared != 2u) {
+        return false;
+      }
 
-    pmesh->GetVertices().clear();
-    pmesh->GetIndexes().clear();
+      const Vector3D &target = _positions[to];
+      for (uint32_t t : _vertex_triangles[from]) {
+        if (!_alive[t] || Contains(t, to)) {
+          continue;
+        }
+        const auto &triangle = _triangles[t];
+        std::array<const Vector3D *, 3> moved;
+        for (size_t k = 0u; k < 3u; ++k) {
+          moved[k] = triangle[k] == from ? &target : &_positions[triangle[k]];
+        }
+        const auto before = Normal(
+            _positions[triangle[0]], _positions[triangle[1]], _positions[triangle[2]]);
+        const auto after = Normal(*moved[0], *moved[1], *moved[2]);
+        const double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        const double lengths = std::sqrt(
+            (before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+            (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+        if (dot <= 0.2 * lengths) {
+          return false;
+        }
+      }
+      return true;
+    }
 
-    for (Simplify::Vertex& current_vertex : Simplification.vertices) {
-      carla::geom::Vector3D v;
-      v.x = current_vertex.p.x;
-      v.y = current_vertex.p.y;
-      v.z = current_vertex.p.z;
-      pmesh->AddVertex(v);
+    /// Pushes the cheapest collapse of @a vertex, invalidating the one it
+    /// had. Most of the pushed collapses are outdated before they are
+    /// popped, so unless @a validate they are only checked when popped.
+    void UpdateCollapse(uint32_t vertex, bool validate = false) {
+      const uint32_t stamp = ++_stamps[vertex];
+      Neighbours(vertex, _neighbours);
+      double best_cost = std::numeric_limits<double>::max();
+      uint32_t best_to = vertex;
+      for (uint32_t to : _neighbours) {
+        // The length of the edge breaks the ties of flat areas, collapsing
+        // always onto the same vertex would make it a fan of thin triangles
+        const double cost =
+            Quadric::Evaluate(_quadrics[vertex], _quadrics[to], _positions[to]) +
+            EdgeLengthWeight * (_positions[to] - _positions[vertex]).SquaredLength();
+        if ((cost < best_cost || (cost == best_cost && to < best_to)) &&
+            (!validate || IsValid(vertex, to, _neighbours))) {
+          best_cost = cost;
+          best_to = to;
+        }
+      }
+      if (best_to != vertex) {
+        _heap.push({best_cost, vertex, best_to, stamp});
+      }
     }
 
-    for (size_t i = 0; i < Simplification.triangles.size(); ++i) {
-      pmesh->GetIndexes().push_back((Simplification.triangles[i].v[0]) + 1);
-      pmesh->GetIndexes().push_back((Simplification.triangles[i].v[1]) + 1);
-      pmesh->GetIndexes().push_back((Simplification.triangles[i].v[2]) + 1);
+    uint32_t NextMark() {
+      if (++_mark == 0u) {
+        std::fill(_marks.begin(), _marks.end(), 0u);
+        _mark = 1u;
+      }
+      return _mark;
     }
+
+    void Apply(uint32_t from, uint32_t to) {
+      _quadrics[to] += _quadrics[from];
+      _removed[from] = 1u;
+      auto &to_triangles = _vertex_triangles[to];
+      for (uint32_t t : _vertex_triangles[from]) {
+        if (!_alive[t]) {
+          continue;
+        }
+        if (Contains(t, to)) {
+          _alive[t] = 0u;
+          --_alive_count;
+        } else {
+          for (uint32_t &vertex : _triangles[t]) {
+            if (vertex == from) {
+              vertex = to;
+            }
+          }
+          to_triangles.push_back(t);
+        }
+      }
+      _vertex_triangles[from].clear();
+    }
+
+    const std::vector<Vector3D> &_positions;
+
+    std::vector<std::array<uint32_t, 3>> _triangles;
+
+    std::vector<uint8_t> _alive;
+
+    size_t _alive_count = 0u;
+
+    /// Index of the material range of each triangle, -1 if none.
+    std::vector<int32_t> _materials;
+
+    std::vector<Quadric> _quadrics;
+
+    std::vector<uint8_t> _locked;
+
+    std::vector<uint8_t> _removed;
+
+    std::vector<uint32_t> _stamps;
+
+    std::vector<std::vector<uint32_t>> _vertex_triangles;
+
+    Heap _heap;
+
+    std::vector<uint32_t> _neighbours;
+
+    /// Visited flags of the vertices, the ones equal to _mark are set.
+    std::vector<uint32_t> _marks;
+
+    uint32_t _mark = 0u;
+  };
+
+} // namespace
+
+  void Simplification::Simplificate(const std::unique_ptr<geom::Mesh>& pmesh) const {
+    if (pmesh == nullptr || pmesh->GetIndexes().size() < 3u) {
+      return;
+    }
+    const float ratio = std::min(std::max(simplification_percentage, 0.0f), 1.0f);
+    EdgeCollapser collapser(*pmesh);
+    collapser.Run(static_cast<size_t>(
+        static_cast<float>(pmesh->GetIndexes().size() / 3u) * ratio));
+    *pmesh = collapser.Build(*pmesh);
+  }
+
+  void Simplification::Simplificate(
+      const std::vector<std::unique_ptr<geom::Mesh>>& meshes,
+      size_t worker_count) const {
+    WorkStealingPool pool(worker_count);
+    pool.ParallelFor(meshes.size(), [&](size_t i, size_t) {
+      Simplificate(meshes[i]);
+    });
   }
 
 } // namespace geom
@@ -8,10 +8,20 @@
 
 #include "Carla/Geom/Mesh.h"
 #include <memory>
+#include <vector>
 
 namespace carla {
 namespace geom {
 
+  /// Reduces the triangles of meshes by collapsing their edges, cheapest
+  /// first according to the quadric error of the surface they belong to.
+  ///
+  /// A vertex is only ever collapsed onto one of its neighbours, so the
+  /// remaining vertices keep their position, normal, tangent and UV.
+  /// Vertices on the open borders of the mesh, on UV seams (split vertices)
+  /// and between triangles of different materials are never removed, so the
+  /// material ranges are kept and meshes that share a border still match
+  /// after being simplified separately.
   class Simplification {
   public:
 
@@ -21,9 +31,16 @@ namespace geom {
       : simplification_percentage(simplificationrate)
       {}
 
+    /// Fraction of the triangles to keep, in [0, 1].
     float simplification_percentage;
 
-    void Simplificate(const std::unique_ptr<geom::Mesh>& pmesh);
+    void Simplificate(const std::unique_ptr<geom::Mesh>& pmesh) const;
+
+    /// Simplifies every mesh of @a meshes, several of them at the same time
+    /// on @a worker_count threads (all the hardware concurrency if zero).
+    void Simplificate(
+        const std::vector<std::unique_ptr<geom::Mesh>>& meshes,
+        size_t worker_count = 0u) const;
   };
 
 } // namespace geom
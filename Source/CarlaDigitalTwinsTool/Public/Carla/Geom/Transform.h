@@ -12,7 +12,9 @@
 
 #include <array>
 
+#ifndef LIBCARLA_HEADLESS
 #include "Math/Transform.h"
+#endif // LIBCARLA_HEADLESS
 
 
 namespace carla {
@@ -149,6 +151,8 @@ namespace geom {
     // -- Conversions to UE4 types ---------------------------------------------
     // =========================================================================
 
+#ifndef LIBCARLA_HEADLESS
+
     Transform(const FTransform &transform)
       : Transform(Location(transform.GetLocation()), Rotation(transform.Rotator())) {}
 
@@ -157,6 +161,8 @@ namespace geom {
       return FTransform{FRotator(rotation), FVector(location), scale};
     }
 
+#endif // LIBCARLA_HEADLESS
+
   };
 
 } // namespace geom
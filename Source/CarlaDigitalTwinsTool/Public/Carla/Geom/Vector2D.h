@@ -137,10 +137,14 @@ namespace geom {
       return *this * 1e2f;
     }
 
+#ifndef LIBCARLA_HEADLESS
+
     FVector2D ToFVector2D() const {
       return FVector2D{x, y};
     }
 
+#endif // LIBCARLA_HEADLESS
+
   };
 
 } // namespace geom
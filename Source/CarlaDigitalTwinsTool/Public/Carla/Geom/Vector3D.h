@@ -161,12 +161,16 @@ namespace geom {
     // =========================================================================
 
 
+#ifndef LIBCARLA_HEADLESS
+
     /// These 2 methods are explicitly deleted to avoid creating them by other users,
     /// unlike locations, some vectors have units and some don't, by removing
     /// these methods we found several places were the conversion from cm to m was missing
     Vector3D(const FVector &v) = delete;
     Vector3D& operator=(const FVector &rhs) = delete;
 
+#endif // LIBCARLA_HEADLESS
+
     /// Return a Vector3D converted from centimeters to meters.
     Vector3D ToMeters() const {
       return *this * 1e-2f;
@@ -177,10 +181,14 @@ namespace geom {
       return *this * 1e2f;
     }
 
+#ifndef LIBCARLA_HEADLESS
+
     FVector ToFVector() const {
       return FVector{x, y, z};
     }
 
+#endif // LIBCARLA_HEADLESS
+
     // =========================================================================
   };
 
@@ -127,9 +127,13 @@ namespace geom {
     // -- Conversions to UE4 types ---------------------------------------------
     // =========================================================================
 
+#ifndef LIBCARLA_HEADLESS
+
     Vector3DInt(const FIntVector &v) = delete;
     Vector3DInt& operator=(const FIntVector &rhs) = delete;
 
+#endif // LIBCARLA_HEADLESS
+
     /// Return a Vector3DInt converted from centimeters to meters.
     Vector3DInt ToMeters() const {
       return *this / 100;
@@ -140,10 +144,14 @@ namespace geom {
       return *this * 100;
     }
 
+#ifndef LIBCARLA_HEADLESS
+
     FIntVector ToFIntVector() const {
       return FIntVector{x, y, z};
     }
 
+#endif // LIBCARLA_HEADLESS
+
   };
 
 } // namespace geom
@@ -15,6 +15,10 @@ namespace MeshReconstruction
     // If it exists, vertex on edge i is stored at position i.
     // For edge numbering and location see numberings.png.
     std::array<Vec3, 12> edgeVertIndices;
+
+    // For each vertex in edgeVertIndices, the cube vertex (0 - 7) it was
+    // snapped to, or -1 if it was interpolated along the edge.
+    std::array<int, 12> edgeVertCorners;
   };
 
   class Cube
@@ -22,14 +26,21 @@ namespace MeshReconstruction
     Vec3 pos[8];
     double sdf[8];
 
-    Vec3 LerpVertex(double isoLevel, int i1, int i2) const;
+    Vec3 LerpVertex(double isoLevel, int i1, int i2, int &snappedCorner) const;
     int SignConfig(double isoLevel) const;
 
   public:
     Cube(Rect3 const &space, Fun3s const &sdf);
 
+    // Build the cube from already sampled values, in the same corner order
+    // as pos.
+    Cube(Rect3 const &space, std::array<double, 8> const &sdfValues);
+
     // Find the vertices where the surface intersects the cube.
     IntersectInfo Intersect(double isoLevel = 0) const;
+
+    // Gradient of the trilinear interpolation of the corner values at p.
+    Vec3 Gradient(Vec3 const &p) const;
   };
 
   namespace Marching
@@ -95,7 +106,7 @@ namespace MeshReconstruction
     };
   }
 
-  Vec3 Cube::LerpVertex(double isoLevel, int i1, int i2) const
+  Vec3 Cube::LerpVertex(double isoLevel, int i1, int i2, int &snappedCorner) const
   {
     auto const Eps = 1e-5;
     auto const v1 = sdf[i1];
@@ -103,13 +114,17 @@ namespace MeshReconstruction
     auto const &p1 = pos[i1];
     auto const &p2 = pos[i2];
 
+    snappedCorner = i1;
     if (abs(isoLevel - v1) < Eps)
       return p1;
+    snappedCorner = i2;
     if (abs(isoLevel - v2) < Eps)
       return p2;
+    snappedCorner = i1;
     if (abs(v1 - v2) < Eps)
       return p1;
 
+    snappedCorner = -1;
     auto mu = (isoLevel - v1) / (v2 - v1);
     return p1 + (p2 - p1) * mu;
   }
@@ -142,6 +157,54 @@ namespace MeshReconstruction
     }
   }
 
+  Cube::Cube(Rect3 const &space, std::array<double, 8> const &sdfValues)
+  {
+    auto mx = space.min.x;
+    auto my = space.min.y;
+    auto mz = space.min.z;
+
+    auto sx = space.size.x;
+    auto sy = space.size.y;
+    auto sz = space.size.z;
+
+    pos[0] = space.min;
+    pos[1] = {mx + sx, my, mz};
+    pos[2] = {mx + sx, my, mz + sz};
+    pos[3] = {mx, my, mz + sz};
+    pos[4] = {mx, my + sy, mz};
+    pos[5] = {mx + sx, my + sy, mz};
+    pos[6] = {mx + sx, my + sy, mz + sz};
+    pos[7] = {mx, my + sy, mz + sz};
+
+    for (auto i = 0; i < 8; ++i)
+    {
+      auto sd = sdfValues[i];
+      if (sd == 0)
+        sd += 1e-6;
+      this->sdf[i] = sd;
+    }
+  }
+
+  Vec3 Cube::Gradient(Vec3 const &p) const
+  {
+    auto const size = pos[6] - pos[0];
+    auto const tx = (p.x - pos[0].x) / size.x;
+    auto const ty = (p.y - pos[0].y) / size.y;
+    auto const tz = (p.z - pos[0].z) / size.z;
+
+    // Corner values named by their (x, y, z) offsets.
+    auto const c000 = sdf[0], c100 = sdf[1], c101 = sdf[2], c001 = sdf[3];
+    auto const c010 = sdf[4], c110 = sdf[5], c111 = sdf[6], c011 = sdf[7];
+
+    auto gx = (1 - ty) * (1 - tz) * (c100 - c000) + ty * (1 - tz) * (c110 - c010) +
+              (1 - ty) * tz * (c101 - c001) + ty * tz * (c111 - c011);
+    auto gy = (1 - tx) * (1 - tz) * (c010 - c000) + tx * (1 - tz) * (c110 - c100) +
+              (1 - tx) * tz * (c011 - c001) + tx * tz * (c111 - c101);
+    auto gz = (1 - tx) * (1 - ty) * (c001 - c000) + tx * (1 - ty) * (c101 - c100) +
+              (1 - tx) * ty * (c011 - c010) + tx * ty * (c111 - c110);
+    return {gx / size.x, gy / size.y, gz / size.z};
+  }
+
   int Cube::SignConfig(double isoLevel) const
   {
     auto edgeIndex = 0;
@@ -166,6 +229,7 @@ namespace MeshReconstruction
 
     IntersectInfo intersect;
     intersect.signConfig = SignConfig(iso);
+    intersect.edgeVertCorners.fill(-1);
 
     for (auto e = 0; e < 12; ++e)
     {
@@ -173,7 +237,7 @@ namespace MeshReconstruction
       {
         auto v0 = Marching::edges[e].vert0;
         auto v1 = Marching::edges[e].vert1;
-        auto vert = LerpVertex(iso, v0, v1);
+        auto vert = LerpVertex(iso, v0, v1, intersect.edgeVertCorners[e]);
         intersect.edgeVertIndices[e] = vert;
       }
     }
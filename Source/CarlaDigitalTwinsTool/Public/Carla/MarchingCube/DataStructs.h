@@ -52,5 +52,8 @@ namespace MeshReconstruction
   };
 
   using Fun3s = std::function<double(Vec3 const &)>;
+  /// Evaluates a scalar field at every position of the first argument into
+  /// the second one.
+  using Fun3sBatch = std::function<void(std::vector<Vec3> const &, std::vector<double> &)>;
   using Fun3v = std::function<Vec3(Vec3 const &)>;
 }
\ No newline at end of file
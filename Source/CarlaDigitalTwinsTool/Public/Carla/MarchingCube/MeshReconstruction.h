@@ -2,6 +2,9 @@
 #include "DataStructs.h"
 #include "Cube.h"
 #include "Triangulation.h"
+#include "Carla/WorkStealingPool.h"
+
+#include <cstdint>
 
 namespace MeshReconstruction
 {
@@ -26,6 +29,36 @@ namespace MeshReconstruction
       Vec3 const &cubeSize,
       double isoLevel = 0,
       Fun3v sdfGrad = nullptr);
+
+  /// Same as MarchCube, but the SDF is sampled once per cube center and once
+  /// per grid vertex of the cubes in the narrow band around the surface,
+  /// instead of 9 times per cube. The samples are taken in parallel on
+  /// @a pool if given, so @a sdf must be thread safe, and serially otherwise;
+  /// leave it null when calling from a job of another pool. Normals are
+  /// computed from the sampled values instead of calling the SDF again.
+  /// Vertices are shared between the triangles of neighbouring cubes, keyed
+  /// by the grid edge they lie on (or the grid vertex they were snapped to).
+  /// @param sdf The <a href="http://www.iquilezles.org/www/articles/distfunctions/distfunctions.htm">Signed Distance Function</a>.
+  /// @param domain Domain of reconstruction.
+  /// @param cubeSize Size of marching cubes. Smaller cubes yields meshes of higher resolution.
+  /// @param isoLevel Level set of the SDF for which triangulation should be done.
+  /// @param pool Pool to sample the SDF on.
+  /// @returns The reconstructed mesh.
+  Mesh MarchCubeGrid(
+      Fun3s const &sdf,
+      Rect3 const &domain,
+      Vec3 const &cubeSize,
+      double isoLevel = 0,
+      carla::WorkStealingPool *pool = nullptr);
+
+  /// Same as MarchCubeGrid, but @a sdf is called twice with all the
+  /// positions to sample, first the cube centers and then the grid vertices
+  /// of the narrow band, so that it can evaluate them in batch.
+  Mesh MarchCubeGrid(
+      Fun3sBatch const &sdf,
+      Rect3 const &domain,
+      Vec3 const &cubeSize,
+      double isoLevel = 0);
 }
 
 using namespace MeshReconstruction;
@@ -104,3 +137,159 @@ Mesh MeshReconstruction::MarchCube(
 
   return mesh;
 }
+
+Mesh MeshReconstruction::MarchCubeGrid(
+    Fun3s const &sdf,
+    Rect3 const &domain,
+    Vec3 const &cubeSize,
+    double isoLevel,
+    carla::WorkStealingPool *pool)
+{
+  auto batch = [&](std::vector<Vec3> const &positions, std::vector<double> &values)
+  {
+    values.resize(positions.size());
+    if (pool == nullptr)
+    {
+      for (size_t i = 0u; i < positions.size(); ++i)
+        values[i] = sdf(positions[i]);
+      return;
+    }
+    pool->ParallelFor(positions.size(), [&](size_t i, size_t)
+    {
+      values[i] = sdf(positions[i]);
+    });
+  };
+  return MarchCubeGrid(Fun3sBatch(batch), domain, cubeSize, isoLevel);
+}
+
+Mesh MeshReconstruction::MarchCubeGrid(
+    Fun3sBatch const &sdf,
+    Rect3 const &domain,
+    Vec3 const &cubeSize,
+    double isoLevel)
+{
+  auto const NumX = static_cast<int>(ceil(domain.size.x / cubeSize.x));
+  auto const NumY = static_cast<int>(ceil(domain.size.y / cubeSize.y));
+  auto const NumZ = static_cast<int>(ceil(domain.size.z / cubeSize.z));
+
+  auto const HalfCubeDiag = cubeSize.Norm() / 2.0;
+  auto const HalfCubeSize = cubeSize * 0.5;
+
+  Mesh mesh;
+  if (NumX <= 0 || NumY <= 0 || NumZ <= 0)
+    return mesh;
+
+  auto const CubeIndex = [=](int ix, int iy, int iz)
+  { return (static_cast<size_t>(ix) * NumY + iy) * NumZ + iz; };
+  auto const VertexIndex = [=](int ix, int iy, int iz)
+  { return (static_cast<size_t>(ix) * (NumY + 1) + iy) * (NumZ + 1) + iz; };
+  auto const GridPoint = [&](int ix, int iy, int iz)
+  { return Vec3{domain.min.x + ix * cubeSize.x, domain.min.y + iy * cubeSize.y, domain.min.z + iz * cubeSize.z}; };
+
+  // (x, y, z) offsets of each corner, in the order used by Cube.
+  const int CornerOffsets[8][3] = {
+      {0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1},
+      {0, 1, 0}, {1, 1, 0}, {1, 1, 1}, {0, 1, 1}};
+
+  // Find the cubes in the narrow band around the surface.
+  std::vector<uint8_t> inBand(static_cast<size_t>(NumX) * NumY * NumZ, 0u);
+  std::vector<Vec3> positions;
+  std::vector<double> values;
+  positions.reserve(inBand.size());
+  for (auto ix = 0; ix < NumX; ++ix)
+    for (auto iy = 0; iy < NumY; ++iy)
+      for (auto iz = 0; iz < NumZ; ++iz)
+        positions.push_back(GridPoint(ix, iy, iz) + HalfCubeSize);
+  sdf(positions, values);
+  for (size_t i = 0u; i < inBand.size(); ++i)
+    inBand[i] = abs(values[i] - isoLevel) <= HalfCubeDiag ? 1u : 0u;
+
+  // Sample each vertex used by those cubes only once.
+  std::vector<uint8_t> needed(static_cast<size_t>(NumX + 1) * (NumY + 1) * (NumZ + 1), 0u);
+  for (auto ix = 0; ix < NumX; ++ix)
+    for (auto iy = 0; iy < NumY; ++iy)
+      for (auto iz = 0; iz < NumZ; ++iz)
+        if (inBand[CubeIndex(ix, iy, iz)])
+          for (auto corner = 0; corner < 8; ++corner)
+            needed[VertexIndex(
+                ix + CornerOffsets[corner][0],
+                iy + CornerOffsets[corner][1],
+                iz + CornerOffsets[corner][2])] = 1u;
+
+  std::vector<double> field(needed.size(), 0.0);
+  std::vector<size_t> neededIndices;
+  positions.clear();
+  for (auto ix = 0; ix <= NumX; ++ix)
+  {
+    for (auto iy = 0; iy <= NumY; ++iy)
+    {
+      for (auto iz = 0; iz <= NumZ; ++iz)
+      {
+        auto index = VertexIndex(ix, iy, iz);
+        if (needed[index])
+        {
+          neededIndices.push_back(index);
+          positions.push_back(GridPoint(ix, iy, iz));
+        }
+      }
+    }
+  }
+  sdf(positions, values);
+  for (size_t i = 0u; i < neededIndices.size(); ++i)
+    field[neededIndices[i]] = values[i];
+
+  std::unordered_map<uint64_t, int> weldedVertices;
+  for (auto ix = 0; ix < NumX; ++ix)
+  {
+    for (auto iy = 0; iy < NumY; ++iy)
+    {
+      for (auto iz = 0; iz < NumZ; ++iz)
+      {
+        if (!inBand[CubeIndex(ix, iy, iz)])
+          continue;
+
+        std::array<double, 8> values;
+        for (auto corner = 0; corner < 8; ++corner)
+        {
+          values[corner] = field[VertexIndex(
+              ix + CornerOffsets[corner][0],
+              iy + CornerOffsets[corner][1],
+              iz + CornerOffsets[corner][2])];
+        }
+
+        Cube cube({GridPoint(ix, iy, iz), cubeSize}, values);
+        auto intersect = cube.Intersect(isoLevel);
+
+        // Grid vertices have even keys and grid edges odd keys.
+        std::array<uint64_t, 12> vertexKeys;
+        for (auto e = 0; e < 12; ++e)
+        {
+          auto corner = intersect.edgeVertCorners[e];
+          if (corner >= 0)
+          {
+            vertexKeys[e] = 2u * VertexIndex(
+                ix + CornerOffsets[corner][0],
+                iy + CornerOffsets[corner][1],
+                iz + CornerOffsets[corner][2]);
+          }
+          else
+          {
+            auto const &c0 = CornerOffsets[Marching::edges[e].vert0];
+            auto const &c1 = CornerOffsets[Marching::edges[e].vert1];
+            auto axis = c0[0] != c1[0] ? 0 : (c0[1] != c1[1] ? 1 : 2);
+            auto origin = VertexIndex(
+                ix + std::min(c0[0], c1[0]),
+                iy + std::min(c0[1], c1[1]),
+                iz + std::min(c0[2], c1[2]));
+            vertexKeys[e] = 2u * (3u * origin + axis) + 1u;
+          }
+        }
+
+        Triangulate(intersect, vertexKeys, [&cube](Vec3 const &p)
+                    { return cube.Gradient(p); }, mesh, weldedVertices);
+      }
+    }
+  }
+
+  return mesh;
+}
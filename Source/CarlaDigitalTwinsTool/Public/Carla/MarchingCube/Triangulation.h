@@ -2,12 +2,27 @@
 #include "Cube.h"
 #include "DataStructs.h"
 
+#include <cstdint>
+#include <unordered_map>
+
 namespace MeshReconstruction
 {
   void Triangulate(
       IntersectInfo const &intersect,
       Fun3v const &grad,
       Mesh &mesh);
+
+  /// Same as above, but reusing the vertices already emitted to @a mesh.
+  /// @param vertexKeys Key of the vertex on each edge. Vertices with the same
+  /// key (e.g. the same edge seen from neighbouring cubes) are emitted once.
+  /// @param weldedVertices Index in @a mesh of each key already emitted,
+  /// shared between calls.
+  void Triangulate(
+      IntersectInfo const &intersect,
+      std::array<uint64_t, 12> const &vertexKeys,
+      Fun3v const &grad,
+      Mesh &mesh,
+      std::unordered_map<uint64_t, int> &weldedVertices);
 }
 
 namespace
@@ -309,4 +324,43 @@ void MeshReconstruction::Triangulate(
 
     mesh.triangles.push_back({last - 2, last - 1, last});
   }
-}
\ No newline at end of file
+}
+
+void MeshReconstruction::Triangulate(
+    IntersectInfo const &intersect,
+    std::array<uint64_t, 12> const &vertexKeys,
+    Fun3v const &grad,
+    Mesh &mesh,
+    std::unordered_map<uint64_t, int> &weldedVertices)
+{
+  // Cube is entirely in/out of the surface. Generate no triangles.
+  if (intersect.signConfig == 0 || intersect.signConfig == 255)
+    return;
+
+  auto const &tri = signConfigToTriangles[intersect.signConfig];
+
+  auto vertexIndex = [&](int edge)
+  {
+    auto inserted = weldedVertices.emplace(vertexKeys[edge], static_cast<int>(mesh.vertices.size()));
+    if (inserted.second)
+    {
+      auto const &v = intersect.edgeVertIndices[edge];
+      mesh.vertices.push_back(v);
+      mesh.vertexNormals.push_back(grad(v).Normalized());
+    }
+    return inserted.first->second;
+  };
+
+  for (auto i = 0; tri[i] != -1; i += 3)
+  {
+    auto i0 = vertexIndex(tri[i]);
+    auto i1 = vertexIndex(tri[i + 1]);
+    auto i2 = vertexIndex(tri[i + 2]);
+
+    // Skip triangles collapsed by vertices snapped to the same corner.
+    if (i0 == i1 || i1 == i2 || i2 == i0)
+      continue;
+
+    mesh.triangles.push_back({i0, i1, i2});
+  }
+}
@@ -42,6 +42,7 @@
 // --------------------------
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 
 #ifndef M_PI
 static const double M_PI = 3.14159265358979323846;
@@ -181,6 +182,28 @@ static double p1evl( double x, double* coef, int n )
 }
 
 
+/* Edit to original file-----
+   Same as polevl and p1evl for the degrees of the small argument
+   approximation, unrolled so that a loop calling them has no inner loop or
+   branch and can be vectorized. The operations are done in the same order,
+   so the results are identical. */
+static inline double polevl5( double x, const double* c )
+{
+    return ((((c[0] * x + c[1]) * x + c[2]) * x + c[3]) * x + c[4]) * x + c[5];
+}
+
+static inline double polevl6( double x, const double* c )
+{
+    return (((((c[0] * x + c[1]) * x + c[2]) * x + c[3]) * x + c[4]) * x + c[5]) * x + c[6];
+}
+
+static inline double p1evl6( double x, const double* c )
+{
+    return (((((x + c[0]) * x + c[1]) * x + c[2]) * x + c[3]) * x + c[4]) * x + c[5];
+}
+/* -------------------------- */
+
+
 static void fresnel( double xxa, double *ssa, double *cca )
 {
     double f, g, cc, ss, c, s, t, u;
@@ -228,6 +251,41 @@ static void fresnel( double xxa, double *ssa, double *cca )
 }
 
 
+/* Edit to original file-----
+   Fresnel integrals of count arguments. Road spirals stay within the small
+   argument approximation, so it is evaluated for every argument in a branch
+   free loop the compiler can vectorize. The few arguments outside of its
+   range are then computed again with fresnel(). */
+static void fresnelBatch( const double *xxa, size_t count, double *ssa, double *cca )
+{
+    size_t i;
+
+    /* Local copies of the coefficients, the tables could alias the output */
+    double lsn[6], lsd[6], lcn[6], lcd[7];
+    memcpy( lsn, sn, sizeof( lsn ) );
+    memcpy( lsd, sd, sizeof( lsd ) );
+    memcpy( lcn, cn, sizeof( lcn ) );
+    memcpy( lcd, cd, sizeof( lcd ) );
+
+    for ( i = 0; i < count; ++i )
+    {
+        const double x    = fabs( xxa[i] );
+        const double x2   = x * x;
+        const double t    = x2 * x2;
+        const double sign = xxa[i] < 0.0 ? -1.0 : 1.0;
+        ssa[i] = sign * ( x * x2 * polevl5( t, lsn ) / p1evl6( t, lsd ) );
+        cca[i] = sign * ( x * polevl5( t, lcn ) / polevl6( t, lcd ) );
+    }
+
+    for ( i = 0; i < count; ++i )
+    {
+        if ( xxa[i] * xxa[i] >= 2.5625 )
+            fresnel( xxa[i], &ssa[i], &cca[i] );
+    }
+}
+/* -------------------------- */
+
+
 /**
 * compute the actual "standard" spiral, starting with curvature 0
 * @param s      run-length along spiral
@@ -254,3 +312,29 @@ void odrSpiral( double s, double cDot, double *x, double *y, double *t )
 
     *t = s * s * cDot * 0.5;
 }
+
+/* Edit to original file----- */
+void odrSpiralBatch( const double *s, size_t count, double cDot, double *x, double *y, double *t )
+{
+    double a;
+    size_t i;
+
+    a = 1.0 / sqrt( fabs( cDot ) );
+    a *= sqrt( M_PI );
+
+    /* t holds the arguments of the Fresnel integrals until the end */
+    for ( i = 0; i < count; ++i )
+        t[i] = s[i] / a;
+
+    fresnelBatch( t, count, y, x );
+
+    const double ySign = cDot < 0.0 ? -1.0 : 1.0;
+    for ( i = 0; i < count; ++i )
+    {
+        x[i] *= a;
+        y[i] *= a;
+        y[i] *= ySign;
+        t[i] = s[i] * s[i] * cDot * 0.5;
+    }
+}
+/* -------------------------- */
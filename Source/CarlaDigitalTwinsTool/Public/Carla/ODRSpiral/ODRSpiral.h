@@ -22,7 +22,9 @@
     See the License for the specific language governing permissions and
     limitations under the License.
  */
- 
+
+#include <stddef.h>
+
 /**
 * compute the actual "standard" spiral, starting with curvature 0
 * @param s      run-length along spiral
@@ -33,3 +35,16 @@
 */
 
 extern void odrSpiral( double s, double cDot, double *x, double *y, double *t );
+
+/**
+* compute the "standard" spiral for @a count run-lengths at once, with the
+* same results as calling odrSpiral for each of them
+* @param s      run-lengths along spiral
+* @param count  number of run-lengths
+* @param cDot   first derivative of curvature [1/m2]
+* @param x      resulting x-coordinates, @a count elements [m]
+* @param y      resulting y-coordinates, @a count elements [m]
+* @param t      tangent directions, @a count elements [rad]
+*/
+
+extern void odrSpiralBatch( const double *s, size_t count, double cDot, double *x, double *y, double *t );
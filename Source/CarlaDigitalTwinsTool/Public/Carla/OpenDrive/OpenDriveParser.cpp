@@ -18,6 +18,7 @@
 #include "Carla/OpenDrive/parser/SignalParser.h"
 #include "Carla/OpenDrive/parser/TrafficGroupParser.h"
 #include "Carla/Road/MapBuilder.h"
+#include "Carla/Road/MapCache.h"
 
 #include <Carla/pugixml/pugixml.hpp>
 
@@ -25,6 +26,18 @@ namespace carla {
 namespace opendrive {
 
   boost::optional<road::Map> OpenDriveParser::Load(const std::string &opendrive) {
+    return Load(opendrive, nullptr);
+  }
+
+  boost::optional<road::Map> OpenDriveParser::Load(
+      const std::string &opendrive,
+      const road::MapCache &cache) {
+    return Load(opendrive, &cache);
+  }
+
+  boost::optional<road::Map> OpenDriveParser::Load(
+      const std::string &opendrive,
+      const road::MapCache *cache) {
     pugi::xml_document xml;
     pugi::xml_parse_result parse_result = xml.load_string(opendrive.c_str());
 
@@ -46,7 +59,7 @@ namespace opendrive {
     parser::ObjectParser::Parse(xml, map_builder);
     parser::ControllerParser::Parse(xml, map_builder);
 
-    return map_builder.Build();
+    return map_builder.Build(cache);
   }
 
 } // namespace opendrive
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "Carla/Road/MapCache.h"
 #include "Carla/Road/RoadMap.h"
 
 
@@ -22,6 +23,18 @@ namespace opendrive {
   public:
 
     static boost::optional<road::Map> Load(const std::string &opendrive);
+
+    /// Same as Load, but reusing the precomputed data of @a cache, which
+    /// must be valid for @a opendrive (see road::MapCache::IsValidFor).
+    static boost::optional<road::Map> Load(
+        const std::string &opendrive,
+        const road::MapCache &cache);
+
+  private:
+
+    static boost::optional<road::Map> Load(
+        const std::string &opendrive,
+        const road::MapCache *cache);
   };
 
 } // namespace opendrive
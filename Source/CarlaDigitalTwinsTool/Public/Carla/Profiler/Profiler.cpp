@@ -70,8 +70,13 @@ namespace detail {
     const std::string _filename;
   };
 
-  ProfilerData::~ProfilerData() {
+  static StaticProfiler &GetProfiler() {
     static StaticProfiler PROFILER{"profiler.csv"};
+    return PROFILER;
+  }
+
+  ProfilerData::~ProfilerData() {
+    auto &PROFILER = GetProfiler();
     if (_count > 0u) {
       if (_print_fps) {
         PROFILER.write_line(_name, fps(average()), fps(minimum()), fps(maximum()), "FPS", _count);
@@ -83,6 +88,12 @@ namespace detail {
     }
   }
 
+  CounterData::~CounterData() {
+    if (_count > 0u) {
+      GetProfiler().write_line(_name, average(), _max_value, _min_value, "count", _count);
+    }
+  }
+
 } // namespace detail
 } // namespace profiler
 } // namespace carla
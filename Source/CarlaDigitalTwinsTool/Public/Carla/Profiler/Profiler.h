@@ -9,6 +9,7 @@
 #ifndef LIBCARLA_ENABLE_PROFILER
 #  define CARLA_PROFILE_SCOPE(context, profiler_name)
 #  define CARLA_PROFILE_FPS(context, profiler_name)
+#  define CARLA_PROFILE_COUNT(context, profiler_name, value) static_cast<void>(value)
 #else
 
 #include "Carla/StopWatch.h"
@@ -73,6 +74,40 @@ namespace detail {
     size_t _min_elapsed = std::numeric_limits<size_t>::max();
   };
 
+  /// Same as ProfilerData for a quantity instead of a time, e.g. the size of
+  /// the input of each call to a function.
+  class CounterData {
+  public:
+
+    explicit CounterData(std::string name)
+      : _name(std::move(name)) {}
+
+    ~CounterData();
+
+    void Annotate(size_t value) {
+      ++_count;
+      _total += value;
+      _max_value = std::max(value, _max_value);
+      _min_value = std::min(value, _min_value);
+    }
+
+    float average() const {
+      return static_cast<float>(_total) / static_cast<float>(_count);
+    }
+
+  private:
+
+    const std::string _name;
+
+    size_t _count = 0u;
+
+    size_t _total = 0u;
+
+    size_t _max_value = 0u;
+
+    size_t _min_value = std::numeric_limits<size_t>::max();
+  };
+
   class ScopedProfiler {
   public:
 
@@ -121,4 +156,11 @@ namespace detail {
       stop_watch.Restart(); \
     }
 
+#define CARLA_PROFILE_COUNT(context, profiler_name, value) \
+    { \
+      static thread_local ::carla::profiler::detail::CounterData carla_profiler_ ## context ## _ ## profiler_name ## _counter( \
+          LIBCARLA_GTEST_GET_TEST_NAME() + "." #context "." #profiler_name); \
+      carla_profiler_ ## context ## _ ## profiler_name ## _counter.Annotate(static_cast<size_t>(value)); \
+    }
+
 #endif // LIBCARLA_ENABLE_PROFILER
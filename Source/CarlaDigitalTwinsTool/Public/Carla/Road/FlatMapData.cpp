@@ -0,0 +1,190 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "Carla/Road/FlatMapData.h"
+#include "Carla/Road/Lane.h"
+#include "Carla/Road/LaneSection.h"
+#include "Carla/Road/Road.h"
+#include "Carla/Road/element/RoadInfoLaneWidth.h"
+
+#include <algorithm>
+
+namespace carla {
+namespace road {
+
+  FlatMapData::FlatMapData(const std::unordered_map<RoadId, Road> &roads) {
+    // Sorted by id so the arrays do not depend on the order of the hash map
+    std::vector<const Road *> sorted_roads;
+    sorted_roads.reserve(roads.size());
+    size_t section_count = 0u;
+    size_t lane_count = 0u;
+    for (const auto &road : roads) {
+      sorted_roads.push_back(&road.second);
+      for (const auto &section : road.second.GetLaneSections()) {
+        ++section_count;
+        lane_count += section.GetLanes().size();
+      }
+    }
+    std::sort(sorted_roads.begin(), sorted_roads.end(), [](const Road *lhs, const Road *rhs) {
+      return lhs->GetId() < rhs->GetId();
+    });
+
+    _roads.reserve(sorted_roads.size());
+    _road_elements.reserve(sorted_roads.size());
+    _sections.reserve(section_count);
+    _section_elements.reserve(section_count);
+    _lanes.reserve(lane_count);
+    _lane_elements.reserve(lane_count);
+
+    std::unordered_map<const Lane *, Index> lane_indices;
+    lane_indices.reserve(lane_count);
+    for (const Road *road : sorted_roads) {
+      const Index road_index = static_cast<Index>(_roads.size());
+      _roads.push_back(RoadRecord{
+          road->GetId(),
+          road->GetJunctionId(),
+          road->GetLength(),
+          static_cast<Index>(_sections.size()),
+          0u});
+      _road_elements.push_back(road);
+
+      for (const auto &section : road->GetLaneSections()) {
+        const Index section_index = static_cast<Index>(_sections.size());
+        _sections.push_back(SectionRecord{
+            section.GetId(),
+            road_index,
+            section.GetDistance(),
+            section.GetLength(),
+            static_cast<Index>(_lanes.size()),
+            static_cast<Index>(section.GetLanes().size())});
+        _section_elements.push_back(&section);
+        ++_roads.back().section_count;
+
+        for (const auto &lane : section.GetLanes()) {
+          lane_indices.emplace(&lane.second, static_cast<Index>(_lanes.size()));
+          _lanes.push_back(LaneRecord{
+              lane.first,
+              lane.second.GetType(),
+              section_index,
+              0u, 0u, 0u, 0u,
+              static_cast<Index>(_lane_widths.size()),
+              0u});
+          _lane_elements.push_back(&lane.second);
+          for (const auto *width : lane.second.GetInfos<element::RoadInfoLaneWidth>()) {
+            _lane_widths.push_back(LaneWidthRecord{width->GetDistance(), width->GetPolynomial()});
+            ++_lanes.back().width_count;
+          }
+        }
+      }
+    }
+
+    // The links, once every lane has its index
+    auto add_links = [&](const std::vector<Lane *> &links, Index &first, Index &count) {
+      first = static_cast<Index>(_lane_links.size());
+      for (const Lane *link : links) {
+        const auto it = lane_indices.find(link);
+        if (it != lane_indices.end()) {
+          _lane_links.push_back(it->second);
+        }
+      }
+      count = static_cast<Index>(_lane_links.size()) - first;
+    };
+    for (size_t i = 0u; i < _lanes.size(); ++i) {
+      LaneRecord &record = _lanes[i];
+      add_links(_lane_elements[i]->GetNextLanes(), record.first_next, record.next_count);
+      add_links(_lane_elements[i]->GetPreviousLanes(), record.first_previous, record.previous_count);
+    }
+
+    // A table by id when the ids are dense enough, a binary search otherwise
+    if (!_roads.empty()) {
+      const size_t max_id = _roads.back().id;
+      if (max_id < 4u * _roads.size() + 1024u) {
+        _road_by_id.assign(max_id + 1u, InvalidIndex);
+        for (Index i = 0u; i < _roads.size(); ++i) {
+          _road_by_id[_roads[i].id] = i;
+        }
+      } else {
+        _sorted_road_ids.reserve(_roads.size());
+        for (Index i = 0u; i < _roads.size(); ++i) {
+          _sorted_road_ids.emplace_back(_roads[i].id, i);
+        }
+      }
+    }
+  }
+
+  FlatMapData::Index FlatMapData::FindRoad(RoadId id) const {
+    if (!_road_by_id.empty()) {
+      return id < _road_by_id.size() ? _road_by_id[id] : InvalidIndex;
+    }
+    const auto it = std::lower_bound(
+        _sorted_road_ids.begin(),
+        _sorted_road_ids.end(),
+        id,
+        [](const std::pair<RoadId, Index> &entry, RoadId value) {
+          return entry.first < value;
+        });
+    return (it != _sorted_road_ids.end() && it->first == id) ? it->second : InvalidIndex;
+  }
+
+  FlatMapData::Index FlatMapData::FindSection(Index road, SectionId id) const {
+    // Roads have a handful of sections at most
+    const RoadRecord &record = _roads[road];
+    for (Index i = record.first_section; i < record.first_section + record.section_count; ++i) {
+      if (_sections[i].id == id) {
+        return i;
+      }
+    }
+    return InvalidIndex;
+  }
+
+  FlatMapData::Index FlatMapData::FindLane(Index section, LaneId id) const {
+    const SectionRecord &record = _sections[section];
+    if (record.lane_count == 0u) {
+      return InvalidIndex;
+    }
+    // The ids of the lanes of a section are usually consecutive
+    const int64_t offset = static_cast<int64_t>(id) - _lanes[record.first_lane].id;
+    if (offset >= 0 && offset < static_cast<int64_t>(record.lane_count) &&
+        _lanes[record.first_lane + offset].id == id) {
+      return record.first_lane + static_cast<Index>(offset);
+    }
+    const auto begin = _lanes.begin() + record.first_lane;
+    const auto end = begin + record.lane_count;
+    const auto it = std::lower_bound(begin, end, id, [](const LaneRecord &lane, LaneId value) {
+      return lane.id < value;
+    });
+    return (it != end && it->id == id) ? static_cast<Index>(it - _lanes.begin()) : InvalidIndex;
+  }
+
+  FlatMapData::Index FlatMapData::FindLane(
+      RoadId road_id,
+      SectionId section_id,
+      LaneId lane_id) const {
+    const Index road = FindRoad(road_id);
+    if (road == InvalidIndex) {
+      return InvalidIndex;
+    }
+    const Index section = FindSection(road, section_id);
+    if (section == InvalidIndex) {
+      return InvalidIndex;
+    }
+    return FindLane(section, lane_id);
+  }
+
+  const FlatMapData::LaneWidthRecord *FlatMapData::GetLaneWidthRecord(
+      Index lane,
+      double s) const {
+    const LaneRecord &record = _lanes[lane];
+    const auto begin = _lane_widths.begin() + record.first_width;
+    const auto end = begin + record.width_count;
+    auto it = std::upper_bound(begin, end, s, [](double value, const LaneWidthRecord &width) {
+      return value < width.s;
+    });
+    return it == begin ? nullptr : &*(--it);
+  }
+
+} // namespace road
+} // namespace carla
@@ -0,0 +1,208 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "Carla/Geom/CubicPolynomial.h"
+#include "Carla/ListView.h"
+#include "Carla/Road/Lane.h"
+#include "Carla/Road/RoadTypes.h"
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace carla {
+namespace road {
+
+  class LaneSection;
+  class Road;
+
+  /// Read-only copy of the road network of a MapData, built once the map is
+  /// complete. The roads, lane sections and lanes are stored in contiguous
+  /// arrays and addressed by dense indices: the sections of a road and the
+  /// lanes of a section are consecutive, sorted as in MapData, and each
+  /// record keeps the index of its parent. The links between lanes and the
+  /// lane width records are flattened in arrays of their own, so walking
+  /// the network does not go through the hash maps, multimaps and maps of
+  /// MapData.
+  ///
+  /// The records point back to the Road, LaneSection and Lane they were
+  /// built from, which stay valid while the MapData lives, as its containers
+  /// do not move their elements.
+  class FlatMapData {
+  public:
+
+    using Index = uint32_t;
+
+    static constexpr Index InvalidIndex = std::numeric_limits<Index>::max();
+
+    struct RoadRecord {
+
+      RoadId id;
+
+      JuncId junction_id;
+
+      double length;
+
+      Index first_section;
+
+      Index section_count;
+    };
+
+    struct SectionRecord {
+
+      SectionId id;
+
+      Index road;
+
+      /// Start and length of the section along the road.
+      double s;
+
+      double length;
+
+      Index first_lane;
+
+      Index lane_count;
+    };
+
+    struct LaneRecord {
+
+      LaneId id;
+
+      Lane::LaneType type;
+
+      Index section;
+
+      Index first_next;
+
+      Index next_count;
+
+      Index first_previous;
+
+      Index previous_count;
+
+      Index first_width;
+
+      Index width_count;
+    };
+
+    /// Width of a lane from the distance @a s along the road.
+    struct LaneWidthRecord {
+
+      double s;
+
+      geom::CubicPolynomial polynomial;
+    };
+
+    FlatMapData() = default;
+
+    explicit FlatMapData(const std::unordered_map<RoadId, Road> &roads);
+
+    bool empty() const {
+      return _roads.empty();
+    }
+
+    size_t GetRoadCount() const {
+      return _roads.size();
+    }
+
+    size_t GetSectionCount() const {
+      return _sections.size();
+    }
+
+    size_t GetLaneCount() const {
+      return _lanes.size();
+    }
+
+    /// @name Lookups, InvalidIndex if not found
+    /// @{
+
+    Index FindRoad(RoadId id) const;
+
+    Index FindSection(Index road, SectionId id) const;
+
+    Index FindLane(Index section, LaneId id) const;
+
+    Index FindLane(RoadId road_id, SectionId section_id, LaneId lane_id) const;
+
+    /// @}
+
+    const RoadRecord &GetRoad(Index road) const {
+      return _roads[road];
+    }
+
+    const SectionRecord &GetSection(Index section) const {
+      return _sections[section];
+    }
+
+    const LaneRecord &GetLane(Index lane) const {
+      return _lanes[lane];
+    }
+
+    const Road &GetRoadElement(Index road) const {
+      return *_road_elements[road];
+    }
+
+    const LaneSection &GetSectionElement(Index section) const {
+      return *_section_elements[section];
+    }
+
+    const Lane &GetLaneElement(Index lane) const {
+      return *_lane_elements[lane];
+    }
+
+    /// Indices of the lanes Lane::GetNextLanes returns.
+    auto GetNextLanes(Index lane) const {
+      const LaneRecord &record = _lanes[lane];
+      return MakeListView(
+          _lane_links.begin() + record.first_next,
+          _lane_links.begin() + record.first_next + record.next_count);
+    }
+
+    /// Indices of the lanes Lane::GetPreviousLanes returns.
+    auto GetPreviousLanes(Index lane) const {
+      const LaneRecord &record = _lanes[lane];
+      return MakeListView(
+          _lane_links.begin() + record.first_previous,
+          _lane_links.begin() + record.first_previous + record.previous_count);
+    }
+
+    /// The last width record of @a lane starting at or before @a s, nullptr
+    /// if there is none, as Lane::GetInfo<RoadInfoLaneWidth> returns.
+    const LaneWidthRecord *GetLaneWidthRecord(Index lane, double s) const;
+
+  private:
+
+    std::vector<RoadRecord> _roads;
+
+    std::vector<SectionRecord> _sections;
+
+    std::vector<LaneRecord> _lanes;
+
+    /// Next and previous lanes of every lane, see LaneRecord.
+    std::vector<Index> _lane_links;
+
+    std::vector<LaneWidthRecord> _lane_widths;
+
+    /// Index of the road of each id, when the ids are dense enough.
+    std::vector<Index> _road_by_id;
+
+    /// Pairs of road id and index sorted by id, otherwise.
+    std::vector<std::pair<RoadId, Index>> _sorted_road_ids;
+
+    /// Elements the records were built from, apart from the records so
+    /// these do not take room in the cache lines the queries walk.
+    std::vector<const Road *> _road_elements;
+
+    std::vector<const LaneSection *> _section_elements;
+
+    std::vector<const Lane *> _lane_elements;
+  };
+
+} // namespace road
+} // namespace carla
@@ -6,32 +6,123 @@
 
 #pragma once
 
+#include "Carla/Debug.h"
 #include "Carla/NonCopyable.h"
 #include "Carla/Road/RoadElementSet.h"
 #include "Carla/Road/element/RoadInfo.h"
 #include "Carla/Road/element/RoadInfoIterator.h"
+#include "Carla/Road/element/RoadInfoVisitor.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <tuple>
 #include <vector>
 #include <memory>
 
 namespace carla {
 namespace road {
 
+namespace detail {
+
+  /// List of the RoadInfo types indexed by InformationSet.
+  using IndexedRoadInfoTypes = std::tuple<
+      element::RoadInfoElevation,
+      element::RoadInfoGeometry,
+      element::RoadInfoLane,
+      element::RoadInfoLaneAccess,
+      element::RoadInfoLaneBorder,
+      element::RoadInfoLaneHeight,
+      element::RoadInfoLaneMaterial,
+      element::RoadInfoLaneOffset,
+      element::RoadInfoLaneRule,
+      element::RoadInfoLaneVisibility,
+      element::RoadInfoLaneWidth,
+      element::RoadInfoMarkRecord,
+      element::RoadInfoMarkTypeLine,
+      element::RoadInfoSpeed,
+      element::RoadInfoCrosswalk,
+      element::RoadInfoSignal>;
+
+  template <typename T, typename Tuple>
+  struct TupleIndex;
+
+  template <typename T, typename... Ts>
+  struct TupleIndex<T, std::tuple<T, Ts...>> {
+    static constexpr size_t value = 0u;
+  };
+
+  template <typename T, typename U, typename... Ts>
+  struct TupleIndex<T, std::tuple<U, Ts...>> {
+    static constexpr size_t value = 1u + TupleIndex<T, std::tuple<Ts...>>::value;
+  };
+
+  template <typename T>
+  constexpr size_t RoadInfoTypeIndex() {
+    return TupleIndex<T, IndexedRoadInfoTypes>::value;
+  }
+
+  /// Finds the index in IndexedRoadInfoTypes of the type of a RoadInfo.
+  class RoadInfoTypeIndexVisitor final : public element::RoadInfoVisitor {
+  public:
+
+    static constexpr size_t NotIndexed = std::tuple_size<IndexedRoadInfoTypes>::value;
+
+    size_t Get(element::RoadInfo &info) {
+      _index = NotIndexed;
+      info.AcceptVisitor(*this);
+      return _index;
+    }
+
+    void Visit(element::RoadInfoElevation &) final { Set<element::RoadInfoElevation>(); }
+    void Visit(element::RoadInfoGeometry &) final { Set<element::RoadInfoGeometry>(); }
+    void Visit(element::RoadInfoLane &) final { Set<element::RoadInfoLane>(); }
+    void Visit(element::RoadInfoLaneAccess &) final { Set<element::RoadInfoLaneAccess>(); }
+    void Visit(element::RoadInfoLaneBorder &) final { Set<element::RoadInfoLaneBorder>(); }
+    void Visit(element::RoadInfoLaneHeight &) final { Set<element::RoadInfoLaneHeight>(); }
+    void Visit(element::RoadInfoLaneMaterial &) final { Set<element::RoadInfoLaneMaterial>(); }
+    void Visit(element::RoadInfoLaneOffset &) final { Set<element::RoadInfoLaneOffset>(); }
+    void Visit(element::RoadInfoLaneRule &) final { Set<element::RoadInfoLaneRule>(); }
+    void Visit(element::RoadInfoLaneVisibility &) final { Set<element::RoadInfoLaneVisibility>(); }
+    void Visit(element::RoadInfoLaneWidth &) final { Set<element::RoadInfoLaneWidth>(); }
+    void Visit(element::RoadInfoMarkRecord &) final { Set<element::RoadInfoMarkRecord>(); }
+    void Visit(element::RoadInfoMarkTypeLine &) final { Set<element::RoadInfoMarkTypeLine>(); }
+    void Visit(element::RoadInfoSpeed &) final { Set<element::RoadInfoSpeed>(); }
+    void Visit(element::RoadInfoCrosswalk &) final { Set<element::RoadInfoCrosswalk>(); }
+    void Visit(element::RoadInfoSignal &) final { Set<element::RoadInfoSignal>(); }
+
+  private:
+
+    template <typename T>
+    void Set() {
+      _index = RoadInfoTypeIndex<T>();
+    }
+
+    size_t _index = NotIndexed;
+  };
+
+} // namespace detail
+
   class InformationSet : private MovableNonCopyable {
   public:
 
-    InformationSet() = default;
+    InformationSet() {
+      _type_offsets.fill(0u);
+    }
 
     InformationSet(std::vector<std::unique_ptr<element::RoadInfo>> &&vec)
-      : _road_set(std::move(vec)) {}
+      : _road_set(std::move(vec)) {
+      BuildTypeIndex();
+    }
 
     /// Return all infos given a type from the start of the road
     template <typename T>
     std::vector<const T *> GetInfos() const {
+      const auto range = GetTypeRange<T>();
       std::vector<const T *> vec;
-      auto it = element::MakeRoadInfoIterator<T>(_road_set.GetAll());
-      for (; !it.IsAtEnd(); ++it) {
-        vec.emplace_back(&*it);
+      vec.reserve(static_cast<size_t>(range.second - range.first));
+      for (auto it = range.first; it != range.second; ++it) {
+        vec.emplace_back(static_cast<const T *>(*it));
       }
       return vec;
     }
@@ -40,25 +131,27 @@ namespace road {
     /// the start of the road
     template <typename T>
     const T *GetInfo(const double s) const {
-      auto it = element::MakeRoadInfoIterator<T>(_road_set.GetReverseSubset(s));
-      return it.IsAtEnd() ? nullptr : &*it;
+      const auto range = GetTypeRange<T>();
+      auto it = std::upper_bound(range.first, range.second, s, DistanceLess());
+      return it == range.first ? nullptr : static_cast<const T *>(*(--it));
     }
 
     /// Return all infos given a type in a given range of the road
     template <typename T>
     std::vector<const T *> GetInfos(const double min_s, const double max_s) const {
+      const auto range = GetTypeRange<T>();
       std::vector<const T *> vec;
       if(min_s < max_s) {
-        auto it = element::MakeRoadInfoIterator<T>(
-            _road_set.GetSubsetInRange(min_s, max_s)); //reverse
-        for (; !it.IsAtEnd(); ++it) {
-          vec.emplace_back(&*it);
+        auto low_bound = std::lower_bound(range.first, range.second, min_s, DistanceLess());
+        auto up_bound = std::upper_bound(low_bound, range.second, max_s, DistanceLess());
+        for (auto it = low_bound; it != up_bound; ++it) {
+          vec.emplace_back(static_cast<const T *>(*it));
         }
       } else {
-        auto it = element::MakeRoadInfoIterator<T>(
-            _road_set.GetReverseSubsetInRange(max_s, min_s)); //reverse
-        for (; !it.IsAtEnd(); ++it) {
-          vec.emplace_back(&*it);
+        auto low_bound = std::lower_bound(range.first, range.second, max_s, DistanceLess());
+        auto up_bound = std::upper_bound(low_bound, range.second, min_s, DistanceLess());
+        for (auto it = up_bound; it != low_bound;) {
+          vec.emplace_back(static_cast<const T *>(*(--it)));
         }
       }
       return vec;
@@ -66,7 +159,59 @@ namespace road {
 
   private:
 
+    using TypeIndexIterator = std::vector<const element::RoadInfo *>::const_iterator;
+
+    struct DistanceLess {
+      bool operator()(const double s, const element::RoadInfo *info) const {
+        return s < info->GetDistance();
+      }
+      bool operator()(const element::RoadInfo *info, const double s) const {
+        return info->GetDistance() < s;
+      }
+    };
+
+    /// Groups the infos by type, keeping the order of the road set inside
+    /// each group, so GetInfo<T> is a binary search without visiting the
+    /// infos of other types.
+    void BuildTypeIndex() {
+      detail::RoadInfoTypeIndexVisitor visitor;
+      std::vector<size_t> types;
+      types.reserve(_road_set.size());
+      _type_offsets.fill(0u);
+      for (const auto &info : _road_set.GetAll()) {
+        DEBUG_ASSERT(info != nullptr);
+        types.emplace_back(visitor.Get(*info));
+        ++_type_offsets[types.back() + 1u];
+      }
+      for (size_t i = 1u; i < _type_offsets.size(); ++i) {
+        _type_offsets[i] += _type_offsets[i - 1u];
+      }
+      _by_type.resize(_road_set.size());
+      auto next = _type_offsets;
+      size_t i = 0u;
+      for (const auto &info : _road_set.GetAll()) {
+        const size_t type = types[i++];
+        if (type != detail::RoadInfoTypeIndexVisitor::NotIndexed) {
+          _by_type[next[type]++] = info.get();
+        }
+      }
+    }
+
+    template <typename T>
+    std::pair<TypeIndexIterator, TypeIndexIterator> GetTypeRange() const {
+      constexpr size_t type = detail::RoadInfoTypeIndex<T>();
+      return std::make_pair(
+          _by_type.begin() + _type_offsets[type],
+          _by_type.begin() + _type_offsets[type + 1u]);
+    }
+
     RoadElementSet<std::unique_ptr<element::RoadInfo>> _road_set;
+
+    /// Infos grouped by type, see BuildTypeIndex.
+    std::vector<const element::RoadInfo *> _by_type;
+
+    /// Infos of type i are in [_type_offsets[i], _type_offsets[i + 1]).
+    std::array<uint32_t, std::tuple_size<detail::IndexedRoadInfoTypes>::value + 2u> _type_offsets;
   };
 
 } // road
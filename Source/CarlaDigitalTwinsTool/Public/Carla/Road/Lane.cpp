@@ -6,6 +6,7 @@
 
 #include "Carla/Road/Lane.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "Carla/Debug.h"
@@ -204,9 +205,10 @@ namespace road {
   }
 
   std::pair<geom::Vector3D, geom::Vector3D> Lane::GetCornerPositions(
-      const double s, const float extra_width) const {
+      const double unclamped_s, const float extra_width) const {
     const Road *road = GetRoad();
     DEBUG_ASSERT(road != nullptr);
+    const double s = geom::Math::Clamp(unclamped_s, 0.0, road->GetLength());
 
     const auto *lane_section = GetLaneSection();
     DEBUG_ASSERT(lane_section != nullptr);
@@ -263,5 +265,230 @@ namespace road {
     return std::make_pair(dp_r.location, dp_l.location);
   }
 
+  /// Walks a list of infos sorted by distance for increasing values of s,
+  /// returning the same info as InformationSet::GetInfo<T>(s).
+  template <typename T>
+  class InfoCursor {
+  public:
+
+    explicit InfoCursor(std::vector<const T *> &&infos)
+      : _infos(std::move(infos)) {}
+
+    const T *Get(const double s) {
+      while (_next < _infos.size() && _infos[_next]->GetDistance() <= s) {
+        ++_next;
+      }
+      return _next == 0u ? nullptr : _infos[_next - 1u];
+    }
+
+  private:
+
+    std::vector<const T *> _infos;
+
+    size_t _next = 0u;
+  };
+
+  /// Adds @a factor * width(s) of @a lane to @a out for every s in the sorted
+  /// @a s_values. The samples that use the same width record are evaluated
+  /// in a single tight loop.
+  static void AccumulateLaneWidth(
+      const Lane &lane,
+      const std::vector<double> &s_values,
+      const double factor,
+      const bool required,
+      std::vector<double> &out) {
+    const auto infos = lane.GetInfos<element::RoadInfoLaneWidth>();
+    const double *s = s_values.data();
+    const size_t count = s_values.size();
+    size_t i = 0u;
+    // Samples before the first record have no width
+    const double first_distance = infos.empty() ?
+        std::numeric_limits<double>::infinity() : infos.front()->GetDistance();
+    while (i < count && s[i] < first_distance) {
+      RELEASE_ASSERT(!required);
+      ++i;
+    }
+    for (size_t record = 0u; record < infos.size() && i < count; ++record) {
+      const double next_distance = record + 1u < infos.size() ?
+          infos[record + 1u]->GetDistance() : std::numeric_limits<double>::infinity();
+      const auto &polynomial = infos[record]->GetPolynomial();
+      const double a = polynomial.GetA();
+      const double b = polynomial.GetB();
+      const double c = polynomial.GetC();
+      const double d = polynomial.GetD();
+      size_t end = i;
+      while (end < count && s[end] < next_distance) {
+        ++end;
+      }
+      double *dst = out.data();
+      for (; i < end; ++i) {
+        dst[i] += factor * (a + s[i] * (b + s[i] * (c + s[i] * d)));
+      }
+    }
+  }
+
+  LaneCornerPositions Lane::GetCornerPositions(
+      const std::vector<double> &unclamped_s_values, const float extra_width) const {
+    LaneCornerPositions result;
+    const size_t count = unclamped_s_values.size();
+    result.resize(count);
+    if (count == 0u) {
+      return result;
+    }
+
+    // The batch evaluation needs the samples in order, fall back to the
+    // single sample version otherwise
+    if (!std::is_sorted(unclamped_s_values.begin(), unclamped_s_values.end())) {
+      for (size_t i = 0u; i < count; ++i) {
+        const auto edges = GetCornerPositions(unclamped_s_values[i], extra_width);
+        result.right_x[i] = edges.first.x;
+        result.right_y[i] = edges.first.y;
+        result.right_z[i] = edges.first.z;
+        result.left_x[i] = edges.second.x;
+        result.left_y[i] = edges.second.y;
+        result.left_z[i] = edges.second.z;
+      }
+      return result;
+    }
+
+    const Road *road = GetRoad();
+    DEBUG_ASSERT(road != nullptr);
+
+    // Samples accumulated step by step can end slightly past the road, clamp
+    // them to it as the single sample version does
+    const double road_length = road->GetLength();
+    std::vector<double> clamped_s_values;
+    if (unclamped_s_values.front() < 0.0 || unclamped_s_values.back() > road_length) {
+      clamped_s_values.reserve(count);
+      for (const double s : unclamped_s_values) {
+        clamped_s_values.emplace_back(geom::Math::Clamp(s, 0.0, road_length));
+      }
+    }
+    const std::vector<double> &s_values =
+        clamped_s_values.empty() ? unclamped_s_values : clamped_s_values;
+
+    const auto *lane_section = GetLaneSection();
+    DEBUG_ASSERT(lane_section != nullptr);
+    const std::map<LaneId, Lane> &lanes = lane_section->GetLanes();
+
+    // check that lane_id exists on the current s
+    RELEASE_ASSERT(!lanes.empty());
+    RELEASE_ASSERT(GetId() >= lanes.begin()->first);
+    RELEASE_ASSERT(GetId() <= lanes.rbegin()->first);
+
+    // Lateral offset of the center of the lane, accumulated lane by lane in
+    // the same order as ComputeTotalLaneWidth
+    std::vector<double> lane_t_offset(count, 0.0);
+    if (GetId() != 0) {
+      const bool negative_lane_id = GetId() < 0;
+      const double sign = negative_lane_id ? 1.0 : -1.0;
+      auto accumulate = [&](const auto &side_lanes) {
+        for (const auto &lane : side_lanes) {
+          if (lane.first != GetId()) {
+            AccumulateLaneWidth(lane.second, s_values, sign, true, lane_t_offset);
+          } else {
+            AccumulateLaneWidth(lane.second, s_values, 0.5 * sign, true, lane_t_offset);
+            break;
+          }
+        }
+      };
+      if (negative_lane_id) {
+        accumulate(MakeListView(
+            std::make_reverse_iterator(lanes.lower_bound(0)), lanes.rend()));
+      } else {
+        accumulate(MakeListView(lanes.lower_bound(1), lanes.end()));
+      }
+    }
+
+    std::vector<double> width(count, 0.0);
+    AccumulateLaneWidth(*this, s_values, 1.0, false, width);
+
+    const bool add_extra_width =
+        extra_width != 0.f && road->IsJunction() && GetType() == Lane::LaneType::Driving;
+    const float sidewalk_height = GetType() == LaneType::Sidewalk ? 0.1524f : 0.0f;
+
+    // Points of the reference line, evaluated in batch for each run of
+    // samples on the same geometry
+    std::vector<element::DirectedPoint> reference_points(count);
+    {
+      InfoCursor<element::RoadInfoGeometry> geometries(
+          road->GetInfos<element::RoadInfoGeometry>());
+      std::vector<double> dists;
+      std::vector<element::DirectedPoint> points;
+      size_t i = 0u;
+      while (i < count) {
+        const auto geometry = geometries.Get(s_values[i]);
+        size_t end = i + 1u;
+        while (end < count && geometries.Get(s_values[end]) == geometry) {
+          ++end;
+        }
+        dists.clear();
+        for (size_t k = i; k < end; ++k) {
+          dists.emplace_back(s_values[k] - geometry->GetDistance());
+        }
+        geometry->GetGeometry().PosFromDists(dists, points);
+        std::copy(points.begin(), points.end(), reference_points.begin() + i);
+        i = end;
+      }
+    }
+
+    InfoCursor<element::RoadInfoLaneOffset> lane_offsets(
+        road->GetInfos<element::RoadInfoLaneOffset>());
+    InfoCursor<element::RoadInfoElevation> elevations(
+        road->GetInfos<element::RoadInfoElevation>());
+
+    for (size_t i = 0u; i < count; ++i) {
+      const double s = s_values[i];
+      float lane_width = static_cast<float>(width[i]) / 2.0f;
+      if (add_extra_width) {
+        lane_width += extra_width;
+      }
+
+      // Same as Road::GetDirectedPointIn
+      const auto lane_offset = lane_offsets.Get(s);
+      float offset = 0;
+      if (lane_offset) {
+        offset = static_cast<float>(lane_offset->GetPolynomial().Evaluate(s));
+      }
+      element::DirectedPoint dp = reference_points[i];
+      dp.ApplyLateralOffset(-offset);
+      const auto elevation = elevations.Get(s);
+      const auto &elevation_polynomial = elevation != nullptr ?
+          elevation->GetPolynomial() : road->GetElevationOn(s);
+      dp.location.z = static_cast<float>(elevation_polynomial.Evaluate(s));
+      dp.pitch = elevation_polynomial.Tangent(s);
+
+      // Transform from the center of the road to each of lane corners
+      const float t_offset = static_cast<float>(lane_t_offset[i]);
+      element::DirectedPoint dp_r = dp;
+      element::DirectedPoint dp_l = dp;
+      dp_r.ApplyLateralOffset(t_offset + lane_width);
+      dp_l.ApplyLateralOffset(t_offset - lane_width);
+
+      // Unreal's Y axis hack
+      result.right_x[i] = dp_r.location.x;
+      result.right_y[i] = -dp_r.location.y;
+      result.right_z[i] = dp_r.location.z + sidewalk_height;
+      result.left_x[i] = dp_l.location.x;
+      result.left_y[i] = -dp_l.location.y;
+      result.left_z[i] = dp_l.location.z + sidewalk_height;
+    }
+    return result;
+  }
+
+  LaneCornerPositions Lane::GetCornerPositions(
+      const double s_start, const double s_end, const double step,
+      const float extra_width) const {
+    RELEASE_ASSERT(step > 0.0);
+    std::vector<double> s_values;
+    s_values.reserve(static_cast<size_t>(std::max(0.0, (s_end - s_start) / step)) + 1u);
+    double s_current = s_start;
+    do {
+      s_values.emplace_back(s_current);
+      s_current += step;
+    } while (s_current < s_end);
+    return GetCornerPositions(s_values, extra_width);
+  }
+
 } // road
 } // carla
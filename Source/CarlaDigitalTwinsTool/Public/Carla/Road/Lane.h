@@ -22,6 +22,35 @@ namespace road {
   class MapBuilder;
   class Road;
 
+  /// Location of the edges of a lane at several s, stored as structure of
+  /// arrays. "right" and "left" are respectively the first and the second
+  /// edge returned by Lane::GetCornerPositions.
+  struct LaneCornerPositions {
+
+    std::vector<float> right_x, right_y, right_z;
+
+    std::vector<float> left_x, left_y, left_z;
+
+    size_t size() const {
+      return right_x.size();
+    }
+
+    void resize(size_t count) {
+      right_x.resize(count);
+      right_y.resize(count);
+      right_z.resize(count);
+      left_x.resize(count);
+      left_y.resize(count);
+      left_z.resize(count);
+    }
+
+    std::pair<geom::Vector3D, geom::Vector3D> operator[](size_t i) const {
+      return std::make_pair(
+          geom::Vector3D(right_x[i], right_y[i], right_z[i]),
+          geom::Vector3D(left_x[i], left_y[i], left_z[i]));
+    }
+  };
+
   class Lane : private MovableNonCopyable {
   public:
 
@@ -115,10 +144,23 @@ namespace road {
 
     geom::Transform ComputeTransform(const double s) const;
 
-    /// Computes the location of the edges given a s
+    /// Computes the location of the edges given a s, clamped to the road
     std::pair<geom::Vector3D, geom::Vector3D> GetCornerPositions(
       const double s, const float extra_width = 0.f) const;
 
+    /// Computes the location of the edges for every s in @a s_values. Gives
+    /// the same result as calling GetCornerPositions for each of them, but if
+    /// @a s_values is sorted the info records are walked only once and the
+    /// polynomials are evaluated in batch.
+    LaneCornerPositions GetCornerPositions(
+      const std::vector<double> &s_values, const float extra_width = 0.f) const;
+
+    /// Computes the location of the edges at s_start, s_start + step, ...
+    /// while s < s_end, with at least one sample at s_start.
+    LaneCornerPositions GetCornerPositions(
+      const double s_start, const double s_end, const double step,
+      const float extra_width = 0.f) const;
+
   private:
 
     friend MapBuilder;
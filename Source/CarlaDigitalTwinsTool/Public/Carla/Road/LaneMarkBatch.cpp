@@ -0,0 +1,160 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "Carla/Road/LaneMarkBatch.h"
+#include "Carla/Geom/Math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+namespace carla {
+namespace road {
+
+namespace {
+
+  /// Points hashed in a grid of cells of the size of the search distance,
+  /// so only the 3x3 cells around a point have to be checked.
+  class PointHash {
+  public:
+
+    explicit PointHash(float distance)
+      : _distance(distance),
+        _cell_size(std::max(distance, 1e-3f)) {}
+
+    bool HasPointCloserThan(const geom::Vector3D &point) const {
+      const int64_t x = Cell(point.x);
+      const int64_t y = Cell(point.y);
+      for (int64_t dx = -1; dx <= 1; ++dx) {
+        for (int64_t dy = -1; dy <= 1; ++dy) {
+          const auto it = _cells.find(Key(x + dx, y + dy));
+          if (it == _cells.end()) {
+            continue;
+          }
+          for (const auto &other : it->second) {
+            if (geom::Math::Distance(point, other) < _distance) {
+              return true;
+            }
+          }
+        }
+      }
+      return false;
+    }
+
+    void Insert(const geom::Vector3D &point) {
+      _cells[Key(Cell(point.x), Cell(point.y))].push_back(point);
+    }
+
+  private:
+
+    int64_t Cell(float coordinate) const {
+      return static_cast<int64_t>(std::floor(coordinate / _cell_size));
+    }
+
+    static uint64_t Key(int64_t x, int64_t y) {
+      return (static_cast<uint64_t>(x) << 32) ^ (static_cast<uint64_t>(y) & 0xffffffffu);
+    }
+
+    const float _distance;
+
+    const float _cell_size;
+
+    std::unordered_map<uint64_t, std::vector<geom::Vector3D>> _cells;
+  };
+
+  void AddSolid(const LaneMarkPiece &piece, geom::Mesh &mesh) {
+    if (mesh.GetMaterials().empty()) {
+      // A single material range so the exporters name the batch
+      mesh.AddMaterial(piece.material);
+    }
+    const size_t first = mesh.GetVerticesNum() + 1u;
+    mesh.AddVertices(piece.edges);
+    for (size_t i = 0u; i + 3u < piece.edges.size(); i += 2u) {
+      mesh.AddIndex(first + i);
+      mesh.AddIndex(first + i + 1u);
+      mesh.AddIndex(first + i + 2u);
+
+      mesh.AddIndex(first + i + 1u);
+      mesh.AddIndex(first + i + 3u);
+      mesh.AddIndex(first + i + 2u);
+    }
+  }
+
+  LaneMarkDash MakeDash(const LaneMarkPiece &piece) {
+    const geom::Vector3D start = (piece.edges[0] + piece.edges[1]) * 0.5f;
+    const geom::Vector3D end = (piece.edges[2] + piece.edges[3]) * 0.5f;
+    LaneMarkDash dash;
+    dash.location = (start + end) * 0.5f;
+    dash.yaw = geom::Math::ToDegrees(std::atan2(end.y - start.y, end.x - start.x));
+    dash.length = geom::Math::Distance(start, end);
+    dash.width = geom::Math::Distance(piece.edges[0], piece.edges[1]);
+    return dash;
+  }
+
+} // namespace
+
+  geom::Vector3D LaneMarkPiece::GetCentroid() const {
+    geom::Vector3D centroid;
+    for (const auto &edge : edges) {
+      centroid += edge;
+    }
+    return edges.empty() ? centroid : centroid / static_cast<float>(edges.size());
+  }
+
+  std::vector<LaneMarkBatch> MergeLaneMarkPieces(
+      const std::vector<LaneMarkPiece> &pieces,
+      const geom::Vector3D &minpos,
+      const geom::Vector3D &maxpos,
+      float duplicate_distance) {
+    const float min_x = std::min(minpos.x, maxpos.x);
+    const float max_x = std::max(minpos.x, maxpos.x);
+    const float min_y = std::min(minpos.y, maxpos.y);
+    const float max_y = std::max(minpos.y, maxpos.y);
+
+    // The pieces out of the tile are kept or dropped as well, without being
+    // merged, so whether a piece is a duplicate does not depend on the tile
+    // it falls in
+    PointHash kept(duplicate_distance);
+    std::map<std::string, LaneMarkBatch> batches;
+    for (const auto &piece : pieces) {
+      if (piece.edges.size() < 4u) {
+        continue;
+      }
+      const geom::Vector3D centroid = piece.GetCentroid();
+      if (kept.HasPointCloserThan(centroid)) {
+        continue;
+      }
+      const LaneMarkDash dash = piece.dash ? MakeDash(piece) : LaneMarkDash();
+      if (piece.dash && dash.length <= 0.0f) {
+        continue;
+      }
+      kept.Insert(centroid);
+      if (centroid.x < min_x || centroid.x >= max_x ||
+          centroid.y < min_y || centroid.y >= max_y) {
+        continue;
+      }
+      LaneMarkBatch &batch = batches[piece.material];
+      if (piece.dash) {
+        batch.dashes.push_back(dash);
+      } else {
+        AddSolid(piece, batch.mesh);
+      }
+    }
+
+    std::vector<LaneMarkBatch> result;
+    result.reserve(batches.size());
+    for (auto &batch : batches) {
+      batch.second.material = batch.first;
+      batch.second.mesh.EndMaterial();
+      result.push_back(std::move(batch.second));
+    }
+    return result;
+  }
+
+} // namespace road
+} // namespace carla
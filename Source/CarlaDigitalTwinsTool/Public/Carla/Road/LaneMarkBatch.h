@@ -0,0 +1,70 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Carla/Geom/Location.h>
+#include <Carla/Geom/Mesh.h>
+#include <Carla/Geom/Vector3D.h>
+
+namespace carla {
+namespace road {
+
+  /// Part of a lane mark as MeshFactory samples it, in the same space as the
+  /// lane mark meshes: the pairs of edges of a solid run along the lane, or
+  /// the two pairs of edges of a dash of a broken mark.
+  struct LaneMarkPiece {
+
+    std::string material;
+
+    bool dash = false;
+
+    std::vector<geom::Vector3D> edges;
+
+    geom::Vector3D GetCentroid() const;
+  };
+
+  /// Dash of a broken lane mark, a quad of @a length by @a width centered at
+  /// @a location and rotated @a yaw degrees around the Z axis.
+  struct LaneMarkDash {
+
+    geom::Location location;
+
+    float yaw = 0.0f;
+
+    float length = 0.0f;
+
+    float width = 0.0f;
+  };
+
+  /// Lane marks of a region sharing a material: the solid ones merged in a
+  /// single mesh and the dashes, meant to be drawn as instances of a quad.
+  struct LaneMarkBatch {
+
+    std::string material;
+
+    geom::Mesh mesh;
+
+    std::vector<LaneMarkDash> dashes;
+  };
+
+  /// Merges @a pieces in a batch per material, sorted by material. A piece
+  /// is skipped when its centroid is out of the box between @a minpos and
+  /// @a maxpos, in any corner order, so that a piece belongs to a single
+  /// tile, or closer than @a duplicate_distance to the centroid of a piece
+  /// kept before it in @a pieces, in the tile or not. @a pieces has to hold
+  /// the pieces around the box for the result not to depend on the tiles.
+  std::vector<LaneMarkBatch> MergeLaneMarkPieces(
+      const std::vector<LaneMarkPiece> &pieces,
+      const geom::Vector3D &minpos,
+      const geom::Vector3D &maxpos,
+      float duplicate_distance = 2.5f);
+
+} // namespace road
+} // namespace carla
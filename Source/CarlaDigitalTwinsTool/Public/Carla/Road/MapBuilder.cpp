@@ -5,7 +5,9 @@
 // For a copy, see <https://opensource.org/licenses/MIT>.
 
 #include "Carla/Road/MapBuilder.h"
+#include "Carla/Road/MapCache.h"
 #include "Carla/Logging.h"
+#include "Carla/Profiler/Profiler.h"
 #include "Carla/StringUtil.h"
 #include "Carla/Road/element/RoadInfoElevation.h"
 #include "Carla/Road/element/RoadInfoGeometry.h"
@@ -28,15 +30,17 @@
 #include "Carla/Road/SignalType.h"
 
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <algorithm>
+#include <unordered_map>
 
 using namespace carla::road::element;
 
 namespace carla {
 namespace road {
 
-  boost::optional<Map> MapBuilder::Build() {
+  boost::optional<Map> MapBuilder::Build(const MapCache *cache) {
 
     CreatePointersBetweenRoadSegments();
     RemoveZeroLaneValiditySignalReferences();
@@ -60,11 +64,17 @@ namespace road {
     _temp_road_info_container.clear();
     _temp_lane_info_container.clear();
 
+    // the roads are complete, so they can be flattened
+    _map_data._flat_data = FlatMapData(_map_data._roads);
+
     // _map_data is a memeber of MapBuilder so you must especify if
     // you want to keep it (will return copy -> Map(const Map &))
     // or move it (will return move -> Map(Map &&))
-    Map map(std::move(_map_data));
+    Map map = cache != nullptr ?
+        Map(std::move(_map_data), cache->GetRtreeElements()) :
+        Map(std::move(_map_data));
     CreateJunctionBoundingBoxes(map);
+    CreateRoadAndJunctionIndex(map);
     ComputeJunctionRoadConflicts(map);
     CheckSignalsOnRoads(map);
 
@@ -909,6 +919,81 @@ namespace road {
     }
   }
 
+  void MapBuilder::CreateRoadAndJunctionIndex(Map &map) {
+    using BPoint = Map::RoadIndex::BPoint;
+    using BBox = Map::RoadIndex::BBox;
+    // distance between the samples of the lane edges
+    constexpr double step = 1.0;
+    constexpr double epsilon = 100.0 * std::numeric_limits<double>::epsilon();
+
+    auto expand = [](BBox &box, float x, float y) {
+      boost::geometry::expand(box, BPoint(x, y));
+    };
+
+    std::vector<Map::RoadIndex::TreeElement> road_elements;
+    road_elements.reserve(map._data.GetRoads().size());
+    std::unordered_map<JuncId, BBox> junction_boxes;
+    std::vector<double> s_values;
+    for (const auto &road_pair : map._data.GetRoads()) {
+      const Road &road = road_pair.second;
+      BBox box;
+      boost::geometry::assign_inverse(box);
+      for (const LaneSection &lane_section : road.GetLaneSections()) {
+        const auto &lanes = lane_section.GetLanes();
+        if (lanes.empty()) {
+          continue;
+        }
+        const double s_start = lane_section.GetDistance() + epsilon;
+        const double s_end = lane_section.GetDistance() + lane_section.GetLength() - epsilon;
+        s_values.clear();
+        for (double s = s_start; s < s_end; s += step) {
+          s_values.push_back(s);
+        }
+        s_values.push_back(std::max(s_start, s_end));
+        // The outer edges of the outermost lanes bound the whole section
+        for (const Lane *lane : {&lanes.begin()->second, &lanes.rbegin()->second}) {
+          const LaneCornerPositions corners = lane->GetCornerPositions(s_values);
+          for (size_t i = 0u; i < corners.size(); ++i) {
+            expand(box, corners.right_x[i], corners.right_y[i]);
+            expand(box, corners.left_x[i], corners.left_y[i]);
+          }
+        }
+      }
+      if (boost::geometry::get<0, 0>(box) > boost::geometry::get<1, 0>(box)) {
+        continue;
+      }
+      road_elements.emplace_back(box, road_pair.first);
+      if (road.IsJunction()) {
+        auto it = junction_boxes.find(road.GetJunctionId());
+        if (it == junction_boxes.end()) {
+          junction_boxes.emplace(road.GetJunctionId(), box);
+        } else {
+          boost::geometry::expand(it->second, box);
+        }
+      }
+    }
+    map._road_index.BulkLoad(road_elements);
+
+    std::vector<Map::JunctionIndex::TreeElement> junction_elements;
+    junction_elements.reserve(map._data.GetJunctions().size());
+    for (const auto &junction_pair : map._data.GetJunctions()) {
+      // The bounding box follows the lane centers, the roads of the
+      // junction add the width of the lanes
+      const geom::BoundingBox bounding_box = junction_pair.second.GetBoundingBox();
+      BBox box(
+          BPoint(bounding_box.location.x - bounding_box.extent.x,
+              bounding_box.location.y - bounding_box.extent.y),
+          BPoint(bounding_box.location.x + bounding_box.extent.x,
+              bounding_box.location.y + bounding_box.extent.y));
+      auto it = junction_boxes.find(junction_pair.first);
+      if (it != junction_boxes.end()) {
+        boost::geometry::expand(box, it->second);
+      }
+      junction_elements.emplace_back(box, junction_pair.first);
+    }
+    map._junction_index.BulkLoad(junction_elements);
+  }
+
 void MapBuilder::CreateController(
   const ContId controller_id,
   const std::string controller_name,
@@ -938,9 +1023,23 @@ void MapBuilder::CreateController(
 }
 
   void MapBuilder::ComputeJunctionRoadConflicts(Map &map) {
+    std::vector<Junction *> junctions;
     for (auto &junctionpair : map._data.GetJunctions()) {
-      auto& junction = junctionpair.second;
-      junction._road_conflicts = (map.ComputeJunctionConflicts(junction.GetId()));
+      junctions.push_back(&junctionpair.second);
+    }
+    std::vector<size_t> segment_counts(junctions.size(), 0u);
+    std::vector<size_t> pair_counts(junctions.size(), 0u);
+
+    // Each junction only reads the map and writes its own conflicts
+    map._pool->ParallelFor(junctions.size(), [&](size_t item, size_t) {
+      Junction *junction = junctions[item];
+      junction->_road_conflicts = map.ComputeJunctionConflicts(
+          junction->GetId(), segment_counts[item], pair_counts[item]);
+    });
+
+    for (size_t i = 0u; i < junctions.size(); ++i) {
+      CARLA_PROFILE_COUNT(MapBuilder, JunctionConflictSegments, segment_counts[i]);
+      CARLA_PROFILE_COUNT(MapBuilder, JunctionConflictPairs, pair_counts[i]);
     }
   }
 
@@ -19,10 +19,15 @@
 namespace carla {
 namespace road {
 
+  class MapCache;
+
   class MapBuilder {
   public:
 
-    boost::optional<Map> Build();
+    /// Builds the map. If @a cache is not null, it must be valid for the
+    /// parsed OpenDRIVE and its precomputed data is used instead of
+    /// computing it again.
+    boost::optional<Map> Build(const MapCache *cache = nullptr);
 
     // called from road parser
     carla::road::Road *AddRoad(
@@ -374,6 +379,9 @@ namespace road {
     /// Create the bounding boxes of each junction
     void CreateJunctionBoundingBoxes(Map &map);
 
+    /// Create the spatial index of the extents of the roads and junctions
+    void CreateRoadAndJunctionIndex(Map &map);
+
     geom::Transform ComputeSignalTransform(std::unique_ptr<Signal> &signal,  MapData &data);
 
     /// Solves the signal references in the road
@@ -0,0 +1,116 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "Carla/Road/MapCache.h"
+
+#include "Carla/Debug.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace carla {
+namespace road {
+
+  static constexpr char CacheMagic[8] = {'C', 'R', 'L', 'M', 'A', 'P', 'C', '\0'};
+
+  MapCache::MapCache(const uint8_t *data, size_t size)
+    : _data(data),
+      _size(data != nullptr ? size : 0u) {
+    static_assert(std::is_trivially_copyable<Header>::value, "Header must be trivially copyable.");
+    static_assert(std::is_trivially_copyable<SegmentRecord>::value, "SegmentRecord must be trivially copyable.");
+  }
+
+  const MapCache::Header *MapCache::GetHeader() const {
+    if (_size < sizeof(Header) ||
+        reinterpret_cast<uintptr_t>(_data) % alignof(Header) != 0u) {
+      return nullptr;
+    }
+    return reinterpret_cast<const Header *>(_data);
+  }
+
+  bool MapCache::IsValidFor(uint64_t content_hash) const {
+    const Header *header = GetHeader();
+    if (header == nullptr ||
+        std::memcmp(header->magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+        header->version != Version ||
+        header->record_size != sizeof(SegmentRecord) ||
+        header->content_hash != content_hash) {
+      return false;
+    }
+    return header->record_count <= (_size - sizeof(Header)) / sizeof(SegmentRecord);
+  }
+
+  std::vector<Map::RtreeElement> MapCache::GetRtreeElements() const {
+    const Header *header = GetHeader();
+    DEBUG_ASSERT(header != nullptr);
+    const auto *records = reinterpret_cast<const SegmentRecord *>(_data + sizeof(Header));
+
+    using BPoint = geom::SegmentCloudRtree<element::Waypoint>::BPoint;
+    using BSegment = geom::SegmentCloudRtree<element::Waypoint>::BSegment;
+
+    std::vector<Map::RtreeElement> elements;
+    elements.reserve(header->record_count);
+    for (size_t i = 0; i < header->record_count; ++i) {
+      const SegmentRecord &record = records[i];
+      elements.emplace_back(
+          BSegment(
+              BPoint(record.start[0], record.start[1], record.start[2]),
+              BPoint(record.end[0], record.end[1], record.end[2])),
+          std::make_pair(record.waypoints[0], record.waypoints[1]));
+    }
+    return elements;
+  }
+
+  uint64_t MapCache::ComputeHash(const std::string &opendrive) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : opendrive) {
+      hash ^= static_cast<uint8_t>(c);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+  std::vector<uint8_t> MapCache::Serialize(const Map &map, uint64_t content_hash) {
+    const std::vector<Map::RtreeElement> elements = map.GetRtreeElements();
+
+    // Value initialized, so the padding written to the file is zero
+    Header header{};
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version = Version;
+    header.record_size = sizeof(SegmentRecord);
+    header.content_hash = content_hash;
+    header.record_count = elements.size();
+
+    std::vector<uint8_t> buffer(sizeof(Header) + elements.size() * sizeof(SegmentRecord));
+    std::memcpy(buffer.data(), &header, sizeof(Header));
+
+    uint8_t *out = buffer.data() + sizeof(Header);
+    for (const auto &element : elements) {
+      const auto &segment = element.first;
+      SegmentRecord record{};
+      record.start[0] = segment.first.get<0>();
+      record.start[1] = segment.first.get<1>();
+      record.start[2] = segment.first.get<2>();
+      record.end[0] = segment.second.get<0>();
+      record.end[1] = segment.second.get<1>();
+      record.end[2] = segment.second.get<2>();
+      // Field by field, an assignment of the whole waypoint may copy the
+      // padding of the source
+      const element::Waypoint *waypoints[2] = {&element.second.first, &element.second.second};
+      for (size_t i = 0u; i < 2u; ++i) {
+        record.waypoints[i].road_id = waypoints[i]->road_id;
+        record.waypoints[i].section_id = waypoints[i]->section_id;
+        record.waypoints[i].lane_id = waypoints[i]->lane_id;
+        record.waypoints[i].s = waypoints[i]->s;
+      }
+      std::memcpy(out, &record, sizeof(SegmentRecord));
+      out += sizeof(SegmentRecord);
+    }
+    return buffer;
+  }
+
+} // namespace road
+} // namespace carla
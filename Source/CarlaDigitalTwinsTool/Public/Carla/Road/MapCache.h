@@ -0,0 +1,73 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "Carla/NonCopyable.h"
+#include "Carla/Road/RoadMap.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace carla {
+namespace road {
+
+  /// Read-only view of a binary snapshot of the precomputed data of a Map,
+  /// usually stored next to the OpenDRIVE file as "<file>.xodr.bin".
+  ///
+  /// The snapshot is keyed by a hash of the OpenDRIVE content, so a modified
+  /// file invalidates it. The buffer is not copied, it can be a memory mapped
+  /// file and it must outlive this object.
+  ///
+  /// Layout: a fixed size header followed by an array of segment records.
+  /// Everything is stored in the native endianness.
+  class MapCache : private NonCopyable {
+  public:
+
+    static constexpr uint32_t Version = 1u;
+
+    MapCache(const uint8_t *data, size_t size);
+
+    /// Whether the snapshot is well formed, has the current version and was
+    /// generated from an OpenDRIVE with @a content_hash.
+    bool IsValidFor(uint64_t content_hash) const;
+
+    /// Return the segments of the waypoint R-tree stored in the snapshot.
+    std::vector<Map::RtreeElement> GetRtreeElements() const;
+
+    /// FNV-1a hash of the OpenDRIVE content.
+    static uint64_t ComputeHash(const std::string &opendrive);
+
+    /// Serializes the precomputed data of @a map for an OpenDRIVE with
+    /// @a content_hash.
+    static std::vector<uint8_t> Serialize(const Map &map, uint64_t content_hash);
+
+  private:
+
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t record_size;
+      uint64_t content_hash;
+      uint64_t record_count;
+    };
+
+    struct SegmentRecord {
+      float start[3];
+      float end[3];
+      element::Waypoint waypoints[2];
+    };
+
+    const Header *GetHeader() const;
+
+    const uint8_t *_data;
+
+    size_t _size;
+  };
+
+} // namespace road
+} // namespace carla
@@ -11,6 +11,7 @@
 #include "Carla/ListView.h"
 #include "Carla/NonCopyable.h"
 #include "Carla/Road/Controller.h"
+#include "Carla/Road/FlatMapData.h"
 #include "Carla/Road/element/RoadInfo.h"
 #include "Carla/Road/Junction.h"
 #include "Carla/Road/Road.h"
@@ -85,6 +86,12 @@ namespace road {
       return _controllers;
     }
 
+    /// The roads, sections and lanes in contiguous arrays, see FlatMapData.
+    /// Empty until MapBuilder completes the map.
+    const FlatMapData &GetFlatData() const {
+      return _flat_data;
+    }
+
   private:
 
     friend class MapBuilder;
@@ -100,6 +107,8 @@ namespace road {
     std::unordered_map<SignId, std::unique_ptr<Signal>> _signals;
 
     std::unordered_map<ContId, std::unique_ptr<Controller>> _controllers;
+
+    FlatMapData _flat_data;
   };
 
 } // namespace road
@@ -6,10 +6,12 @@
 
 #include <Carla/Road/MeshFactory.h>
 
+#include <algorithm>
 #include <vector>
 #include <Carla/Road/Road.h>
 #include <Carla/Road/LaneSection.h>
 #include <Carla/Road/Lane.h>
+#include <Carla/Geom/Math.h>
 #include <Carla/Geom/Vector3D.h>
 #include <Carla/Geom/Rtree.h>
 #include <Carla/Road/element/LaneMarking.h>
@@ -33,20 +35,86 @@ namespace geom {
   static constexpr double EPSILON = 10.0 * std::numeric_limits<double>::epsilon();
   static constexpr double MESH_EPSILON = 50.0 * std::numeric_limits<double>::epsilon();
 
+  /// Computes the edges of @a lane at the same s the generators used to step
+  /// through one by one: from @a s_start every @a resolution while s < s_end
+  /// (or only at s_start if @a only_start), plus a last sample right before
+  /// @a s_end so there are no gaps between roads.
+  static road::LaneCornerPositions ComputeLaneEdges(
+      const road::Lane &lane,
+      const double s_start,
+      const double s_end,
+      const float resolution,
+      const float extra_width,
+      const bool only_start = false) {
+    std::vector<double> s_values;
+    if (!only_start) {
+      s_values.reserve(static_cast<size_t>((s_end - s_start) / resolution) + 2u);
+    }
+    double s_current = s_start;
+    if (only_start) {
+      s_values.emplace_back(s_current);
+    } else {
+      do {
+        s_values.emplace_back(s_current);
+        s_current += resolution;
+      } while (s_current < s_end);
+    }
+    if (s_end - (s_current - resolution) > EPSILON) {
+      s_values.emplace_back(s_end - MESH_EPSILON);
+    }
+    return lane.GetCornerPositions(s_values, extra_width);
+  }
+
+  /// Surface frame of a row of lane edges: the normal, facing upwards, and
+  /// the tangent across the lane, from the first edge to the second.
+  struct LaneRowFrame {
+    Vector3D normal;
+    Vector3D tangent;
+  };
+
+  /// Frame of the row @a row of @a lane_edges, from the direction of the
+  /// lane, between the rows around it, and the lateral vector of the row.
+  static LaneRowFrame ComputeLaneRowFrame(
+      const road::LaneCornerPositions &lane_edges, size_t row) {
+    const size_t rows = lane_edges.size();
+    const auto edges = lane_edges[row];
+    const auto previous = lane_edges[row > 0u ? row - 1u : row];
+    const auto next = lane_edges[row + 1u < rows ? row + 1u : row];
+    const Vector3D direction =
+        (next.first + next.second) - (previous.first + previous.second);
+    Vector3D lateral = edges.second - edges.first;
+    if (lateral.SquaredLength() <= 1e-12f) {
+      // Lane without width, across is horizontal
+      lateral = Math::Cross(direction, Vector3D(0.0f, 0.0f, 1.0f));
+    }
+    Vector3D normal = Math::Cross(direction, lateral);
+    if (normal.SquaredLength() <= 1e-12f) {
+      normal = Vector3D(0.0f, 0.0f, 1.0f);
+    } else if (normal.z < 0.0f) {
+      normal *= -1.0f;
+    }
+    normal = normal.MakeUnitVector();
+    Vector3D tangent = lateral - normal * Math::Dot(lateral, normal);
+    if (tangent.SquaredLength() <= 1e-12f) {
+      tangent = Vector3D(1.0f, 0.0f, 0.0f) - normal * normal.x;
+    }
+    return LaneRowFrame{normal, tangent.MakeSafeUnitVector(1e-6f)};
+  }
+
   std::unique_ptr<Mesh> MeshFactory::Generate(const road::Road &road) const {
     Mesh out_mesh;
     for (auto &&lane_section : road.GetLaneSections()) {
-      out_mesh += *Generate(lane_section);
+      out_mesh += std::move(*Generate(lane_section));
     }
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   std::unique_ptr<Mesh> MeshFactory::Generate(const road::LaneSection &lane_section) const {
     Mesh out_mesh;
     for (auto &&lane_pair : lane_section.GetLanes()) {
-      out_mesh += *Generate(lane_pair.second);
+      out_mesh += std::move(*Generate(lane_pair.second));
     }
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   std::unique_ptr<Mesh> MeshFactory::Generate(const road::Lane &lane) const {
@@ -71,44 +139,39 @@ namespace geom {
     // The lane with lane_id 0 have no physical representation in OpenDRIVE
     Mesh out_mesh;
     if (lane.GetId() == 0) {
-      return std::make_unique<Mesh>(out_mesh);
+      return std::make_unique<Mesh>(std::move(out_mesh));
     }
-    double s_current = s_start;
 
-    std::vector<geom::Vector3D> vertices;
-    if (lane.IsStraight()) {
-      // Mesh optimization: If the lane is straight just add vertices at the
-      // begining and at the end of it
-      const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-      vertices.push_back(edges.first);
-      vertices.push_back(edges.second);
-    } else {
-      // Iterate over the lane's 's' and store the vertices based on it's width
-      do {
-        // Get the location of the edges of the current lane at the current waypoint
-        const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-        vertices.push_back(edges.first);
-        vertices.push_back(edges.second);
+    // Mesh optimization: If the lane is straight just add vertices at the
+    // begining and at the end of it
+    const auto lane_edges = ComputeLaneEdges(
+        lane, s_start, s_end, road_param.resolution, road_param.extra_lane_width,
+        lane.IsStraight());
 
-        // Update the current waypoint's "s"
-        s_current += road_param.resolution;
-      } while(s_current < s_end);
-    }
-
-    // This ensures the mesh is constant and have no gaps between roads,
-    // adding geometry at the very end of the lane
-    if (s_end - (s_current - road_param.resolution) > EPSILON) {
-      const auto edges = lane.GetCornerPositions(s_end - MESH_EPSILON, road_param.extra_lane_width);
+    std::vector<geom::Vector3D> vertices;
+    std::vector<geom::Vector3D> normals;
+    std::vector<geom::Vector3D> tangents;
+    vertices.reserve(2u * lane_edges.size());
+    normals.reserve(2u * lane_edges.size());
+    tangents.reserve(2u * lane_edges.size());
+    for (size_t i = 0u; i < lane_edges.size(); ++i) {
+      const auto edges = lane_edges[i];
       vertices.push_back(edges.first);
       vertices.push_back(edges.second);
+      const LaneRowFrame frame = ComputeLaneRowFrame(lane_edges, i);
+      normals.insert(normals.end(), 2u, frame.normal);
+      tangents.insert(tangents.end(), 2u, frame.tangent);
     }
 
     // Add the adient material, create the strip and close the material
+    out_mesh.Reserve(vertices.size(), 3u * (vertices.size() - 2u));
     out_mesh.AddMaterial(
         lane.GetType() == road::Lane::LaneType::Sidewalk ? "sidewalk" : "road");
     out_mesh.AddTriangleStrip(vertices);
     out_mesh.EndMaterial();
-    return std::make_unique<Mesh>(out_mesh);
+    out_mesh.AddNormals(std::move(normals));
+    out_mesh.AddTangents(std::move(tangents));
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   std::unique_ptr<Mesh> MeshFactory::GenerateTesselated(
@@ -121,9 +184,8 @@ namespace geom {
     // The lane with lane_id 0 have no physical representation in OpenDRIVE
     Mesh out_mesh;
     if (lane.GetId() == 0) {
-      return std::make_unique<Mesh>(out_mesh);
+      return std::make_unique<Mesh>(std::move(out_mesh));
     }
-    double s_current = s_start;
 
     std::vector<geom::Vector3D> vertices;
     // Ensure minimum vertices in width are two
@@ -133,10 +195,19 @@ namespace geom {
     std::vector<geom::Vector2D> uvs;
     int uvx = 0;
     int uvy = 0;
-    // Iterate over the lane's 's' and store the vertices based on it's width
-    do {
-      // Get the location of the edges of the current lane at the current waypoint
-      std::pair<geom::Vector3D, geom::Vector3D> edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
+    // Get the location of the edges of the current lane at every waypoint and
+    // store the vertices based on it's width
+    const auto lane_edges = ComputeLaneEdges(
+        lane, s_start, s_end, road_param.resolution, road_param.extra_lane_width);
+    // The whole row shares the frame, the lane is flat across
+    std::vector<geom::Vector3D> normals;
+    std::vector<geom::Vector3D> tangents;
+    vertices.reserve(lane_edges.size() * vertices_in_width);
+    uvs.reserve(lane_edges.size() * vertices_in_width);
+    normals.reserve(lane_edges.size() * vertices_in_width);
+    tangents.reserve(lane_edges.size() * vertices_in_width);
+    for (size_t row = 0u; row < lane_edges.size(); ++row) {
+      const auto edges = lane_edges[row];
       const geom::Vector3D segments_size = ( edges.second - edges.first ) / segments_number;
       geom::Vector3D current_vertex = edges.first;
       uvx = 0;
@@ -146,37 +217,22 @@ namespace geom {
         current_vertex = current_vertex + segments_size;
         uvx++;
       }
+      const LaneRowFrame frame = ComputeLaneRowFrame(lane_edges, row);
+      normals.insert(normals.end(), static_cast<size_t>(vertices_in_width), frame.normal);
+      tangents.insert(tangents.end(), static_cast<size_t>(vertices_in_width), frame.tangent);
       uvy++;
-      // Update the current waypoint's "s"
-      s_current += road_param.resolution;
-    } while (s_current < s_end);
-
-    // This ensures the mesh is constant and have no gaps between roads,
-    // adding geometry at the very end of the lane
-
-    if (s_end - (s_current - road_param.resolution) > EPSILON) {
-      std::pair<carla::geom::Vector3D, carla::geom::Vector3D> edges =
-        lane.GetCornerPositions(s_end - MESH_EPSILON, road_param.extra_lane_width);
-      const geom::Vector3D segments_size = (edges.second - edges.first) / segments_number;
-      geom::Vector3D current_vertex = edges.first;
-      uvx = 0;
-      for (int i = 0; i < vertices_in_width; ++i)
-      {
-        uvs.push_back(geom::Vector2D(uvx, uvy));
-        vertices.push_back(current_vertex);
-        current_vertex = current_vertex + segments_size;
-        uvx++;
-      }
     }
-    out_mesh.AddVertices(vertices);
-    out_mesh.AddUVs(uvs);
+    const size_t number_of_rows = (vertices.size() / vertices_in_width);
+    out_mesh.AddVertices(std::move(vertices));
+    out_mesh.AddUVs(std::move(uvs));
+    out_mesh.AddNormals(std::move(normals));
+    out_mesh.AddTangents(std::move(tangents));
+    out_mesh.Reserve(0u, (number_of_rows - 1) * (vertices_in_width - 1) * 6u);
 
     // Add the adient material, create the strip and close the material
     out_mesh.AddMaterial(
       lane.GetType() == road::Lane::LaneType::Sidewalk ? "sidewalk" : "road");
 
-    const size_t number_of_rows = (vertices.size() / vertices_in_width);
-
     for (size_t i = 0; i < (number_of_rows - 1); ++i) {
       for (size_t j = 0; j < vertices_in_width - 1; ++j) {
         out_mesh.AddIndex(   j       + (   i       * vertices_in_width ) + 1);
@@ -189,7 +245,7 @@ namespace geom {
       }
     }
     out_mesh.EndMaterial();
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
 
@@ -214,25 +270,25 @@ namespace geom {
         case road::Lane::LaneType::Parking:
         case road::Lane::LaneType::Bidirectional:
         {
-          out_mesh += *GenerateTesselated(lane_pair.second);
+          out_mesh += std::move(*GenerateTesselated(lane_pair.second));
           break;
         }
         case road::Lane::LaneType::Shoulder:
         case road::Lane::LaneType::Sidewalk:
         case road::Lane::LaneType::Biking:
         {
-          out_mesh += *GenerateSidewalk(lane_pair.second);
+          out_mesh += std::move(*GenerateSidewalk(lane_pair.second));
           break;
         }
         default:
         {
-          out_mesh += *GenerateTesselated(lane_pair.second);
+          out_mesh += std::move(*GenerateTesselated(lane_pair.second));
           break;
         }
       }
 
       if( result[lane_pair.second.GetType()].size() <= PosToAdd ){
-        result[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(out_mesh));
+        result[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(std::move(out_mesh)));
       } else {
         uint32_t verticesinwidth  = SelectVerticesInWidth(vertices_in_width, lane_pair.second.GetType());
         (result[lane_pair.second.GetType()][PosToAdd])->ConcatMesh(out_mesh, verticesinwidth);
@@ -246,9 +302,9 @@ namespace geom {
     for (auto &&lane_pair : lane_section.GetLanes()) {
       const double s_start = lane_pair.second.GetDistance() + EPSILON;
       const double s_end = lane_pair.second.GetDistance() + lane_pair.second.GetLength() - EPSILON;
-      out_mesh += *GenerateSidewalk(lane_pair.second, s_start, s_end);
+      out_mesh += std::move(*GenerateSidewalk(lane_pair.second, s_start, s_end));
     }
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
   std::unique_ptr<Mesh> MeshFactory::GenerateSidewalk(const road::Lane &lane) const{
     const double s_start = lane.GetDistance() + EPSILON;
@@ -267,9 +323,8 @@ namespace geom {
     // The lane with lane_id 0 have no physical representation in OpenDRIVE
     Mesh out_mesh;
     if (lane.GetId() == 0) {
-      return std::make_unique<Mesh>(out_mesh);
+      return std::make_unique<Mesh>(std::move(out_mesh));
     }
-    double s_current = s_start;
 
     std::vector<geom::Vector3D> vertices;
     // Ensure minimum vertices in width are two
@@ -278,11 +333,29 @@ namespace geom {
     std::vector<geom::Vector2D> uvs;
     int uvy = 0;
 
-    // Iterate over the lane's 's' and store the vertices based on it's width
-    do {
-      // Get the location of the edges of the current lane at the current waypoint
-      std::pair<geom::Vector3D, geom::Vector3D> edges =
-        lane.GetCornerPositions(s_current, road_param.extra_lane_width);
+    // Get the location of the edges of the current lane at every waypoint and
+    // store the vertices based on it's width
+    const auto lane_edges = ComputeLaneEdges(
+        lane, s_start, s_end, road_param.resolution, road_param.extra_lane_width);
+    // The top shares the frame of the row, the sides face away from the
+    // lane and their U grows from the bottom up on the first edge and from
+    // the top down on the second
+    std::vector<geom::Vector3D> normals;
+    std::vector<geom::Vector3D> tangents;
+    vertices.reserve(lane_edges.size() * vertices_in_width);
+    uvs.reserve(lane_edges.size() * vertices_in_width);
+    normals.reserve(lane_edges.size() * vertices_in_width);
+    tangents.reserve(lane_edges.size() * vertices_in_width);
+    for (size_t row = 0u; row < lane_edges.size(); ++row) {
+      const auto edges = lane_edges[row];
+      const LaneRowFrame frame = ComputeLaneRowFrame(lane_edges, row);
+      const geom::Vector3D up(0.0f, 0.0f, 1.0f);
+      normals.insert(normals.end(), 2u, frame.tangent * -1.0f);
+      tangents.insert(tangents.end(), 2u, up);
+      normals.insert(normals.end(), 2u, frame.normal);
+      tangents.insert(tangents.end(), 2u, frame.tangent);
+      normals.insert(normals.end(), 2u, frame.tangent);
+      tangents.insert(tangents.end(), 2u, up * -1.0f);
 
       geom::Vector3D low_vertex_first = edges.first - geom::Vector3D(0,0,1);
       geom::Vector3D low_vertex_second = edges.second - geom::Vector3D(0,0,1);
@@ -304,49 +377,20 @@ namespace geom {
       vertices.push_back(low_vertex_second);
       uvs.push_back(geom::Vector2D(3, uvy));
 
-      // Update the current waypoint's "s"
-      s_current += road_param.resolution;
       uvy++;
-    } while (s_current < s_end);
-
-    // This ensures the mesh is constant and have no gaps between roads,
-    // adding geometry at the very end of the lane
-
-    if (s_end - (s_current - road_param.resolution) > EPSILON) {
-      std::pair<carla::geom::Vector3D, carla::geom::Vector3D> edges =
-        lane.GetCornerPositions(s_end - MESH_EPSILON, road_param.extra_lane_width);
-
-      geom::Vector3D low_vertex_first = edges.first - geom::Vector3D(0,0,1);
-      geom::Vector3D low_vertex_second = edges.second - geom::Vector3D(0,0,1);
-
-      vertices.push_back(low_vertex_first);
-      uvs.push_back(geom::Vector2D(0, uvy));
-
-      vertices.push_back(edges.first);
-      uvs.push_back(geom::Vector2D(1, uvy));
-
-      vertices.push_back(edges.first);
-      uvs.push_back(geom::Vector2D(1, uvy));
-
-      vertices.push_back(edges.second);
-      uvs.push_back(geom::Vector2D(2, uvy));
-
-      vertices.push_back(edges.second);
-      uvs.push_back(geom::Vector2D(2, uvy));
-
-      vertices.push_back(low_vertex_second);
-      uvs.push_back(geom::Vector2D(3, uvy));
-
     }
 
-    out_mesh.AddVertices(vertices);
-    out_mesh.AddUVs(uvs);
+    const int number_of_rows = (vertices.size() / vertices_in_width);
+    out_mesh.AddVertices(std::move(vertices));
+    out_mesh.AddUVs(std::move(uvs));
+    out_mesh.AddNormals(std::move(normals));
+    out_mesh.AddTangents(std::move(tangents));
+    // Three of the five quads of each row are closed
+    out_mesh.Reserve(0u, (number_of_rows - 1) * 3u * 6u);
     // Add the adient material, create the strip and close the material
     out_mesh.AddMaterial(
       lane.GetType() == road::Lane::LaneType::Sidewalk ? "sidewalk" : "road");
 
-    const int number_of_rows = (vertices.size() / vertices_in_width);
-
     for (size_t i = 0; i < (number_of_rows - 1); ++i) {
       for (size_t j = 0; j < vertices_in_width - 1; ++j) {
 
@@ -365,7 +409,7 @@ namespace geom {
       }
     }
     out_mesh.EndMaterial();
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
   std::unique_ptr<Mesh> MeshFactory::GenerateWalls(const road::LaneSection &lane_section) const {
     Mesh out_mesh;
@@ -380,13 +424,13 @@ namespace geom {
       const double s_start = lane.GetDistance() + EPSILON;
       const double s_end = lane.GetDistance() + lane.GetLength() - EPSILON;
       if (lane.GetId() == max_lane) {
-        out_mesh += *GenerateLeftWall(lane, s_start, s_end);
+        out_mesh += std::move(*GenerateLeftWall(lane, s_start, s_end));
       }
       if (lane.GetId() == min_lane) {
-        out_mesh += *GenerateRightWall(lane, s_start, s_end);
+        out_mesh += std::move(*GenerateRightWall(lane, s_start, s_end));
       }
     }
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   std::unique_ptr<Mesh> MeshFactory::GenerateRightWall(
@@ -399,45 +443,31 @@ namespace geom {
     // The lane with lane_id 0 have no physical representation in OpenDRIVE
     Mesh out_mesh;
     if (lane.GetId() == 0) {
-      return std::make_unique<Mesh>(out_mesh);
+      return std::make_unique<Mesh>(std::move(out_mesh));
     }
-    double s_current = s_start;
     const geom::Vector3D height_vector = geom::Vector3D(0.f, 0.f, road_param.wall_height);
 
-    std::vector<geom::Vector3D> r_vertices;
-    if (lane.IsStraight()) {
-      // Mesh optimization: If the lane is straight just add vertices at the
-      // begining and at the end of it
-      const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-      r_vertices.push_back(edges.first + height_vector);
-      r_vertices.push_back(edges.first);
-    } else {
-      // Iterate over the lane's 's' and store the vertices based on it's width
-      do {
-        // Get the location of the edges of the current lane at the current waypoint
-        const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-        r_vertices.push_back(edges.first + height_vector);
-        r_vertices.push_back(edges.first);
+    // Mesh optimization: If the lane is straight just add vertices at the
+    // begining and at the end of it
+    const auto lane_edges = ComputeLaneEdges(
+        lane, s_start, s_end, road_param.resolution, road_param.extra_lane_width,
+        lane.IsStraight());
 
-        // Update the current waypoint's "s"
-        s_current += road_param.resolution;
-      } while(s_current < s_end);
-    }
-
-    // This ensures the mesh is constant and have no gaps between roads,
-    // adding geometry at the very end of the lane
-    if (s_end - (s_current - road_param.resolution) > EPSILON) {
-      const auto edges = lane.GetCornerPositions(s_end - MESH_EPSILON, road_param.extra_lane_width);
+    std::vector<geom::Vector3D> r_vertices;
+    r_vertices.reserve(2u * lane_edges.size());
+    for (size_t i = 0u; i < lane_edges.size(); ++i) {
+      const auto edges = lane_edges[i];
       r_vertices.push_back(edges.first + height_vector);
       r_vertices.push_back(edges.first);
     }
 
     // Add the adient material, create the strip and close the material
+    out_mesh.Reserve(r_vertices.size(), 3u * (r_vertices.size() - 2u));
     out_mesh.AddMaterial(
         lane.GetType() == road::Lane::LaneType::Sidewalk ? "sidewalk" : "road");
     out_mesh.AddTriangleStrip(r_vertices);
     out_mesh.EndMaterial();
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   std::unique_ptr<Mesh> MeshFactory::GenerateLeftWall(
@@ -450,45 +480,31 @@ namespace geom {
     // The lane with lane_id 0 have no physical representation in OpenDRIVE
     Mesh out_mesh;
     if (lane.GetId() == 0) {
-      return std::make_unique<Mesh>(out_mesh);
+      return std::make_unique<Mesh>(std::move(out_mesh));
     }
-    double s_current = s_start;
     const geom::Vector3D height_vector = geom::Vector3D(0.f, 0.f, road_param.wall_height);
 
-    std::vector<geom::Vector3D> l_vertices;
-    if (lane.IsStraight()) {
-      // Mesh optimization: If the lane is straight just add vertices at the
-      // begining and at the end of it
-      const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-      l_vertices.push_back(edges.second);
-      l_vertices.push_back(edges.second + height_vector);
-    } else {
-      // Iterate over the lane's 's' and store the vertices based on it's width
-      do {
-        // Get the location of the edges of the current lane at the current waypoint
-        const auto edges = lane.GetCornerPositions(s_current, road_param.extra_lane_width);
-        l_vertices.push_back(edges.second);
-        l_vertices.push_back(edges.second + height_vector);
+    // Mesh optimization: If the lane is straight just add vertices at the
+    // begining and at the end of it
+    const auto lane_edges = ComputeLaneEdges(
+        lane, s_start, s_end, road_param.resolution, road_param.extra_lane_width,
+        lane.IsStraight());
 
-        // Update the current waypoint's "s"
-        s_current += road_param.resolution;
-      } while(s_current < s_end);
-    }
-
-    // This ensures the mesh is constant and have no gaps between roads,
-    // adding geometry at the very end of the lane
-    if (s_end - (s_current - road_param.resolution) > EPSILON) {
-      const auto edges = lane.GetCornerPositions(s_end - MESH_EPSILON, road_param.extra_lane_width);
+    std::vector<geom::Vector3D> l_vertices;
+    l_vertices.reserve(2u * lane_edges.size());
+    for (size_t i = 0u; i < lane_edges.size(); ++i) {
+      const auto edges = lane_edges[i];
       l_vertices.push_back(edges.second);
       l_vertices.push_back(edges.second + height_vector);
     }
 
     // Add the adient material, create the strip and close the material
+    out_mesh.Reserve(l_vertices.size(), 3u * (l_vertices.size() - 2u));
     out_mesh.AddMaterial(
         lane.GetType() == road::Lane::LaneType::Sidewalk ? "sidewalk" : "road");
     out_mesh.AddTriangleStrip(l_vertices);
     out_mesh.EndMaterial();
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   std::vector<std::unique_ptr<Mesh>> MeshFactory::GenerateWithMaxLen(
@@ -516,17 +532,17 @@ namespace geom {
         const auto s_until = s_current + road_param.max_road_len;
         Mesh lane_section_mesh;
         for (auto &&lane_pair : lane_section.GetLanes()) {
-          lane_section_mesh += *Generate(lane_pair.second, s_current, s_until);
+          lane_section_mesh += std::move(*Generate(lane_pair.second, s_current, s_until));
         }
-        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(lane_section_mesh));
+        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
         s_current = s_until;
       }
       if (s_end - s_current > EPSILON) {
         Mesh lane_section_mesh;
         for (auto &&lane_pair : lane_section.GetLanes()) {
-          lane_section_mesh += *Generate(lane_pair.second, s_current, s_end);
+          lane_section_mesh += std::move(*Generate(lane_pair.second, s_current, s_end));
         }
-        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(lane_section_mesh));
+        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
       }
     }
     return mesh_uptr_list;
@@ -566,19 +582,19 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
               case road::Lane::LaneType::Parking:
               case road::Lane::LaneType::Bidirectional:
               {
-                lane_section_mesh += *GenerateTesselated(lane_pair.second, s_current, s_until);
+                lane_section_mesh += std::move(*GenerateTesselated(lane_pair.second, s_current, s_until));
                 break;
               }
               case road::Lane::LaneType::Shoulder:
               case road::Lane::LaneType::Sidewalk:
               case road::Lane::LaneType::Biking:
               {
-                lane_section_mesh += *GenerateSidewalk(lane_pair.second, s_current, s_until);
+                lane_section_mesh += std::move(*GenerateSidewalk(lane_pair.second, s_current, s_until));
                 break;
               }
               default:
               {
-                 lane_section_mesh += *GenerateTesselated(lane_pair.second, s_current, s_until);
+                 lane_section_mesh += std::move(*GenerateTesselated(lane_pair.second, s_current, s_until));
                 break;
               }
             }
@@ -590,7 +606,7 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
 
             size_t PosToAdd = it - redirections.begin();
             if (mesh_uptr_list[lane_pair.second.GetType()].size() <= PosToAdd) {
-              mesh_uptr_list[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(lane_section_mesh));
+              mesh_uptr_list[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
             } else {
               uint32_t verticesinwidth = SelectVerticesInWidth(vertices_in_width, lane_pair.second.GetType());
               (mesh_uptr_list[lane_pair.second.GetType()][PosToAdd])->ConcatMesh(lane_section_mesh, verticesinwidth);
@@ -607,19 +623,19 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
               case road::Lane::LaneType::Parking:
               case road::Lane::LaneType::Bidirectional:
               {
-                lane_section_mesh += *GenerateTesselated(lane_pair.second, s_current, s_end);
+                lane_section_mesh += std::move(*GenerateTesselated(lane_pair.second, s_current, s_end));
                 break;
               }
               case road::Lane::LaneType::Shoulder:
               case road::Lane::LaneType::Sidewalk:
               case road::Lane::LaneType::Biking:
               {
-                lane_section_mesh += *GenerateSidewalk(lane_pair.second, s_current, s_end);
+                lane_section_mesh += std::move(*GenerateSidewalk(lane_pair.second, s_current, s_end));
                 break;
               }
               default:
               {
-                lane_section_mesh += *GenerateTesselated(lane_pair.second, s_current, s_end);
+                lane_section_mesh += std::move(*GenerateTesselated(lane_pair.second, s_current, s_end));
                 break;
               }
             }
@@ -633,7 +649,7 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
             size_t PosToAdd = it - redirections.begin();
 
             if (mesh_uptr_list[lane_pair.second.GetType()].size() <= PosToAdd) {
-              mesh_uptr_list[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(lane_section_mesh));
+              mesh_uptr_list[lane_pair.second.GetType()].push_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
             } else {
               *(mesh_uptr_list[lane_pair.second.GetType()][PosToAdd]) += lane_section_mesh;
             }
@@ -676,13 +692,13 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
         for (auto &&lane_pair : lane_section.GetLanes()) {
           const auto &lane = lane_pair.second;
           if (lane.GetId() == max_lane) {
-            lane_section_mesh += *GenerateLeftWall(lane, s_current, s_until);
+            lane_section_mesh += std::move(*GenerateLeftWall(lane, s_current, s_until));
           }
           if (lane.GetId() == min_lane) {
-            lane_section_mesh += *GenerateRightWall(lane, s_current, s_until);
+            lane_section_mesh += std::move(*GenerateRightWall(lane, s_current, s_until));
           }
         }
-        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(lane_section_mesh));
+        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
         s_current = s_until;
       }
       if (s_end - s_current > EPSILON) {
@@ -690,13 +706,13 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
         for (auto &&lane_pair : lane_section.GetLanes()) {
           const auto &lane = lane_pair.second;
           if (lane.GetId() == max_lane) {
-            lane_section_mesh += *GenerateLeftWall(lane, s_current, s_end);
+            lane_section_mesh += std::move(*GenerateLeftWall(lane, s_current, s_end));
           }
           if (lane.GetId() == min_lane) {
-            lane_section_mesh += *GenerateRightWall(lane, s_current, s_end);
+            lane_section_mesh += std::move(*GenerateRightWall(lane, s_current, s_end));
           }
         }
-        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(lane_section_mesh));
+        mesh_uptr_list.emplace_back(std::make_unique<Mesh>(std::move(lane_section_mesh)));
       }
     }
     return mesh_uptr_list;
@@ -898,7 +914,7 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
         out_mesh.AddVertex(edges.first);
         out_mesh.AddVertex(edges.second);
       }
-      inout.push_back(std::make_unique<Mesh>(out_mesh));
+      inout.push_back(std::make_unique<Mesh>(std::move(out_mesh)));
     }
   }
 
@@ -1040,10 +1056,125 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
         out_mesh.AddVertex(leftpoint.location);
 
       }
-      inout.push_back(std::make_unique<Mesh>(out_mesh));
+      inout.push_back(std::make_unique<Mesh>(std::move(out_mesh)));
+    }
+  }
+
+  void MeshFactory::GenerateLaneMarkPiecesForRoad(
+    const road::Road& road,
+    std::vector<road::LaneMarkPiece>& out_pieces) const
+  {
+    for (auto&& lane_section : road.GetLaneSections()) {
+      for (auto&& lane : lane_section.GetLanes()) {
+        if (lane.first != 0) {
+          switch(lane.second.GetType())
+          {
+            case road::Lane::LaneType::Driving:
+            case road::Lane::LaneType::Parking:
+            case road::Lane::LaneType::Bidirectional:
+            {
+              GenerateLaneMarkPiecesForLane(road, lane_section, lane.second, false, "white", out_pieces);
+              break;
+            }
+            default:
+              break;
+          }
+        } else {
+          if(lane.second.GetType() == road::Lane::LaneType::None ){
+            GenerateLaneMarkPiecesForLane(road, lane_section, lane.second, true, "yellow", out_pieces);
+          }
+        }
+      }
     }
   }
 
+  void MeshFactory::GenerateLaneMarkPiecesForLane(
+    const road::Road& road,
+    const road::LaneSection& lane_section,
+    const road::Lane& lane,
+    bool center_line,
+    const std::string& material,
+    std::vector<road::LaneMarkPiece>& out_pieces) const
+  {
+    const double s_start = lane_section.GetDistance();
+    const double s_end = lane_section.GetDistance() + lane_section.GetLength();
+    double s_current = s_start;
+
+    auto add_edges = [&](road::LaneMarkPiece& piece, double s, double width, bool solid) {
+      if (solid && center_line) {
+        carla::road::element::DirectedPoint rightpoint = road.GetDirectedPointIn(s);
+        carla::road::element::DirectedPoint leftpoint = rightpoint;
+
+        rightpoint.ApplyLateralOffset(width * 0.5);
+        leftpoint.ApplyLateralOffset(width * -0.5);
+
+        // Unreal's Y axis hack
+        rightpoint.location.y *= -1;
+        leftpoint.location.y *= -1;
+
+        piece.edges.push_back(rightpoint.location);
+        piece.edges.push_back(leftpoint.location);
+      } else {
+        std::pair<geom::Vector3D, geom::Vector3D> edges =
+          ComputeEdgesForLanemark(lane_section, lane, s, width);
+        piece.edges.push_back(edges.first);
+        piece.edges.push_back(edges.second);
+      }
+    };
+
+    // Solid run being sampled, closed where the mark stops being solid
+    road::LaneMarkPiece solid;
+    double solid_width = 0.0;
+    auto close_solid = [&](double s) {
+      if (!solid.edges.empty()) {
+        add_edges(solid, std::min(s, s_end), solid_width, true);
+        out_pieces.push_back(std::move(solid));
+        solid = road::LaneMarkPiece();
+      }
+    };
+
+    do {
+      const carla::road::element::RoadInfoMarkRecord* road_info_mark = lane.GetInfo<carla::road::element::RoadInfoMarkRecord>(s_current);
+      if (road_info_mark == nullptr) {
+        close_solid(s_current);
+        s_current += road_param.resolution;
+        continue;
+      }
+      carla::road::element::LaneMarking lane_mark_info(*road_info_mark);
+
+      switch (lane_mark_info.type) {
+        case carla::road::element::LaneMarking::Type::Solid: {
+          if (solid.edges.empty()) {
+            solid.material = material;
+          }
+          solid_width = lane_mark_info.width;
+          add_edges(solid, s_current, solid_width, true);
+          s_current += road_param.resolution;
+          break;
+        }
+        case carla::road::element::LaneMarking::Type::Broken: {
+          close_solid(s_current);
+          road::LaneMarkPiece dash;
+          dash.material = material;
+          dash.dash = true;
+          add_edges(dash, s_current, lane_mark_info.width, false);
+          s_current = std::min(s_current + road_param.resolution * 3, s_end);
+          add_edges(dash, s_current, lane_mark_info.width, false);
+          out_pieces.push_back(std::move(dash));
+          s_current += road_param.resolution * 3;
+          break;
+        }
+        default: {
+          close_solid(s_current);
+          s_current += road_param.resolution;
+          break;
+        }
+      }
+    } while (s_current < s_end);
+
+    close_solid(s_end);
+  }
+
   struct VertexWeight {
     Mesh::vertex_type* vertex;
     double weight;
@@ -1161,11 +1292,12 @@ std::map<road::Lane::LaneType , std::vector<std::unique_ptr<Mesh>>> MeshFactory:
       }
     }
 
+    out_mesh.ReserveToMerge(lane_meshes);
     for(auto &mesh : lane_meshes) {
       out_mesh += *mesh;
     }
 
-    return std::make_unique<Mesh>(out_mesh);
+    return std::make_unique<Mesh>(std::move(out_mesh));
   }
 
   uint32_t MeshFactory::SelectVerticesInWidth(uint32_t default_num_vertices, road::Lane::LaneType type)
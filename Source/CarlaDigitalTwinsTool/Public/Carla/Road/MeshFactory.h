@@ -12,6 +12,7 @@
 #include <Carla/Road/Road.h>
 #include <Carla/Road/LaneSection.h>
 #include <Carla/Road/Lane.h>
+#include <Carla/Road/LaneMarkBatch.h>
 #include <Carla/RPC/OpendriveGenerationParameters.h>
 
 namespace carla
@@ -133,6 +134,13 @@ namespace carla
           std::vector<std::unique_ptr<Mesh>> &inout,
           std::vector<std::string> &outinfo) const;
 
+      /// Samples the lane marks of @a road like GenerateLaneMarkForRoad, but
+      /// as separate pieces: one per solid run and one per dash, to be merged
+      /// by tile with road::MergeLaneMarkPieces.
+      void GenerateLaneMarkPiecesForRoad(
+          const road::Road &road,
+          std::vector<road::LaneMarkPiece> &out_pieces) const;
+
       // =========================================================================
       // -- Generation parameters ------------------------------------------------
       // =========================================================================
@@ -166,6 +174,16 @@ namespace carla
           const road::Lane &lane,
           const double s_current,
           const double lanemark_width) const;
+
+      // Samples the lane marks of a single lane, @a center_line for the one
+      // with id 0
+      void GenerateLaneMarkPiecesForLane(
+          const road::Road &road,
+          const road::LaneSection &lane_section,
+          const road::Lane &lane,
+          bool center_line,
+          const std::string &material,
+          std::vector<road::LaneMarkPiece> &out_pieces) const;
     };
 
   } // namespace geom
@@ -27,6 +27,8 @@
 
 #include "Carla/MarchingCube/MeshReconstruction.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 #include <stdexcept>
@@ -79,6 +81,28 @@ namespace road {
     }
   }
 
+  /// Waypoints at the start of each of the lanes @a lanes of @a flat, or at
+  /// their end if @a at_end, as GetSuccessors and GetPredecessors return them.
+  template <typename LaneIndexListT>
+  static std::vector<Waypoint> MakeLaneWaypoints(
+      const FlatMapData &flat,
+      const LaneIndexListT &lanes,
+      bool at_end) {
+    std::vector<Waypoint> result;
+    result.reserve(lanes.size());
+    for (const FlatMapData::Index index : lanes) {
+      const auto &lane = flat.GetLane(index);
+      RELEASE_ASSERT(lane.id != 0);
+      const auto &section = flat.GetSection(lane.section);
+      const bool forward = at_end ? lane.id > 0 : lane.id <= 0;
+      const double distance = forward ?
+          section.s + 10.0 * EPSILON :
+          section.s + section.length - 10.0 * EPSILON;
+      result.emplace_back(Waypoint{flat.GetRoad(section.road).id, section.id, lane.id, distance});
+    }
+    return result;
+  }
+
   /// Return a waypoint for each drivable lane on @a lane_section.
   template <typename FuncT>
   static void ForEachDrivableLaneImpl(
@@ -166,6 +190,49 @@ namespace road {
     return section.ContainsLane(waypoint.lane_id);
   }
 
+  /// Indices of @a locations sorted along a Z-order (Morton) curve of their
+  /// XY position, so that consecutive queries are close to each other.
+  static std::vector<size_t> GetMortonOrder(const std::vector<geom::Location> &locations) {
+    std::vector<size_t> order(locations.size());
+    for (size_t i = 0u; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    if (locations.size() < 2u) {
+      return order;
+    }
+    float min_x = locations.front().x, max_x = min_x;
+    float min_y = locations.front().y, max_y = min_y;
+    for (const auto &location : locations) {
+      min_x = std::min(min_x, location.x);
+      max_x = std::max(max_x, location.x);
+      min_y = std::min(min_y, location.y);
+      max_y = std::max(max_y, location.y);
+    }
+    // Spreads the 16 bits of a cell coordinate to the even bits
+    const auto spread = [](uint32_t v) {
+      v = (v | (v << 8u)) & 0x00FF00FFu;
+      v = (v | (v << 4u)) & 0x0F0F0F0Fu;
+      v = (v | (v << 2u)) & 0x33333333u;
+      v = (v | (v << 1u)) & 0x55555555u;
+      return v;
+    };
+    const auto cell = [](float value, float min, float max) {
+      const float size = max - min;
+      return size > 0.0f ?
+          static_cast<uint32_t>((value - min) / size * 65535.0f) : 0u;
+    };
+    std::vector<uint32_t> keys(locations.size());
+    for (size_t i = 0u; i < locations.size(); ++i) {
+      keys[i] =
+          spread(cell(locations[i].x, min_x, max_x)) |
+          (spread(cell(locations[i].y, min_y, max_y)) << 1u);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+      return keys[lhs] < keys[rhs];
+    });
+    return order;
+  }
+
   // ===========================================================================
   // -- Map: Geometry ----------------------------------------------------------
   // ===========================================================================
@@ -227,9 +294,8 @@ namespace road {
     }
 
     const auto dist = geom::Math::Distance2D(ComputeTransform(*w).location, pos);
-    const auto lane_width_info = GetLane(*w).GetInfo<RoadInfoLaneWidth>(w->s);
-    const auto half_lane_width =
-        lane_width_info->GetPolynomial().Evaluate(w->s) * 0.5;
+    const auto lane_width = _data.GetFlatData().GetLaneWidthRecord(GetLaneIndex(*w), w->s);
+    const auto half_lane_width = lane_width->polynomial.Evaluate(w->s) * 0.5;
 
     if (dist < half_lane_width) {
       return w;
@@ -238,6 +304,47 @@ namespace road {
     return boost::optional<Waypoint>{};
   }
 
+  std::vector<boost::optional<Map::ClosestWaypoint>> Map::GetClosestWaypointsOnRoad(
+      const std::vector<geom::Location> &locations,
+      int32_t lane_type,
+      size_t worker_count) const {
+    std::vector<boost::optional<ClosestWaypoint>> result(locations.size());
+    const std::vector<size_t> order = GetMortonOrder(locations);
+
+    // Runs of consecutive queries along the curve, so each worker walks the
+    // same branches of the tree query after query
+    constexpr size_t run_size = 64u;
+    const size_t run_count = (order.size() + run_size - 1u) / run_size;
+    auto run_queries = [&](size_t run, size_t) {
+      const size_t end = std::min(order.size(), (run + 1u) * run_size);
+      for (size_t i = run * run_size; i < end; ++i) {
+        const size_t index = order[i];
+        const geom::Location &location = locations[index];
+        boost::optional<Waypoint> w = GetClosestWaypointOnRoad(location, lane_type);
+        if (!w.has_value()) {
+          continue;
+        }
+        ClosestWaypoint closest;
+        closest.waypoint = *w;
+        closest.transform = ComputeTransform(*w);
+        closest.lane_width = GetLaneWidth(*w);
+        closest.distance = geom::Math::Distance2D(closest.transform.location, location);
+        result[index] = closest;
+      }
+    };
+    if (worker_count == 0u) {
+      _pool->ParallelFor(run_count, run_queries);
+    } else if (worker_count == 1u) {
+      for (size_t run = 0u; run < run_count; ++run) {
+        run_queries(run, 0u);
+      }
+    } else {
+      WorkStealingPool pool(worker_count);
+      pool.ParallelFor(run_count, run_queries);
+    }
+    return result;
+  }
+
   boost::optional<Waypoint> Map::GetWaypoint(
       RoadId road_id,
       LaneId lane_id,
@@ -287,20 +394,20 @@ namespace road {
   // ===========================================================================
 
   Lane::LaneType Map::GetLaneType(const Waypoint waypoint) const {
-    return GetLane(waypoint).GetType();
+    return _data.GetFlatData().GetLane(GetLaneIndex(waypoint)).type;
   }
 
   double Map::GetLaneWidth(const Waypoint waypoint) const {
     const auto s = waypoint.s;
 
-    const auto &lane = GetLane(waypoint);
-    RELEASE_ASSERT(lane.GetRoad() != nullptr);
-    RELEASE_ASSERT(s <= lane.GetRoad()->GetLength());
+    const FlatMapData &flat = _data.GetFlatData();
+    const auto lane = GetLaneIndex(waypoint);
+    RELEASE_ASSERT(s <= flat.GetRoad(flat.GetSection(flat.GetLane(lane).section).road).length);
 
-    const auto lane_width_info = lane.GetInfo<RoadInfoLaneWidth>(s);
-    RELEASE_ASSERT(lane_width_info != nullptr);
+    const auto lane_width = flat.GetLaneWidthRecord(lane, s);
+    RELEASE_ASSERT(lane_width != nullptr);
 
-    return lane_width_info->GetPolynomial().Evaluate(s);
+    return lane_width->polynomial.Evaluate(s);
   }
 
   JuncId Map::GetJunctionId(RoadId road_id) const {
@@ -338,11 +445,12 @@ namespace road {
   std::vector<Map::SignalSearchData> Map::GetSignalsInDistance(
       Waypoint waypoint, double distance, bool stop_at_junction) const {
 
-    const auto &lane = GetLane(waypoint);
+    const FlatMapData &flat = _data.GetFlatData();
+    const auto &section = flat.GetSection(flat.GetLane(GetLaneIndex(waypoint)).section);
     const bool forward = (waypoint.lane_id <= 0);
     const double signed_distance = forward ? distance : -distance;
-    const double relative_s = waypoint.s - lane.GetDistance();
-    const double remaining_lane_length = forward ? lane.GetLength() - relative_s : relative_s;
+    const double relative_s = waypoint.s - section.s;
+    const double remaining_lane_length = forward ? section.length - relative_s : relative_s;
     DEBUG_ASSERT(remaining_lane_length >= 0.0);
 
     auto &road =_data.GetRoad(waypoint.road_id);
@@ -524,39 +632,13 @@ namespace road {
   // ===========================================================================
 
   std::vector<Waypoint> Map::GetSuccessors(const Waypoint waypoint) const {
-    const auto &next_lanes = GetLane(waypoint).GetNextLanes();
-    std::vector<Waypoint> result;
-    result.reserve(next_lanes.size());
-    for (auto *next_lane : next_lanes) {
-      RELEASE_ASSERT(next_lane != nullptr);
-      const auto lane_id = next_lane->GetId();
-      RELEASE_ASSERT(lane_id != 0);
-      const auto *section = next_lane->GetLaneSection();
-      RELEASE_ASSERT(section != nullptr);
-      const auto *road = next_lane->GetRoad();
-      RELEASE_ASSERT(road != nullptr);
-      const auto distance = GetDistanceAtStartOfLane(*next_lane);
-      result.emplace_back(Waypoint{road->GetId(), section->GetId(), lane_id, distance});
-    }
-    return result;
+    const FlatMapData &flat = _data.GetFlatData();
+    return MakeLaneWaypoints(flat, flat.GetNextLanes(GetLaneIndex(waypoint)), false);
   }
 
   std::vector<Waypoint> Map::GetPredecessors(const Waypoint waypoint) const {
-    const auto &prev_lanes = GetLane(waypoint).GetPreviousLanes();
-    std::vector<Waypoint> result;
-    result.reserve(prev_lanes.size());
-    for (auto *next_lane : prev_lanes) {
-      RELEASE_ASSERT(next_lane != nullptr);
-      const auto lane_id = next_lane->GetId();
-      RELEASE_ASSERT(lane_id != 0);
-      const auto *section = next_lane->GetLaneSection();
-      RELEASE_ASSERT(section != nullptr);
-      const auto *road = next_lane->GetRoad();
-      RELEASE_ASSERT(road != nullptr);
-      const auto distance = GetDistanceAtEndOfLane(*next_lane);
-      result.emplace_back(Waypoint{road->GetId(), section->GetId(), lane_id, distance});
-    }
-    return result;
+    const FlatMapData &flat = _data.GetFlatData();
+    return MakeLaneWaypoints(flat, flat.GetPreviousLanes(GetLaneIndex(waypoint)), true);
   }
 
   std::vector<Waypoint> Map::GetNext(
@@ -566,11 +648,12 @@ namespace road {
     if (distance <= EPSILON) {
       return {waypoint};
     }
-    const auto &lane = GetLane(waypoint);
+    const FlatMapData &flat = _data.GetFlatData();
+    const auto &section = flat.GetSection(flat.GetLane(GetLaneIndex(waypoint)).section);
     const bool forward = (waypoint.lane_id <= 0);
     const double signed_distance = forward ? distance : -distance;
-    const double relative_s = waypoint.s - lane.GetDistance();
-    const double remaining_lane_length = forward ? lane.GetLength() - relative_s : relative_s;
+    const double relative_s = waypoint.s - section.s;
+    const double remaining_lane_length = forward ? section.length - relative_s : relative_s;
     DEBUG_ASSERT(remaining_lane_length >= 0.0);
 
     // If after subtracting the distance we are still in the same lane, return
@@ -615,11 +698,12 @@ namespace road {
     if (distance <= EPSILON) {
       return {waypoint};
     }
-    const auto &lane = GetLane(waypoint);
+    const FlatMapData &flat = _data.GetFlatData();
+    const auto &section = flat.GetSection(flat.GetLane(GetLaneIndex(waypoint)).section);
     const bool forward = !(waypoint.lane_id <= 0);
     const double signed_distance = forward ? distance : -distance;
-    const double relative_s = waypoint.s - lane.GetDistance();
-    const double remaining_lane_length = forward ? lane.GetLength() - relative_s : relative_s;
+    const double relative_s = waypoint.s - section.s;
+    const double remaining_lane_length = forward ? section.length - relative_s : relative_s;
     DEBUG_ASSERT(remaining_lane_length >= 0.0);
 
     // If after subtracting the distance we are still in the same lane, return
@@ -796,9 +880,21 @@ namespace road {
 
   std::unordered_map<road::RoadId, std::unordered_set<road::RoadId>>
       Map::ComputeJunctionConflicts(JuncId id) const {
+    size_t segment_count = 0u;
+    size_t pair_count = 0u;
+    return ComputeJunctionConflicts(id, segment_count, pair_count);
+  }
+
+  std::unordered_map<road::RoadId, std::unordered_set<road::RoadId>>
+      Map::ComputeJunctionConflicts(
+          JuncId id,
+          size_t &segment_count,
+          size_t &pair_count) const {
 
     const float epsilon = 0.0001f; // small delta in the road (set to 0.1
                                      // millimeters to prevent numeric errors)
+    // better to set distance to lanewidth
+    const double max_distance = 2.0;
     const Junction *junction = GetJunction(id);
     std::unordered_map<road::RoadId, std::unordered_set<road::RoadId>>
         conflicts;
@@ -824,49 +920,78 @@ namespace road {
         {max_corner.x, max_corner.y, max_corner.z});
     auto segments = _rtree.GetIntersections(box);
 
-    for (size_t i = 0; i < segments.size(); ++i){
-      auto &segment1 = segments[i];
-      auto waypoint1 = segment1.second.first;
-      JuncId junc_id1 = _data.GetRoad(waypoint1.road_id).GetJunctionId();
-      // only segments in the junction
-      if(junc_id1 != id){
+    // only segments in the junction, with their 2d bounding box
+    struct JunctionSegment {
+      Segment2d segment;
+      RoadId road_id;
+      float min_x, max_x, min_y, max_y;
+    };
+    std::vector<JunctionSegment> junction_segments;
+    junction_segments.reserve(segments.size());
+    for (auto &segment : segments) {
+      const auto &waypoint = segment.second.first;
+      if (_data.GetRoad(waypoint.road_id).GetJunctionId() != id) {
         continue;
       }
-      Segment2d seg1{{segment1.first.first.get<0>(), segment1.first.first.get<1>()},
-          {segment1.first.second.get<0>(), segment1.first.second.get<1>()}};
-      for (size_t j = i + 1; j < segments.size(); ++j){
-        auto &segment2 = segments[j];
-        auto waypoint2 = segment2.second.first;
-        JuncId junc_id2 = _data.GetRoad(waypoint2.road_id).GetJunctionId();
-        // only segments in the junction
-        if(junc_id2 != id){
-          continue;
-        }
+      const float x1 = segment.first.first.get<0>();
+      const float y1 = segment.first.first.get<1>();
+      const float x2 = segment.first.second.get<0>();
+      const float y2 = segment.first.second.get<1>();
+      junction_segments.push_back({
+          Segment2d{{x1, y1}, {x2, y2}},
+          waypoint.road_id,
+          std::min(x1, x2), std::max(x1, x2),
+          std::min(y1, y2), std::max(y1, y2)});
+    }
+    segment_count = junction_segments.size();
+    pair_count = 0u;
+
+    // Sweep along x: only the segments whose boxes are closer than
+    // max_distance (plus epsilon for the rounding of the box bounds) can be
+    // closer than that, so the distance is computed for those pairs only
+    std::sort(junction_segments.begin(), junction_segments.end(),
+        [](const JunctionSegment &lhs, const JunctionSegment &rhs) {
+          return lhs.min_x < rhs.min_x;
+        });
+    const float box_distance = static_cast<float>(max_distance) + epsilon;
+    for (size_t i = 0; i < junction_segments.size(); ++i) {
+      const auto &segment1 = junction_segments[i];
+      for (size_t j = i + 1;
+          j < junction_segments.size() &&
+          junction_segments[j].min_x <= segment1.max_x + box_distance;
+          ++j) {
+        const auto &segment2 = junction_segments[j];
         // discard same road
-        if(waypoint1.road_id == waypoint2.road_id){
+        if (segment1.road_id == segment2.road_id) {
           continue;
         }
-        Segment2d seg2{{segment2.first.first.get<0>(), segment2.first.first.get<1>()},
-            {segment2.first.second.get<0>(), segment2.first.second.get<1>()}};
-
-        double distance = boost::geometry::distance(seg1, seg2);
-        // better to set distance to lanewidth
-        if(distance > 2.0){
+        if (segment2.min_y > segment1.max_y + box_distance ||
+            segment1.min_y > segment2.max_y + box_distance) {
           continue;
         }
-        if(conflicts[waypoint1.road_id].count(waypoint2.road_id) == 0){
-          conflicts[waypoint1.road_id].insert(waypoint2.road_id);
-        }
-        if(conflicts[waypoint2.road_id].count(waypoint1.road_id) == 0){
-          conflicts[waypoint2.road_id].insert(waypoint1.road_id);
+        ++pair_count;
+        double distance = boost::geometry::distance(segment1.segment, segment2.segment);
+        if (distance > max_distance) {
+          continue;
         }
+        conflicts[segment1.road_id].insert(segment2.road_id);
+        conflicts[segment2.road_id].insert(segment1.road_id);
       }
     }
     return conflicts;
   }
 
   const Lane &Map::GetLane(Waypoint waypoint) const {
-    return _data.GetRoad(waypoint.road_id).GetLaneById(waypoint.section_id, waypoint.lane_id);
+    return _data.GetFlatData().GetLaneElement(GetLaneIndex(waypoint));
+  }
+
+  FlatMapData::Index Map::GetLaneIndex(Waypoint waypoint) const {
+    const auto lane = _data.GetFlatData().FindLane(
+        waypoint.road_id, waypoint.section_id, waypoint.lane_id);
+    if (lane == FlatMapData::InvalidIndex) {
+      throw_exception(std::out_of_range("waypoint out of the map"));
+    }
+    return lane;
   }
 
   // ===========================================================================
@@ -939,11 +1064,12 @@ namespace road {
       });
     }
 
-    // Container of segments and waypoints
-    std::vector<Rtree::TreeElement> rtree_elements;
-    // Loop through all lanes
-    for (auto &waypoint : topology) {
-      auto &lane_start_waypoint = waypoint;
+    // Segments of each lane, generated in parallel and concatenated in the
+    // order of the topology
+    std::vector<std::vector<Rtree::TreeElement>> lane_elements(topology.size());
+    _pool->ParallelFor(topology.size(), [&](size_t item, size_t) {
+      std::vector<Rtree::TreeElement> &rtree_elements = lane_elements[item];
+      auto &lane_start_waypoint = topology[item];
 
       auto current_waypoint = lane_start_waypoint;
 
@@ -959,7 +1085,7 @@ namespace road {
         remaining_length -= epsilon;
         delta_s = remaining_length;
         if (delta_s < epsilon) {
-          continue;
+          return;
         }
         auto next = GetNext(current_waypoint, delta_s);
 
@@ -1023,9 +1149,19 @@ namespace road {
           }
         }
       }
+    });
+
+    size_t element_count = 0u;
+    for (const auto &elements : lane_elements) {
+      element_count += elements.size();
+    }
+    std::vector<Rtree::TreeElement> rtree_elements;
+    rtree_elements.reserve(element_count);
+    for (auto &elements : lane_elements) {
+      rtree_elements.insert(rtree_elements.end(), elements.begin(), elements.end());
     }
-    // Add segments to Rtree
-    _rtree.InsertElements(rtree_elements);
+    // Build the Rtree with the packing algorithm
+    _rtree.BulkLoad(rtree_elements);
   }
 
   Junction* Map::GetJunction(JuncId id) {
@@ -1053,7 +1189,7 @@ namespace road {
       if (road.IsJunction()) {
         continue;
       }
-      out_mesh += *mesh_factory.Generate(road);
+      out_mesh += std::move(*mesh_factory.Generate(road));
     }
 
     // Generate roads within junctions and smooth them
@@ -1070,13 +1206,12 @@ namespace road {
         }
       }
       if(smooth_junctions) {
-        out_mesh += *mesh_factory.MergeAndSmooth(lane_meshes);
+        out_mesh += std::move(*mesh_factory.MergeAndSmooth(lane_meshes));
       } else {
-        geom::Mesh junction_mesh;
+        out_mesh.ReserveToMerge(lane_meshes);
         for(auto& lane : lane_meshes) {
-          junction_mesh += *lane;
+          out_mesh += *lane;
         }
-        out_mesh += junction_mesh;
       }
     }
 
@@ -1124,12 +1259,15 @@ namespace road {
       }
       if(params.smooth_junctions) {
         auto merged_mesh = mesh_factory.MergeAndSmooth(lane_meshes);
+        merged_mesh->ReserveToMerge(sidewalk_lane_meshes);
         for(auto& lane : sidewalk_lane_meshes) {
           *merged_mesh += *lane;
         }
         out_mesh_list.push_back(std::move(merged_mesh));
       } else {
         std::unique_ptr<geom::Mesh> junction_mesh = std::make_unique<geom::Mesh>();
+        junction_mesh->ReserveToMerge(lane_meshes);
+        junction_mesh->ReserveToMerge(sidewalk_lane_meshes);
         for(auto& lane : lane_meshes) {
           *junction_mesh += *lane;
         }
@@ -1162,12 +1300,28 @@ namespace road {
       auto vertex = mesh->GetVertices().front();
       size_t x_pos = static_cast<size_t>((vertex.x - min_pos.x) / params.max_road_length);
       size_t y_pos = static_cast<size_t>((vertex.y - min_pos.y) / params.max_road_length);
-      *(result[x_pos + mesh_amount_x*y_pos]) += *mesh;
+      *(result[x_pos + mesh_amount_x*y_pos]) += std::move(*mesh);
     }
 
     return result;
   }
 
+  /// Moves all the meshes of @a from to the end of the lists of @a to
+  static void MergeMeshLists(
+      std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> &to,
+      std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> &&from) {
+    for (auto&& pair : from) {
+      auto &meshes = to[pair.first];
+      if (meshes.empty()) {
+        meshes = std::move(pair.second);
+      } else {
+        meshes.insert(meshes.end(),
+          std::make_move_iterator(pair.second.begin()),
+          std::make_move_iterator(pair.second.end()));
+      }
+    }
+  }
+
   std::map<road::Lane::LaneType , std::vector<std::unique_ptr<geom::Mesh>>>
     Map::GenerateOrderedChunkedMeshInLocations( const rpc::OpendriveGenerationParameters& params,
                                      const geom::Vector3D& minpos,
@@ -1175,65 +1329,32 @@ namespace road {
   {
 
     geom::MeshFactory mesh_factory(params);
-    std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> road_out_mesh_list;
-    std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> junction_out_mesh_list;
-
-    std::thread juntction_thread( &Map::GenerateJunctions, this, mesh_factory, params,
-      minpos, maxpos, &junction_out_mesh_list);
 
+    const std::vector<JuncId> JunctionsToGenerate = FilterJunctionsByPosition(minpos, maxpos);
     const std::vector<RoadId> RoadsIDToGenerate = FilterRoadsByPosition(minpos, maxpos);
 
-    size_t num_roads = RoadsIDToGenerate.size();
-    size_t num_roads_per_thread = 30;
-    size_t num_threads = (num_roads / num_roads_per_thread) + 1;
-    num_threads = num_threads > 1 ? num_threads : 1;
-    std::vector<std::thread> workers;
-    std::mutex write_mutex;
-    std::cout << "Generating " << std::to_string(num_roads) << " roads" << std::endl;
-
-    for ( size_t i = 0; i < num_threads; ++i ) {
-      std::thread neworker(
-        [this, &write_mutex, &mesh_factory, &RoadsIDToGenerate, &road_out_mesh_list, i, num_roads_per_thread]() {
-        std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> Current =
-          GenerateRoadsMultithreaded(mesh_factory, RoadsIDToGenerate,i, num_roads_per_thread );
-        std::lock_guard<std::mutex> guard(write_mutex);
-        for ( auto&& pair : Current ) {
-          if (road_out_mesh_list.find(pair.first) != road_out_mesh_list.end()) {
-            road_out_mesh_list[pair.first].insert(road_out_mesh_list[pair.first].end(),
-              std::make_move_iterator(pair.second.begin()),
-              std::make_move_iterator(pair.second.end()));
-          } else {
-            road_out_mesh_list[pair.first] = std::move(pair.second);
-          }
+    const size_t num_junctions = JunctionsToGenerate.size();
+    const size_t num_roads = RoadsIDToGenerate.size();
+    // Junctions go first so the most expensive items are not left for the
+    // tail of the loop. Each worker writes only to its own list.
+    std::vector<std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>>>
+      worker_out_mesh_lists(_pool->GetWorkerCount());
+    _pool->ParallelFor(num_junctions + num_roads, [&](size_t item, size_t worker) {
+      auto &out_mesh_list = worker_out_mesh_lists[worker];
+      if (item < num_junctions) {
+        GenerateSingleJunction(mesh_factory, JunctionsToGenerate[item], &out_mesh_list);
+      } else {
+        const auto& road = _data.GetRoads().at(RoadsIDToGenerate[item - num_junctions]);
+        if (!road.IsJunction()) {
+          mesh_factory.GenerateAllOrderedWithMaxLen(road, out_mesh_list);
         }
-      });
-      workers.push_back(std::move(neworker));
-    }
-
-    for (size_t i = 0; i < workers.size(); ++i) {
-      workers[i].join();
-    }
-    workers.clear();
-    for (size_t i = 0; i < workers.size(); ++i) {
-      if (workers[i].joinable()) {
-        workers[i].join();
       }
-    }
+    });
 
-    juntction_thread.join();
-    for (auto&& pair : junction_out_mesh_list) {
-      if (road_out_mesh_list.find(pair.first) != road_out_mesh_list.end())
-      {
-        road_out_mesh_list[pair.first].insert(road_out_mesh_list[pair.first].end(),
-          std::make_move_iterator(pair.second.begin()),
-          std::make_move_iterator(pair.second.end()));
-      }
-      else
-      {
-        road_out_mesh_list[pair.first] = std::move(pair.second);
-      }
+    std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> road_out_mesh_list;
+    for (auto &worker_out_mesh_list : worker_out_mesh_lists) {
+      MergeMeshLists(road_out_mesh_list, std::move(worker_out_mesh_list));
     }
-    std::cout << "Generated " << std::to_string(num_roads) << " roads" << std::endl;
 
     return road_out_mesh_list;
   }
@@ -1345,6 +1466,32 @@ namespace road {
     return LineMarks;
   }
 
+  std::vector<LaneMarkBatch> Map::GenerateLaneMarkBatches(
+    const rpc::OpendriveGenerationParameters& params,
+    const geom::Vector3D& minpos,
+    const geom::Vector3D& maxpos ) const
+  {
+    std::vector<LaneMarkPiece> pieces;
+    geom::MeshFactory mesh_factory(params);
+
+    // Every road reaching the tile, MergeLaneMarkPieces keeps the pieces
+    // whose center is inside it. The margin brings the pieces that can make
+    // one of them a duplicate
+    constexpr float duplicate_distance = 2.5f;
+    const geom::Vector3D margin(duplicate_distance, duplicate_distance, 0.0f);
+    const std::vector<RoadId> RoadsIDToGenerate = FilterRoadsOverlapping(
+        geom::Vector3D(std::min(minpos.x, maxpos.x), std::min(minpos.y, maxpos.y), 0.0f) - margin,
+        geom::Vector3D(std::max(minpos.x, maxpos.x), std::max(minpos.y, maxpos.y), 0.0f) + margin);
+    for ( RoadId id : RoadsIDToGenerate ) {
+      const auto& road = _data.GetRoads().at(id);
+      if (!road.IsJunction()) {
+        mesh_factory.GenerateLaneMarkPiecesForRoad(road, pieces);
+      }
+    }
+
+    return MergeLaneMarkPieces(pieces, minpos, maxpos, duplicate_distance);
+  }
+
   std::vector<carla::geom::BoundingBox> Map::GetJunctionsBoundingBoxes() const {
     std::vector<carla::geom::BoundingBox> returning;
     for ( const auto& junc_pair : _data.GetJunctions() ) {
@@ -1362,125 +1509,88 @@ namespace road {
       geom::deformation::GetBumpDeformation(posx,posy);
   }
 
-  std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>>
-      Map::GenerateRoadsMultithreaded( const carla::geom::MeshFactory& mesh_factory,
-                                        const std::vector<RoadId>& RoadsId,
-                                        const size_t index, const size_t number_of_roads_per_thread) const
-  {
-    std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>> out;
-
-    size_t start = index * number_of_roads_per_thread;
-    size_t endoffset = (index+1) * number_of_roads_per_thread;
-    size_t end = RoadsId.size();
-
-    for (int i = start; i < endoffset && i < end; ++i) {
-      const auto& road = _data.GetRoads().at(RoadsId[i]);
-      if (!road.IsJunction()) {
-        mesh_factory.GenerateAllOrderedWithMaxLen(road, out);
-      }
-    }
-    std::cout << "Generated roads from " + std::to_string(index * number_of_roads_per_thread) + " to " + std::to_string((index+1) * number_of_roads_per_thread ) << std::endl;
-    return out;
+  /// Box in the XY plane between two corners, whatever corners they are.
+  template <typename Index>
+  static typename Index::BBox MakeIndexBox(
+      const geom::Vector3D& minpos,
+      const geom::Vector3D& maxpos) {
+    using BPoint = typename Index::BPoint;
+    return typename Index::BBox(
+        BPoint(std::min(minpos.x, maxpos.x), std::min(minpos.y, maxpos.y)),
+        BPoint(std::max(minpos.x, maxpos.x), std::max(minpos.y, maxpos.y)));
   }
 
-  void Map::GenerateJunctions(const carla::geom::MeshFactory& mesh_factory,
-    const rpc::OpendriveGenerationParameters& params,
-    const geom::Vector3D& minpos,
-    const geom::Vector3D& maxpos,
-    std::map<road::Lane::LaneType,
-    std::vector<std::unique_ptr<geom::Mesh>>>* junction_out_mesh_list) const {
-
-    std::vector<JuncId> JunctionsToGenerate = FilterJunctionsByPosition(minpos, maxpos);
-    size_t num_junctions = JunctionsToGenerate.size();
-    std::cout << "Generating " << std::to_string(num_junctions) << " junctions" << std::endl;
-    size_t junctionindex = 0;
-    size_t num_junctions_per_thread = 5;
-    size_t num_threads = (num_junctions / num_junctions_per_thread) + 1;
-    num_threads = num_threads > 1 ? num_threads : 1;
-    std::vector<std::thread> workers;
-    std::mutex write_mutex;
-
-    for ( size_t i = 0; i < num_threads; ++i ) {
-      std::thread neworker(
-        [this, &write_mutex, &mesh_factory, &junction_out_mesh_list, JunctionsToGenerate, i, num_junctions_per_thread, num_junctions]() {
-        std::map<road::Lane::LaneType,
-          std::vector<std::unique_ptr<geom::Mesh>>> junctionsofthisthread;
-
-        size_t minimum = 0;
-        if( (i + 1) * num_junctions_per_thread < num_junctions ){
-          minimum = (i + 1) * num_junctions_per_thread;
-        }else{
-          minimum = num_junctions;
-        }
-        std::cout << "Generating Junctions between  " << std::to_string(i * num_junctions_per_thread) << " and " << std::to_string(minimum) << std::endl;
-
-        for ( size_t junctionindex = i * num_junctions_per_thread;
-                        junctionindex < minimum;
-                        ++junctionindex )
-        {
-          GenerateSingleJunction(mesh_factory, JunctionsToGenerate[junctionindex], &junctionsofthisthread);
-        }
-        std::cout << "Generated Junctions between  " << std::to_string(i * num_junctions_per_thread) << " and " << std::to_string(minimum) << std::endl;
-        std::lock_guard<std::mutex> guard(write_mutex);
-        for ( auto&& pair : junctionsofthisthread ) {
-          if ((*junction_out_mesh_list).find(pair.first) != (*junction_out_mesh_list).end()) {
-            (*junction_out_mesh_list)[pair.first].insert((*junction_out_mesh_list)[pair.first].end(),
-              std::make_move_iterator(pair.second.begin()),
-              std::make_move_iterator(pair.second.end()));
-          } else {
-            (*junction_out_mesh_list)[pair.first] = std::move(pair.second);
-          }
-        }
-      });
-      workers.push_back(std::move(neworker));
-    }
+  /// Whether @a location is inside the box between two corners, whatever
+  /// corners they are. The box is half-open, so a location on the border of
+  /// two adjacent tiles belongs to only one of them.
+  static bool IsInTile(
+      const geom::Location& location,
+      const geom::Vector3D& minpos,
+      const geom::Vector3D& maxpos) {
+    return std::min(minpos.x, maxpos.x) <= location.x &&
+        location.x < std::max(minpos.x, maxpos.x) &&
+        std::min(minpos.y, maxpos.y) <= location.y &&
+        location.y < std::max(minpos.y, maxpos.y);
+  }
 
-    for (size_t i = 0; i < workers.size(); ++i) {
-      workers[i].join();
+  /// Location deciding the tile a road belongs to: the center of its first
+  /// right lane, or of its first left lane if it has none, halfway along its
+  /// first lane section.
+  static boost::optional<geom::Location> GetRoadAnchor(const Road& road) {
+    const auto& lane_section = *road.GetLaneSections().begin();
+    const Lane* lane = lane_section.GetLane(-1);
+    if (lane == nullptr) {
+      lane = lane_section.GetLane(1);
     }
-    workers.clear();
-    for (size_t i = 0; i < workers.size(); ++i) {
-      if (workers[i].joinable()) {
-        workers[i].join();
-      }
+    if (lane == nullptr) {
+      return boost::none;
     }
+    const double s_check = lane_section.GetDistance() + lane_section.GetLength() * 0.5;
+    return lane->ComputeTransform(s_check).location;
   }
 
   std::vector<JuncId> Map::FilterJunctionsByPosition( const geom::Vector3D& minpos,
     const geom::Vector3D& maxpos ) const {
 
-    std::cout << "Filtered from " + std::to_string(_data.GetJunctions().size() ) + " junctions " << std::endl;
+    // The index gives the candidates, the center of the bounding box decides
+    // the tile that owns each junction
+    const auto elements = _junction_index.GetIntersections(
+        MakeIndexBox<JunctionIndex>(minpos, maxpos));
     std::vector<JuncId> ToReturn;
-    for( auto& junction : _data.GetJunctions() ){
-      geom::Location junctionLocation = junction.second.GetBoundingBox().location;
-      if( minpos.x < junctionLocation.x && junctionLocation.x < maxpos.x &&
-            minpos.y > junctionLocation.y && junctionLocation.y > maxpos.y ) {
-        ToReturn.push_back(junction.first);
+    ToReturn.reserve(elements.size());
+    for (const auto& element : elements) {
+      const auto& junction = _data.GetJunctions().at(element.second);
+      if (IsInTile(junction.GetBoundingBox().location, minpos, maxpos)) {
+        ToReturn.push_back(element.second);
       }
     }
-    std::cout << "To " + std::to_string(ToReturn.size() ) + " junctions " << std::endl;
-
+    // The order of the tree depends on how it was packed
+    std::sort(ToReturn.begin(), ToReturn.end());
     return ToReturn;
   }
 
   std::vector<RoadId> Map::FilterRoadsByPosition( const geom::Vector3D& minpos,
     const geom::Vector3D& maxpos ) const {
 
+    std::vector<RoadId> ToReturn = FilterRoadsOverlapping(minpos, maxpos);
+    ToReturn.erase(std::remove_if(ToReturn.begin(), ToReturn.end(), [&](RoadId id) {
+      const auto anchor = GetRoadAnchor(_data.GetRoads().at(id));
+      return !anchor || !IsInTile(*anchor, minpos, maxpos);
+    }), ToReturn.end());
+    return ToReturn;
+  }
+
+  std::vector<RoadId> Map::FilterRoadsOverlapping( const geom::Vector3D& minpos,
+    const geom::Vector3D& maxpos ) const {
+
+    const auto elements = _road_index.GetIntersections(
+        MakeIndexBox<RoadIndex>(minpos, maxpos));
     std::vector<RoadId> ToReturn;
-    std::cout << "Filtered from " + std::to_string(_data.GetRoads().size() ) + " roads " << std::endl;
-    for( auto& road : _data.GetRoads() ){
-      auto &&lane_section = (*road.second.GetLaneSections().begin());
-      const road::Lane* lane = lane_section.GetLane(-1);
-      if( lane ) {
-        const double s_check = lane_section.GetDistance() + lane_section.GetLength() * 0.5;
-        geom::Location roadLocation = lane->ComputeTransform(s_check).location;
-        if( minpos.x < roadLocation.x && roadLocation.x < maxpos.x &&
-              minpos.y > roadLocation.y && roadLocation.y > maxpos.y ) {
-          ToReturn.push_back(road.first);
-        }
-      }
+    ToReturn.reserve(elements.size());
+    for (const auto& element : elements) {
+      ToReturn.push_back(element.second);
     }
-    std::cout << "To " + std::to_string(ToReturn.size() ) + " roads " << std::endl;
+    std::sort(ToReturn.begin(), ToReturn.end());
     return ToReturn;
   }
 
@@ -1488,36 +1598,50 @@ namespace road {
     const std::vector<geom::Vector3D>& sdfinput,
     int grid_cells_per_dim) const {
 
-    int junctionid = jinput.GetId();
     float box_extraextension_factor = 1.2f;
     const double CubeSize = 0.5;
     carla::geom::BoundingBox bb = jinput.GetBoundingBox();
     carla::geom::Vector3D MinOffset = bb.location - geom::Location(bb.extent * box_extraextension_factor);
     carla::geom::Vector3D MaxOffset = bb.location + geom::Location(bb.extent * box_extraextension_factor);
-    carla::geom::Vector3D OffsetPerCell = ( bb.extent * box_extraextension_factor * 2 ) / grid_cells_per_dim;
 
-    auto junctionsdf = [this, OffsetPerCell, CubeSize, MinOffset, junctionid](MeshReconstruction::Vec3 const& pos)
+    // Same as GetWaypoint and GetClosestWaypointOnRoad for each position,
+    // with a single query per position
+    auto junctionsdf = [this, CubeSize](std::vector<MeshReconstruction::Vec3> const& positions,
+        std::vector<double>& values)
     {
-      geom::Vector3D worldloc(pos.x, pos.y, pos.z);
-      boost::optional<element::Waypoint> CheckingWaypoint = GetWaypoint(geom::Location(worldloc), 0x1 << 1);
-      if (CheckingWaypoint) {
-        if ( pos.z < 0.2) {
-          return 0.0;
-        } else {
-          return -abs(pos.z);
-        }
+      std::vector<geom::Location> locations;
+      locations.reserve(positions.size());
+      for (const auto& pos : positions) {
+        geom::Vector3D worldloc(pos.x, pos.y, pos.z);
+        locations.emplace_back(worldloc);
       }
-      boost::optional<element::Waypoint> InRoadWaypoint = GetClosestWaypointOnRoad(geom::Location(worldloc), 0x1 << 1);
-      geom::Transform InRoadWPTransform = ComputeTransform(*InRoadWaypoint);
+      // Called from a job of the chunked mesh generation
+      const auto closest_waypoints = GetClosestWaypointsOnRoad(locations, 0x1 << 1, 1u);
+      values.resize(positions.size());
+      for (size_t i = 0; i < positions.size(); ++i) {
+        const auto& pos = positions[i];
+        geom::Vector3D worldloc(pos.x, pos.y, pos.z);
+        const ClosestWaypoint& InRoadWaypoint = *closest_waypoints[i];
+        if (InRoadWaypoint.distance < InRoadWaypoint.lane_width * 0.5) {
+          if ( pos.z < 0.2) {
+            values[i] = 0.0;
+          } else {
+            values[i] = -abs(pos.z);
+          }
+          continue;
+        }
+        const geom::Transform& InRoadWPTransform = InRoadWaypoint.transform;
 
-      geom::Vector3D director = geom::Location(worldloc) - (InRoadWPTransform.location);
-      geom::Vector3D laneborder = InRoadWPTransform.location + geom::Location(director.MakeUnitVector() * GetLaneWidth(*InRoadWaypoint) * 0.5f);
+        geom::Vector3D director = geom::Location(worldloc) - (InRoadWPTransform.location);
+        geom::Vector3D laneborder = InRoadWPTransform.location + geom::Location(director.MakeUnitVector() * InRoadWaypoint.lane_width * 0.5f);
 
-      geom::Vector3D Distance = laneborder - worldloc;
-      if (Distance.Length2D() < CubeSize * 1.1 && pos.z < 0.2) {
-        return 0.0;
+        geom::Vector3D Distance = laneborder - worldloc;
+        if (Distance.Length2D() < CubeSize * 1.1 && pos.z < 0.2) {
+          values[i] = 0.0;
+          continue;
+        }
+        values[i] = Distance.Length() * -1.0;
       }
-      return Distance.Length() * -1.0;
     };
 
     double gridsizeindouble = grid_cells_per_dim;
@@ -1526,10 +1650,11 @@ namespace road {
     domain.size = { bb.extent.x * box_extraextension_factor * 2, bb.extent.y * box_extraextension_factor * 2, 0.4 };
 
     MeshReconstruction::Vec3 cubeSize{ CubeSize, CubeSize, 0.2 };
-    auto mesh = MeshReconstruction::MarchCube(junctionsdf, domain, cubeSize );
+    auto mesh = MeshReconstruction::MarchCubeGrid(junctionsdf, domain, cubeSize);
     carla::geom::Rotation inverse = bb.rotation;
     carla::geom::Vector3D trasltation = bb.location;
     geom::Mesh out_mesh;
+    out_mesh.Reserve(mesh.vertices.size(), 3u * mesh.triangles.size());
 
     for (auto& cv : mesh.vertices) {
       geom::Vector3D newvertex;
@@ -1539,26 +1664,29 @@ namespace road {
       out_mesh.AddVertex(newvertex);
     }
 
-    auto finalvertices = out_mesh.GetVertices();
-    for (auto ct : mesh.triangles) {
+    for (const auto& ct : mesh.triangles) {
       out_mesh.AddIndex(ct[1] + 1);
       out_mesh.AddIndex(ct[0] + 1);
       out_mesh.AddIndex(ct[2] + 1);
     }
 
-    for (auto& cv : out_mesh.GetVertices() ) {
-      boost::optional<element::Waypoint> CheckingWaypoint = GetWaypoint(geom::Location(cv), 0x1 << 1);
-      if (!CheckingWaypoint)
+    // Move the vertices out of the lanes to the lane border
+    std::vector<geom::Location> vertex_locations(
+        out_mesh.GetVertices().begin(), out_mesh.GetVertices().end());
+    const auto closest_waypoints = GetClosestWaypointsOnRoad(vertex_locations, 0x1 << 1, 1u);
+    for (size_t i = 0; i < out_mesh.GetVertices().size(); ++i) {
+      auto& cv = out_mesh.GetVertices()[i];
+      const ClosestWaypoint& InRoadWaypoint = *closest_waypoints[i];
+      if (!(InRoadWaypoint.distance < InRoadWaypoint.lane_width * 0.5))
       {
-        boost::optional<element::Waypoint> InRoadWaypoint = GetClosestWaypointOnRoad(geom::Location(cv), 0x1 << 1);
-        geom::Transform InRoadWPTransform = ComputeTransform(*InRoadWaypoint);
+        const geom::Transform& InRoadWPTransform = InRoadWaypoint.transform;
 
         geom::Vector3D director = geom::Location(cv) - (InRoadWPTransform.location);
-        geom::Vector3D laneborder = InRoadWPTransform.location + geom::Location(director.MakeUnitVector() * GetLaneWidth(*InRoadWaypoint) * 0.5f);
+        geom::Vector3D laneborder = InRoadWPTransform.location + geom::Location(director.MakeUnitVector() * InRoadWaypoint.lane_width * 0.5f);
         cv = laneborder;
       }
     }
-    return std::make_unique<geom::Mesh>(out_mesh);
+    return std::make_unique<geom::Mesh>(std::move(out_mesh));
   }
 
   void Map::GenerateSingleJunction(const carla::geom::MeshFactory& mesh_factory,
@@ -1592,6 +1720,7 @@ namespace road {
           }
         }
         std::unique_ptr<geom::Mesh> sidewalk_mesh = std::make_unique<geom::Mesh>();
+        sidewalk_mesh->ReserveToMerge(sidewalk_lane_meshes);
         for (auto& lane : sidewalk_lane_meshes) {
           *sidewalk_mesh += *lane;
         }
@@ -1615,10 +1744,12 @@ namespace road {
           }
         }
         std::unique_ptr<geom::Mesh> merged_mesh = std::make_unique<geom::Mesh>();
+        merged_mesh->ReserveToMerge(lane_meshes);
         for (auto& lane : lane_meshes) {
           *merged_mesh += *lane;
         }
         std::unique_ptr<geom::Mesh> sidewalk_mesh = std::make_unique<geom::Mesh>();
+        sidewalk_mesh->ReserveToMerge(sidewalk_lane_meshes);
         for (auto& lane : sidewalk_lane_meshes) {
           *sidewalk_mesh += *lane;
         }
@@ -11,6 +11,7 @@
 #include "Carla/Geom/Rtree.h"
 #include "Carla/Geom/Transform.h"
 #include "Carla/NonCopyable.h"
+#include "Carla/Road/LaneMarkBatch.h"
 #include "Carla/Road/element/LaneMarking.h"
 #include "Carla/Road/element/RoadInfoMarkRecord.h"
 #include "Carla/Road/element/RoadWaypoint.h"
@@ -19,14 +20,23 @@
 #include "Carla/Road/MeshFactory.h"
 #include "Carla/Geom/Vector3D.h"
 #include "Carla/RPC/OpendriveGenerationParameters.h"
+#include "Carla/WorkStealingPool.h"
 
 
 #include <Carla/disable-ue4-macros.h>
 #include <boost/optional.hpp>
 #include <Carla/enable-ue4-macros.h>
 
+#include <memory>
 #include <vector>
 
+// Balancing algorithm of the waypoint R-tree of road::Map. CreateRtree packs
+// the tree, which only uses the node size, so it rarely matters; see
+// Tools/Headless/RtreeBenchmark.cpp to compare them.
+#ifndef LIBCARLA_WAYPOINT_RTREE_PARAMETERS
+#  define LIBCARLA_WAYPOINT_RTREE_PARAMETERS boost::geometry::index::linear<16>
+#endif // LIBCARLA_WAYPOINT_RTREE_PARAMETERS
+
 namespace carla {
 namespace road {
 
@@ -34,6 +44,8 @@ namespace road {
   public:
 
     using Waypoint = element::Waypoint;
+    using RtreeParameters = LIBCARLA_WAYPOINT_RTREE_PARAMETERS;
+    using RtreeElement = geom::SegmentCloudRtree<Waypoint, 3, RtreeParameters>::TreeElement;
     /// ========================================================================
     /// -- Constructor ---------------------------------------------------------
     /// ========================================================================
@@ -42,6 +54,13 @@ namespace road {
       CreateRtree();
     }
 
+    /// Constructs the map with the segments previously computed by
+    /// CreateRtree (e.g. loaded from a MapCache), skipping its computation.
+    Map(::carla::road::MapData m, const std::vector<RtreeElement> &rtree_elements)
+      : _data(std::move(m)) {
+      _rtree.BulkLoad(rtree_elements);
+    }
+
     /// ========================================================================
     /// -- Georeference --------------------------------------------------------
     /// ========================================================================
@@ -62,6 +81,34 @@ namespace road {
         const geom::Location &location,
         int32_t lane_type = static_cast<int32_t>(Lane::LaneType::Driving)) const;
 
+    /// Result of GetClosestWaypointsOnRoad for one location.
+    struct ClosestWaypoint {
+
+      element::Waypoint waypoint;
+
+      /// ComputeTransform(waypoint).
+      geom::Transform transform;
+
+      /// GetLaneWidth(waypoint).
+      double lane_width = 0.0;
+
+      /// 2D distance from the location to transform.location. The location
+      /// is on the lane, as GetWaypoint returns it, if it is smaller than
+      /// half of lane_width.
+      float distance = 0.0f;
+    };
+
+    /// Same as GetClosestWaypointOnRoad for every location of @a locations,
+    /// also returning the transform, the lane width and the distance to the
+    /// waypoint. The queries are sorted along a Morton curve, so consecutive
+    /// ones visit the same nodes of the R-tree, and run on @a worker_count
+    /// threads, or on the threads of the map if zero. Pass one from a job
+    /// already running on a pool.
+    std::vector<boost::optional<ClosestWaypoint>> GetClosestWaypointsOnRoad(
+        const std::vector<geom::Location> &locations,
+        int32_t lane_type = static_cast<int32_t>(Lane::LaneType::Driving),
+        size_t worker_count = 0u) const;
+
     boost::optional<element::Waypoint> GetWaypoint(
         ::carla::road::RoadId road_id,
         ::carla::road::LaneId lane_id,
@@ -188,6 +235,15 @@ namespace road {
       const geom::Vector3D& maxpos,
       std::vector<std::string>& outinfo ) const;
 
+    /// Builds the line markings of the roads in the box between @a minpos and
+    /// @a maxpos merged in a batch per material. Each mark is assigned to the
+    /// tile that contains its centroid and the duplicated ones are dropped,
+    /// see MergeLaneMarkPieces.
+    std::vector<LaneMarkBatch> GenerateLaneMarkBatches(
+      const rpc::OpendriveGenerationParameters& params,
+      const geom::Vector3D& minpos,
+      const geom::Vector3D& maxpos ) const;
+
     const std::unordered_map<SignId, std::unique_ptr<Signal>>& GetSignals() const {
       return _data.GetSignals();
     }
@@ -198,6 +254,16 @@ namespace road {
 
     std::vector<carla::geom::BoundingBox> GetJunctionsBoundingBoxes() const;
 
+    /// Return the segments of the waypoint R-tree, see MapCache.
+    std::vector<RtreeElement> GetRtreeElements() const {
+      return _rtree.GetElements();
+    }
+
+    /// Road network of the map. The waypoint queries walk its FlatMapData.
+    const MapData &GetMapData() const {
+      return _data;
+    }
+
 #ifdef LIBCARLA_WITH_GTEST
     MapData &GetMap() {
       return _data;
@@ -209,11 +275,36 @@ private:
     friend MapBuilder;
     MapData _data;
 
-    using Rtree = geom::SegmentCloudRtree<Waypoint>;
+    using Rtree = geom::SegmentCloudRtree<Waypoint, 3, RtreeParameters>;
     Rtree _rtree;
 
+    /// Runs the parallel loops of the map. Its threads are kept alive with the
+    /// map, so they are shared by the tiles generated from it.
+    std::unique_ptr<WorkStealingPool> _pool = std::make_unique<WorkStealingPool>();
+
     void CreateRtree();
 
+    /// Index of the lane of @a waypoint in the FlatMapData of the map. Throws
+    /// std::out_of_range if the map has no such lane.
+    FlatMapData::Index GetLaneIndex(Waypoint waypoint) const;
+
+    /// Boxes in the XY plane covering the full width of every road and
+    /// junction, built by MapBuilder. Used to select the ones of a region.
+    using RoadIndex = geom::BoxCloudRtree<RoadId, 2>;
+    RoadIndex _road_index;
+
+    using JunctionIndex = geom::BoxCloudRtree<JuncId, 2>;
+    JunctionIndex _junction_index;
+
+    /// Same as ComputeJunctionConflicts(JuncId), also returning the number of
+    /// segments of the junction and of pairs of them whose distance was
+    /// computed.
+    std::unordered_map<road::RoadId, std::unordered_set<road::RoadId>>
+        ComputeJunctionConflicts(
+            JuncId id,
+            size_t &segment_count,
+            size_t &pair_count) const;
+
     /// Helper Functions for constructing the rtree element list
     void AddElementToRtree(
         std::vector<Rtree::TreeElement> &rtree_elements,
@@ -231,32 +322,28 @@ private:
 public:
     inline float GetZPosInDeformation(float posx, float posy) const;
 
-    std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>>
-      GenerateRoadsMultithreaded( const carla::geom::MeshFactory& mesh_factory,
-        const std::vector<RoadId>& RoadsID,
-        const size_t index,
-        const size_t number_of_roads_per_thread) const;
-
-    void GenerateJunctions(const carla::geom::MeshFactory& mesh_factory,
-      const rpc::OpendriveGenerationParameters& params,
-      const geom::Vector3D& minpos,
-      const geom::Vector3D& maxpos,
-      std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>>*
-      juntion_out_mesh_list) const;
-
     void GenerateSingleJunction(const carla::geom::MeshFactory& mesh_factory,
       const JuncId Id,
       std::map<road::Lane::LaneType, std::vector<std::unique_ptr<geom::Mesh>>>*
       junction_out_mesh_list) const;
 
-    // Return list of junction ID which are between those positions
+    // Return list of junction ID whose bounding box center is inside the
+    // box between those positions, in any corner order. Each junction
+    // belongs to a single tile
     std::vector<JuncId> FilterJunctionsByPosition(
       const geom::Vector3D& minpos,
       const geom::Vector3D& maxpos) const;
-    // Return list of roads ID which are between those positions
+    // Return list of roads ID whose midpoint of the first lane section is
+    // inside the box between those positions, in any corner order. Each road
+    // belongs to a single tile
     std::vector<RoadId> FilterRoadsByPosition(
       const geom::Vector3D& minpos,
       const geom::Vector3D& maxpos ) const;
+    // Return list of roads ID which overlap the box between those positions,
+    // in any corner order. A road crossing a tile border is in several tiles
+    std::vector<RoadId> FilterRoadsOverlapping(
+      const geom::Vector3D& minpos,
+      const geom::Vector3D& maxpos ) const;
 
     std::unique_ptr<geom::Mesh> SDFToMesh(const road::Junction& jinput, const std::vector<geom::Vector3D>& sdfinput, int grid_cells_per_dim) const;
   };
@@ -68,37 +68,68 @@ namespace element {
     static_cast<float>(y * cos_a + x * sin_a));
   }
 
+  GeometrySpiral::GeometrySpiral(
+      double start_offset,
+      double length,
+      double heading,
+      const geom::Location &start_pos,
+      double curv_s,
+      double curv_e)
+    : Geometry(GeometryType::SPIRAL, start_offset, length, heading, start_pos),
+      _curve_start(curv_s),
+      _curve_end(curv_e) {
+    _curve_dot = (_curve_end - _curve_start) / (_length);
+    _s_o = _curve_start / _curve_dot;
+    odrSpiral(_s_o, _curve_dot, &_x_o, &_y_o, &_t_o);
+    _cos_o = std::cos(_heading - _t_o);
+    _sin_o = std::sin(_heading - _t_o);
+  }
+
+  DirectedPoint GeometrySpiral::FromStandardSpiral(double x, double y, double t) const {
+    x = x - _x_o;
+    y = y - _y_o;
+    t = t - _t_o;
+
+    // Same as RotatebyAngle(_heading - _t_o, x, y)
+    DirectedPoint p(_start_position, _heading);
+    p.location.x += static_cast<float>(x * _cos_o - y * _sin_o);
+    p.location.y += static_cast<float>(y * _cos_o + x * _sin_o);
+    p.tangent = _heading + t;
+
+    return p;
+  }
+
   DirectedPoint GeometrySpiral::PosFromDist(double dist) const {
     dist = geom::Math::Clamp(dist, 0.0, _length);
     DEBUG_ASSERT(_length > 0.0);
-    DirectedPoint p(_start_position, _heading);
-
-    const double curve_end = (_curve_end);
-    const double curve_start = (_curve_start);
-    const double curve_dot = (curve_end - curve_start) / (_length);
-    const double s_o = curve_start / curve_dot;
-    double s = s_o + dist;
 
     double x;
     double y;
     double t;
-    odrSpiral(s, curve_dot, &x, &y, &t);
+    odrSpiral(_s_o + dist, _curve_dot, &x, &y, &t);
 
-    double x_o;
-    double y_o;
-    double t_o;
-    odrSpiral(s_o, curve_dot, &x_o, &y_o, &t_o);
+    return FromStandardSpiral(x, y, t);
+  }
 
-    x = x - x_o;
-    y = y - y_o;
-    t = t - t_o;
+  void GeometrySpiral::PosFromDists(
+      const std::vector<double> &dists,
+      std::vector<DirectedPoint> &out) const {
+    DEBUG_ASSERT(_length > 0.0);
+    const size_t count = dists.size();
+    std::vector<double> s(count);
+    for (size_t i = 0u; i < count; ++i) {
+      s[i] = _s_o + geom::Math::Clamp(dists[i], 0.0, _length);
+    }
 
-    geom::Vector2D pos = RotatebyAngle(_heading - t_o, x, y);
-    p.location.x += pos.x;
-    p.location.y += pos.y;
-    p.tangent = _heading + t;
+    std::vector<double> x(count);
+    std::vector<double> y(count);
+    std::vector<double> t(count);
+    odrSpiralBatch(s.data(), count, _curve_dot, x.data(), y.data(), t.data());
 
-    return p;
+    out.resize(count);
+    for (size_t i = 0u; i < count; ++i) {
+      out[i] = FromStandardSpiral(x[i], y[i], t[i]);
+    }
   }
 
   /// @todo
@@ -108,17 +139,27 @@ namespace element {
     return {location.x - _start_position.x, location.y - _start_position.y};
   }
 
-  DirectedPoint GeometryPoly3::PosFromDist(double dist) const {
-    auto result = _rtree.GetNearestNeighbours(
-        Rtree::BPoint(static_cast<float>(dist))).front();
-
-    auto &val1 = result.second.first;
-    auto &val2 = result.second.second;
+  double ArcLengthTable::GetParameter(double s) const {
+    if (_samples.size() < 2u) {
+      return 0.0;
+    }
+    // First sample past s, keeping an interval on both sides to extrapolate
+    auto it = std::upper_bound(
+        _samples.begin() + 1, _samples.end() - 1, s,
+        [](double value, const Sample &sample) { return value < sample.s; });
+    const Sample &first = *(it - 1);
+    const Sample &second = *it;
+    const double ds = second.s - first.s;
+    if (ds <= 0.0) {
+      return first.p;
+    }
+    return first.p + (s - first.s) / ds * (second.p - first.p);
+  }
 
-    double rate = (val2.s - dist) / (val2.s - val1.s);
-    double u = rate * val1.u + (1.0 - rate) * val2.u;
-    double v = rate * val1.v + (1.0 - rate) * val2.v;
-    double tangent = atan((rate * val1.t + (1.0 - rate) * val2.t)); // ?
+  DirectedPoint GeometryPoly3::PosFromDist(double dist) const {
+    const double u = _arc_length.GetParameter(dist);
+    const double v = _poly.Evaluate(u);
+    const double tangent = std::atan(_poly.Tangent(u));
 
     geom::Vector2D pos = RotatebyAngle(_heading, u, v);
     DirectedPoint p(_start_position, _heading + tangent);
@@ -136,47 +177,23 @@ namespace element {
   void GeometryPoly3::PreComputeSpline() {
     // Roughly the interval size in m
     constexpr double interval_size = 0.3;
-    const double delta_u = interval_size; // interval between values of u
-    double current_s = 0;
-    double current_u = 0;
-    double last_u = 0;
-    double last_v = _poly.Evaluate(current_u);
-    double last_s = 0;
-    RtreeValue last_val{last_u, last_v, last_s, _poly.Tangent(current_u)};
-    while (current_s < _length + delta_u) {
-      current_u += delta_u;
-      double current_v = _poly.Evaluate(current_u);
-      double du = current_u - last_u;
-      double dv = current_v - last_v;
-      double ds = sqrt(du * du + dv * dv);
-      current_s += ds;
-      double current_t = _poly.Tangent(current_u);
-      RtreeValue current_val{current_u, current_v, current_s, current_t};
-
-      Rtree::BPoint p1(static_cast<float>(last_s));
-      Rtree::BPoint p2(static_cast<float>(current_s));
-      _rtree.InsertElement(Rtree::BSegment(p1, p2), last_val, current_val);
-
-      last_u = current_u;
-      last_v = current_v;
-      last_s = current_s;
-      last_val = current_val;
-
-    }
+    // u runs along the reference line, the table goes one interval past the
+    // end of the geometry
+    _arc_length.Build(
+        [this](double u) {
+          const double dv = _poly.Tangent(u);
+          return std::sqrt(1.0 + dv * dv);
+        },
+        interval_size,
+        static_cast<size_t>(_length / interval_size) + 2u,
+        _length + interval_size);
   }
 
   DirectedPoint GeometryParamPoly3::PosFromDist(double dist) const {
-    auto result = _rtree.GetNearestNeighbours(
-        Rtree::BPoint(static_cast<float>(dist))).front();
-
-    auto &val1 = result.second.first;
-    auto &val2 = result.second.second;
-    double rate = (val2.s - dist) / (val2.s - val1.s);
-    double u = rate * val1.u + (1.0 - rate) * val2.u;
-    double v = rate * val1.v + (1.0 - rate) * val2.v;
-    double t_u = (rate * val1.t_u + (1.0 - rate) * val2.t_u);
-    double t_v = (rate * val1.t_v + (1.0 - rate) * val2.t_v);
-    double tangent = atan2(t_v, t_u); // ?
+    const double param_p = _arc_length.GetParameter(dist);
+    const double u = _polyU.Evaluate(param_p);
+    const double v = _polyV.Evaluate(param_p);
+    const double tangent = std::atan2(_polyV.Tangent(param_p), _polyU.Tangent(param_p));
 
     geom::Vector2D pos = RotatebyAngle(_heading, u, v);
     DirectedPoint p(_start_position, _heading + tangent);
@@ -184,6 +201,7 @@ namespace element {
     p.location.y += pos.y;
     return p;
   }
+
   std::pair<float, float> GeometryParamPoly3::DistanceTo(const geom::Location &) const {
     // No analytical expression (Newton-Raphson?/point search)
     // throw_exception(std::runtime_error("not implemented"));
@@ -199,47 +217,15 @@ namespace element {
     if (_arcLength) {
         delta_p *= _length;
     }
-    double param_p = 0;
-    double current_s = 0;
-    double last_u = _polyU.Evaluate(param_p);
-    double last_v = _polyV.Evaluate(param_p);
-    double last_s = 0;
-    RtreeValue last_val{
-        last_u,
-        last_v,
-        last_s,
-        _polyU.Tangent(param_p),
-        _polyV.Tangent(param_p) };
-    for(size_t i = 0; i < number_intervals; ++i) {
-      param_p += delta_p;
-      double current_u = _polyU.Evaluate(param_p);
-      double current_v = _polyV.Evaluate(param_p);
-      double du = current_u - last_u;
-      double dv = current_v - last_v;
-      double ds = sqrt(du * du + dv * dv);
-      current_s += ds;
-      double current_t_u = _polyU.Tangent(param_p);
-      double current_t_v = _polyV.Tangent(param_p);
-      RtreeValue current_val{
-          current_u,
-          current_v,
-          current_s,
-          current_t_u,
-          current_t_v };
-
-      Rtree::BPoint p1(static_cast<float>(last_s));
-      Rtree::BPoint p2(static_cast<float>(current_s));
-      _rtree.InsertElement(Rtree::BSegment(p1, p2), last_val, current_val);
-
-      last_u = current_u;
-      last_v = current_v;
-      last_s = current_s;
-      last_val = current_val;
-
-      if(current_s > _length){
-        break;
-      }
-    }
+    _arc_length.Build(
+        [this](double param_p) {
+          const double du = _polyU.Tangent(param_p);
+          const double dv = _polyV.Tangent(param_p);
+          return std::sqrt(du * du + dv * dv);
+        },
+        delta_p,
+        number_intervals,
+        _length);
   }
 } // namespace element
 } // namespace road
@@ -9,7 +9,10 @@
 #include "Carla/Geom/Location.h"
 #include "Carla/Geom/Math.h"
 #include "Carla/Geom/CubicPolynomial.h"
-#include "Carla/Geom/Rtree.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
 
 namespace carla {
 namespace road {
@@ -70,6 +73,18 @@ namespace element {
 
     virtual DirectedPoint PosFromDist(double dist) const = 0;
 
+    /// Computes PosFromDist for every distance in @a dists into @a out.
+    /// Geometries whose evaluation is expensive override it to evaluate them
+    /// in batch.
+    virtual void PosFromDists(
+        const std::vector<double> &dists,
+        std::vector<DirectedPoint> &out) const {
+      out.resize(dists.size());
+      for (size_t i = 0u; i < dists.size(); ++i) {
+        out[i] = PosFromDist(dists[i]);
+      }
+    }
+
     virtual std::pair<float, float> DistanceTo(const geom::Location &p) const = 0;
 
   protected:
@@ -170,10 +185,7 @@ namespace element {
         double heading,
         const geom::Location &start_pos,
         double curv_s,
-        double curv_e)
-      : Geometry(GeometryType::SPIRAL, start_offset, length, heading, start_pos),
-        _curve_start(curv_s),
-        _curve_end(curv_e) {}
+        double curv_e);
 
     double GetCurveStart() {
       return _curve_start;
@@ -185,12 +197,90 @@ namespace element {
 
     DirectedPoint PosFromDist(double dist) const override;
 
+    /// Evaluates the Fresnel integrals of all the distances in one pass.
+    void PosFromDists(
+        const std::vector<double> &dists,
+        std::vector<DirectedPoint> &out) const override;
+
     std::pair<float, float> DistanceTo(const geom::Location &) const override;
 
   private:
 
+    /// Places the point (@a x, @a y, @a t) of the standard spiral relative
+    /// to the start of this geometry.
+    DirectedPoint FromStandardSpiral(double x, double y, double t) const;
+
     double _curve_start;
     double _curve_end;
+
+    // Constant terms of PosFromDist, the start of this geometry on the
+    // standard spiral and its rotation
+    double _curve_dot;
+    double _s_o;
+    double _x_o;
+    double _y_o;
+    double _t_o;
+    double _cos_o;
+    double _sin_o;
+  };
+
+  /// Maps the arc length of a parametric curve to its parameter.
+  ///
+  /// The arc length of each interval is integrated with a five point
+  /// Gauss-Legendre quadrature of the speed of the curve. A lookup is a
+  /// binary search over the flat table and a linear interpolation, so it
+  /// neither allocates nor depends on the number of intervals beyond log(n).
+  class ArcLengthTable {
+  public:
+
+    /// Tabulates the curve from parameter 0 in steps of @a delta_p. Stops
+    /// after @a max_intervals, or after the first interval whose end is
+    /// further than @a end_length.
+    template <typename SpeedFunction>
+    void Build(
+        SpeedFunction &&speed,
+        double delta_p,
+        size_t max_intervals,
+        double end_length) {
+      // Nodes and weights of the quadrature on [-1, 1]
+      static constexpr double nodes[] = {
+          0.0,
+          -0.5384693101056831, 0.5384693101056831,
+          -0.9061798459386640, 0.9061798459386640};
+      static constexpr double weights[] = {
+          0.5688888888888889,
+          0.4786286704993665, 0.4786286704993665,
+          0.2369268850561891, 0.2369268850561891};
+      _samples.clear();
+      _samples.push_back({0.0, 0.0});
+      double s = 0.0;
+      for (size_t i = 0u; i < max_intervals; ++i) {
+        const double p0 = static_cast<double>(i) * delta_p;
+        const double half = 0.5 * delta_p;
+        double ds = 0.0;
+        for (size_t k = 0u; k < 5u; ++k) {
+          ds += weights[k] * speed(p0 + half * (1.0 + nodes[k]));
+        }
+        s += half * ds;
+        _samples.push_back({s, p0 + delta_p});
+        if (s > end_length) {
+          break;
+        }
+      }
+    }
+
+    /// Parameter at arc length @a s, extrapolated past both ends of the
+    /// table.
+    double GetParameter(double s) const;
+
+  private:
+
+    struct Sample {
+      double s;
+      double p;
+    };
+
+    std::vector<Sample> _samples;
   };
 
   class GeometryPoly3 final : public Geometry {
@@ -240,15 +330,8 @@ namespace element {
     double _c;
     double _d;
 
-    struct RtreeValue {
-      double u = 0;
-      double v = 0;
-      double s = 0;
-      double t = 0;
-    };
-    using Rtree = geom::SegmentCloudRtree<RtreeValue, 1>;
-    using TreeElement = Rtree::TreeElement;
-    Rtree _rtree;
+    /// Arc length to u.
+    ArcLengthTable _arc_length;
     void PreComputeSpline();
   };
 
@@ -327,16 +410,8 @@ namespace element {
     double _dV;
     bool _arcLength;
 
-    struct RtreeValue {
-      double u = 0;
-      double v = 0;
-      double s = 0;
-      double t_u = 0;
-      double t_v = 0;
-    };
-    using Rtree = geom::SegmentCloudRtree<RtreeValue, 1>;
-    using TreeElement = Rtree::TreeElement;
-    Rtree _rtree;
+    /// Arc length to p.
+    ArcLengthTable _arc_length;
     void PreComputeSpline();
   };
 
@@ -0,0 +1,262 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "Carla/NonCopyable.h"
+#include "Carla/ThreadGroup.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace carla {
+
+namespace detail {
+
+  /// Range of item indices owned by a worker. The owner pops items from the
+  /// front while other workers steal the back half of it.
+  class StealableRange : private NonCopyable {
+  public:
+
+    void Reset(size_t begin, size_t end) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _begin = begin;
+      _end = end;
+    }
+
+    bool PopFront(size_t &item) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_begin >= _end) {
+        return false;
+      }
+      item = _begin++;
+      return true;
+    }
+
+    bool StealBackHalf(size_t &begin, size_t &end) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_begin >= _end) {
+        return false;
+      }
+      begin = _begin + (_end - _begin) / 2u;
+      end = _end;
+      _end = begin;
+      return true;
+    }
+
+  private:
+
+    std::mutex _mutex;
+
+    size_t _begin = 0u;
+
+    size_t _end = 0u;
+  };
+
+} // namespace detail
+
+  /// Runs loops of independent items on a bounded number of threads.
+  ///
+  /// Items are split in one contiguous range per worker; a worker that runs
+  /// out of items steals half of the remaining range of another one, so a few
+  /// expensive items don't serialize the tail of the loop.
+  ///
+  /// The worker threads are started by the first ParallelFor that needs them
+  /// and stay alive until the pool is destroyed. A ParallelFor called from
+  /// inside another one (of this or any other pool), or while the pool is
+  /// busy with a loop of another thread, runs serially on the calling thread.
+  class WorkStealingPool : private NonCopyable {
+  public:
+
+    /// Use @a worker_count threads (including the calling one), or all the
+    /// available hardware concurrency if zero.
+    explicit WorkStealingPool(size_t worker_count = 0u)
+      : _worker_count(worker_count > 0u ?
+            worker_count :
+            std::max<size_t>(1u, std::thread::hardware_concurrency())) {}
+
+    ~WorkStealingPool() {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+      }
+      _job_available.notify_all();
+      _threads.JoinAll();
+    }
+
+    size_t GetWorkerCount() const {
+      return _worker_count;
+    }
+
+    /// Whether the calling thread is running an item of a ParallelFor.
+    static bool IsInsideParallelFor() {
+      return InsideParallelFor();
+    }
+
+    /// Calls @a functor(item, worker) for every item in [0, @a count) and
+    /// blocks until all of them are done. @a worker is in
+    /// [0, GetWorkerCount()) and no two calls with the same @a worker run at
+    /// the same time, so it can be used to index per-worker buffers that
+    /// don't need locking.
+    ///
+    /// If an item throws, the items not started yet are skipped and the first
+    /// exception is rethrown on the calling thread, whichever worker ran it.
+    template <typename F>
+    void ParallelFor(size_t count, F &&functor) {
+      if (count == 0u) {
+        return;
+      }
+
+      std::unique_lock<std::mutex> run_lock(_run_mutex, std::defer_lock);
+      const size_t workers = std::min(_worker_count, count);
+      if (workers == 1u || InsideParallelFor() || !run_lock.try_lock()) {
+        for (size_t item = 0u; item < count; ++item) {
+          functor(item, 0u);
+        }
+        return;
+      }
+
+      std::unique_ptr<detail::StealableRange[]> ranges(new detail::StealableRange[workers]);
+      for (size_t i = 0u; i < workers; ++i) {
+        ranges[i].Reset(count * i / workers, count * (i + 1u) / workers);
+      }
+
+      std::atomic<bool> failed{false};
+      std::exception_ptr error;
+      std::mutex error_mutex;
+      const std::function<void(size_t)> work = [&](size_t worker) {
+        size_t item;
+        while (!failed.load(std::memory_order_relaxed)) {
+          while (!failed.load(std::memory_order_relaxed) && ranges[worker].PopFront(item)) {
+            try {
+              functor(item, worker);
+            } catch (...) {
+              std::lock_guard<std::mutex> lock(error_mutex);
+              if (!error) {
+                error = std::current_exception();
+              }
+              failed = true;
+            }
+          }
+          bool stolen = false;
+          for (size_t i = 1u; i < workers && !stolen && !failed.load(std::memory_order_relaxed); ++i) {
+            size_t begin, end;
+            if (ranges[(worker + i) % workers].StealBackHalf(begin, end)) {
+              ranges[worker].Reset(begin, end);
+              stolen = true;
+            }
+          }
+          if (!stolen) {
+            return;
+          }
+        }
+      };
+
+      StartThreads();
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = &work;
+        _active_workers = workers;
+        _pending_workers = workers - 1u;
+        ++_generation;
+      }
+      _job_available.notify_all();
+
+      {
+        // The other workers reference the ranges and the functor, wait for
+        // them before leaving
+        struct Wait {
+          WorkStealingPool &pool;
+          ~Wait() {
+            InsideParallelFor() = false;
+            std::unique_lock<std::mutex> lock(pool._mutex);
+            pool._job_done.wait(lock, [this]() { return pool._pending_workers == 0u; });
+            pool._job = nullptr;
+          }
+        } wait{*this};
+        InsideParallelFor() = true;
+        work(0u);
+      }
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+  private:
+
+    static bool &InsideParallelFor() {
+      static thread_local bool inside = false;
+      return inside;
+    }
+
+    void StartThreads() {
+      if (_threads_started) {
+        return;
+      }
+      _threads_started = true;
+      for (size_t i = 1u; i < _worker_count; ++i) {
+        _threads.CreateThread([this, i]() { WorkerLoop(i); });
+      }
+    }
+
+    void WorkerLoop(size_t worker) {
+      InsideParallelFor() = true;
+      uint64_t generation = 0u;
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (true) {
+        _job_available.wait(lock, [&]() { return _stop || _generation != generation; });
+        if (_stop) {
+          return;
+        }
+        generation = _generation;
+        if (worker >= _active_workers) {
+          continue;
+        }
+        const std::function<void(size_t)> &job = *_job;
+        lock.unlock();
+        job(worker);
+        lock.lock();
+        if (--_pending_workers == 0u) {
+          _job_done.notify_all();
+        }
+      }
+    }
+
+    const size_t _worker_count;
+
+    /// Held by the thread whose loop is running on the workers.
+    std::mutex _run_mutex;
+
+    std::mutex _mutex;
+
+    std::condition_variable _job_available;
+
+    std::condition_variable _job_done;
+
+    const std::function<void(size_t)> *_job = nullptr;
+
+    size_t _active_workers = 0u;
+
+    size_t _pending_workers = 0u;
+
+    uint64_t _generation = 0u;
+
+    bool _stop = false;
+
+    /// Only touched by the thread holding _run_mutex.
+    bool _threads_started = false;
+
+    ThreadGroup _threads;
+  };
+
+} // namespace carla
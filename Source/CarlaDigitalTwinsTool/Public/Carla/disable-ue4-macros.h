@@ -4,6 +4,9 @@
 // This work is licensed under the terms of the MIT license.
 // For a copy, see <https://opensource.org/licenses/MIT>.
 
+// Nothing to do when LibCarla is built without Unreal Engine.
+#ifndef LIBCARLA_HEADLESS
+
 #ifndef LIBCARLA_INCLUDED_DISABLE_UE4_MACROS_HEADER
 #define LIBCARLA_INCLUDED_DISABLE_UE4_MACROS_HEADER
 
@@ -6758,3 +6761,5 @@
 
 #pragma push_macro("PI")
 #undef PI
+
+#endif // LIBCARLA_HEADLESS
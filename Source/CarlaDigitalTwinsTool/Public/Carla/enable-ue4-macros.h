@@ -4,6 +4,9 @@
 // This work is licensed under the terms of the MIT license.
 // For a copy, see <https://opensource.org/licenses/MIT>.
 
+// Nothing to do when LibCarla is built without Unreal Engine.
+#ifndef LIBCARLA_HEADLESS
+
 #if defined(_MSC_VER)
 #  pragma warning(pop)
 #  ifdef UpdateResource
@@ -2257,3 +2260,5 @@
 #else
 #error "This file does not support nesting guards (preprocessor can't do math) - instead, in LibCarla, enable macros, include Unreal header, and disable macros."
 #endif
+
+#endif // LIBCARLA_HEADLESS
@@ -10,7 +10,7 @@
 #include "Commandlets/Commandlet.h"
 #include "GenerateTileCommandlet.generated.h"
 
-// Each commandlet should generate only 1 Tile
+// Each commandlet generates only 1 Tile, unless -AllTiles is passed
 
 DECLARE_LOG_CATEGORY_EXTERN(LogCarlaToolsMapGenerateTileCommandlet, Log, All);
 
@@ -13,6 +13,8 @@
 #include "TextureResource.h"
 #include <boost/optional.hpp>
 #include "Generation/OpenDriveFileGenerationParameters.h"
+#include "Generation/TerrainHeightField.h"
+#include "Generation/TileGeometryPipeline.h"
 #include "OpenDriveToMap.generated.h"
 
 USTRUCT(BlueprintType)
@@ -92,6 +94,10 @@ public:
   UFUNCTION(BlueprintCallable)
   bool GoNextTile();
 
+  /// Generates every tile of the map, from the current one onwards.
+  UFUNCTION(BlueprintCallable)
+  void GenerateAllTiles();
+
   UFUNCTION(BlueprintCallable)
   void ReturnToMainLevel();
 
@@ -153,6 +159,11 @@ public:
   UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Defaults")
   UMaterialInstance* DefaultLaneMarksYellowMaterial;
 
+  /// Mesh instanced for the dashes of broken lane marks, scaled to their
+  /// length and width. The engine plane is used if it is not set.
+  UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Defaults")
+  UStaticMesh* DefaultLaneMarkDashMesh = nullptr;
+
   UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Defaults")
   UMaterialInstance* DefaultSidewalksMaterial;
 
@@ -200,6 +211,27 @@ public:
   UPROPERTY( EditAnywhere, BlueprintReadWrite, Category="TileGeneration" )
   FString BaseLevelName;
 
+  /// Keep the parsed carla::road::Map resident across tiles instead of
+  /// re-parsing the OpenDRIVE file for each one of them.
+  UPROPERTY( EditAnywhere, BlueprintReadWrite, Category="TileGeneration" )
+  bool bReuseParsedMap = true;
+
+  /// Load the precomputed map data from "<FilePath>.bin" when it matches the
+  /// OpenDRIVE content, and write it when it doesn't.
+  UPROPERTY( EditAnywhere, BlueprintReadWrite, Category="TileGeneration" )
+  bool bUseMapCache = true;
+
+  /// When generating all the tiles, generate the road meshes, lane marks and
+  /// tree positions of the next tiles in the background while the assets of
+  /// the current one are built and saved.
+  UPROPERTY( EditAnywhere, BlueprintReadWrite, Category="TileGeneration" )
+  bool bPipelineTiles = false;
+
+  /// Tiles generated ahead of the current one when pipelining. Each of them
+  /// holds its meshes in memory until its turn comes.
+  UPROPERTY( EditAnywhere, BlueprintReadWrite, Category="TileGeneration", meta=(ClampMin="1", ClampMax="8") )
+  int32 PipelineTileQueueDepth = 1;
+
   UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Heightmap")
   UTexture2D* DefaultHeightmap;
 
@@ -215,6 +247,16 @@ public:
   UPROPERTY( EditAnywhere, BlueprintReadWrite, Category="Heightmap" )
   float MaxHeight;
 
+  /// Place the terrain vertices and the trees on a height field rasterized
+  /// from the meshes generated for the tile, instead of line tracing each one
+  /// of them against the editor world.
+  UPROPERTY( EditAnywhere, BlueprintReadWrite, Category="Heightmap" )
+  bool bUseTerrainHeightField = true;
+
+  /// Cell size of the terrain height field, in centimeters.
+  UPROPERTY( EditAnywhere, BlueprintReadWrite, Category="Heightmap" )
+  float TerrainHeightFieldCellSize = 100.0f;
+
 protected:
 
   UFUNCTION(BlueprintCallable)
@@ -244,21 +286,64 @@ private:
   UFUNCTION(BlueprintCallable)
   void LoadMap();
 
-  void GenerateAll(const boost::optional<carla::road::Map>& ParamCarlaMap, FVector MinLocation, FVector MaxLocation);
-  void GenerateRoadMesh(const boost::optional<carla::road::Map>& ParamCarlaMap, FVector MinLocation, FVector MaxLocation);
+  /// Parses FilePath into CarlaMap, unless the same unmodified file is
+  /// already resident. Returns false if the map is not valid.
+  bool LoadCarlaMap();
+
+  /// Sets NumTilesInXY, TileSize and Tile0Offset, unless they are already
+  /// set. On UE4 they come from the ALargeMapManager of BaseLevelName. On
+  /// UE5 from the one of the editor world if any, otherwise the tile size
+  /// defaults to the one of ALargeMapManager and the number of tiles covers
+  /// the road network. Returns false if there is no grid to generate.
+  bool InitTileGrid();
+
+  /// Bounds of @a Tile, in centimeters. The y of @a OutMin is above the y
+  /// of @a OutMax.
+  void GetTileBounds(const FIntVector& Tile, FVector& OutMin, FVector& OutMax) const;
+
+  /// Advances @a Tile as GoNextTile does, returns false past the last tile.
+  bool GetNextTile(FIntVector& Tile) const;
+
+  FTileGeometrySettings GetTileGeometrySettings() const;
+
+  /// Copies the default materials to the plugin of the map before the first
+  /// tile, so the meshes of every tile reuse them.
+  void DuplicateDefaultMaterials();
+
+  /// Geometry of the current tile, prefetching the next ones if
+  /// bPipelineTiles is set.
+  TSharedPtr<FTileGeometry> TakeCurrentTileGeometry();
+
+  void GenerateAll(const boost::optional<carla::road::Map>& ParamCarlaMap, FVector MinLocation, FVector MaxLocation, const FTileGeometry& Geometry);
+  void GenerateRoadMesh(const boost::optional<carla::road::Map>& ParamCarlaMap, const FTileGeometry& Geometry);
   // void GenerateSpawnPoints(const carla::road::Map& ParamCarlaMap, FVector MinLocation, FVector MaxLocation);
-  void GenerateTreePositions(const boost::optional<carla::road::Map>& ParamCarlaMap, FVector MinLocation, FVector MaxLocation);
-  void GenerateLaneMarks(const boost::optional<carla::road::Map>& ParamCarlaMap, FVector MinLocation, FVector MaxLocation);
+  void GenerateTreePositions(const FTileGeometry& Geometry);
+  void GenerateLaneMarks(const boost::optional<carla::road::Map>& ParamCarlaMap, const FTileGeometry& Geometry);
 
   FTransform GetSnappedPosition(FTransform Origin);
 
+  /// Snaps every location, in parallel when the height field is available.
+  TArray<FTransform> GetSnappedPositions(
+      std::vector<std::pair<carla::geom::Transform, std::string>>& Locations);
+
   float GetHeightForLandscape(FVector Origin);
 
+  /// Derivatives of GetHeight along X and Y at a position, by central
+  /// differences over half a meter. Heights and positions are both in
+  /// centimeters, so the slopes have no units.
+  FVector2D GetHeightSlope(float PosX, float PosY, bool bDrivingLane);
+
   float DistanceToLaneBorder(
       const boost::optional<carla::road::Map>& CarlaMap,
       FVector &location,
       int32_t lane_type = static_cast<int32_t>(carla::road::Lane::LaneType::Driving)) const;
 
+  /// DistanceToLaneBorder of every location, with a single batched query.
+  std::vector<float> DistancesToLaneBorder(
+      const boost::optional<carla::road::Map>& CarlaMap,
+      const std::vector<carla::geom::Location>& Locations,
+      int32_t lane_type = static_cast<int32_t>(carla::road::Lane::LaneType::Driving)) const;
+
   bool IsInRoad(
       const boost::optional<carla::road::Map>& ParamCarlaMap,
       FVector &location) const;
@@ -272,6 +357,25 @@ private:
 
   boost::optional<carla::road::Map> CarlaMap;
 
+  FString LoadedMapFilePath;
+  FDateTime LoadedMapTimeStamp;
+
+  /// Road and terrain surface of the tile being generated.
+  FTerrainHeightField TerrainHeightField;
+
+  /// Geometry of the tiles generated ahead when bPipelineTiles is set.
+  FTileGeometryPipeline TilePipeline;
+
+  /// Game thread time of the tiles generated by GenerateAllTiles, in
+  /// seconds, to report the utilization of each stage.
+  double TileGeometrySeconds = 0.0;
+  double TileAssetSeconds = 0.0;
+  double TileSaveSeconds = 0.0;
+
+  /// Set while GenerateAllTiles runs, so GenerateTile leaves the object
+  /// rooted until the last tile.
+  bool bGeneratingAllTiles = false;
+
   UPROPERTY()
   UCustomFileDownloader* FileDownloader;
   
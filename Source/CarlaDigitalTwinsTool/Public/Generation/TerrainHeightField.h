@@ -0,0 +1,46 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/// Highest surface of the meshes generated for a tile, rasterized on a
+/// regular grid of the XY plane. Sampling it gives the height a vertical line
+/// trace from above would hit, without going through the physics scene, so
+/// it can be queried from any thread once it is built.
+class CARLADIGITALTWINSTOOL_API FTerrainHeightField
+{
+public:
+
+  /// Allocates an empty grid covering @a Bounds, in centimeters.
+  void Init(const FBox2D& Bounds, float InCellSize);
+
+  void Reset();
+
+  bool IsValid() const
+  {
+    return Heights.Num() > 0;
+  }
+
+  /// Rasterizes the triangles of a mesh whose vertices are relative to
+  /// @a Offset. Not thread safe.
+  void AddMesh(const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const FVector& Offset);
+
+  /// Height of the highest surface at (@a X, @a Y). Returns false if no mesh
+  /// covers that position.
+  bool GetHeight(float X, float Y, float& OutHeight) const;
+
+private:
+
+  void AddTriangle(const FVector& A, const FVector& B, const FVector& C);
+
+  FVector2D Origin = FVector2D::ZeroVector;
+
+  float CellSize = 100.0f;
+
+  int32 NumCellsX = 0;
+
+  int32 NumCellsY = 0;
+
+  TArray<float> Heights;
+};
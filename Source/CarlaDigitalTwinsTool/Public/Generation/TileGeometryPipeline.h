@@ -0,0 +1,116 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include <Carla/Road/RoadMap.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Geometry the carla:: road library generates for a tile. No Unreal object
+/// is involved, so it can be generated on any thread.
+struct CARLADIGITALTWINSTOOL_API FTileGeometry
+{
+  FIntVector Tile;
+
+  std::map<carla::road::Lane::LaneType, std::vector<std::unique_ptr<carla::geom::Mesh>>> RoadMeshes;
+
+  /// Lane marks merged by material, each one in the tile of its centroid.
+  std::vector<carla::road::LaneMarkBatch> LaneMarkBatches;
+
+  std::vector<std::pair<carla::geom::Transform, std::string>> TreeTransforms;
+
+  /// Time spent generating it, in seconds.
+  double GenerationSeconds = 0.0;
+};
+
+/// Parameters of the carla:: stages of a tile.
+struct CARLADIGITALTWINSTOOL_API FTileGeometrySettings
+{
+  carla::rpc::OpendriveGenerationParameters RoadParameters;
+
+  carla::rpc::OpendriveGenerationParameters LaneMarkParameters;
+
+  float DistanceBetweenTrees = 50.0f;
+
+  float DistanceFromRoadEdge = 3.0f;
+};
+
+/// Generates the geometry of the upcoming tiles on the thread pool while the
+/// game thread builds and saves the assets of the current one. At most
+/// QueueDepth tiles are generated ahead, which caps the memory it holds.
+class CARLADIGITALTWINSTOOL_API FTileGeometryPipeline
+{
+public:
+
+  ~FTileGeometryPipeline()
+  {
+    Flush();
+  }
+
+  /// Generates the geometry of the tile between @a MinLocation and
+  /// @a MaxLocation, in centimeters, on the calling thread.
+  static TSharedPtr<FTileGeometry> Generate(
+      const carla::road::Map& Map,
+      const FTileGeometrySettings& Settings,
+      const FIntVector& Tile,
+      const FVector& MinLocation,
+      const FVector& MaxLocation);
+
+  /// Starts generating @a Tile in the background, unless it is already
+  /// queued or QueueDepth tiles are. @a Map has to outlive the generation,
+  /// see Flush.
+  void Prefetch(
+      const carla::road::Map& Map,
+      const FTileGeometrySettings& Settings,
+      int32 QueueDepth,
+      const FIntVector& Tile,
+      const FVector& MinLocation,
+      const FVector& MaxLocation);
+
+  /// Returns the geometry of @a Tile, waiting for it if it is being
+  /// prefetched, or generating it here if it is not.
+  TSharedPtr<FTileGeometry> Take(
+      const carla::road::Map& Map,
+      const FTileGeometrySettings& Settings,
+      const FIntVector& Tile,
+      const FVector& MinLocation,
+      const FVector& MaxLocation);
+
+  /// Waits for and drops every prefetched tile. Has to be called before the
+  /// map they are generated from is destroyed.
+  void Flush();
+
+  int32 Num() const
+  {
+    return Queue.Num();
+  }
+
+  /// Time the game thread spent waiting for prefetched tiles, in seconds.
+  double GetWaitSeconds() const
+  {
+    return WaitSeconds;
+  }
+
+  void ResetStats()
+  {
+    WaitSeconds = 0.0;
+  }
+
+private:
+
+  struct FQueuedTile
+  {
+    const carla::road::Map* Map;
+    FIntVector Tile;
+    TFuture<TSharedPtr<FTileGeometry>> Geometry;
+  };
+
+  TArray<FQueuedTile> Queue;
+
+  double WaitSeconds = 0.0;
+};
@@ -14,6 +14,7 @@
 #include "Components/InstancedStaticMeshComponent.h"
 #include "Components/SceneComponent.h"
 #include "PhysicsEngine/BodySetup.h"
+#include "Async/ParallelFor.h"
 // Carla C++ headers
 
 // Carla plugin headers
@@ -40,12 +41,11 @@ FMeshDescription UMapGenFunctionLibrary::BuildMeshDescriptionFromData(
   const TArray<FProcMeshTangent>& ParamTangents,
   UMaterialInstance* MaterialInstance  )
 {
+  const int32 NumVertex = Data.Vertices.Num();
+  const int32 NumIndices = Data.Triangles.Num();
+  const int32 NumTri = NumIndices / 3;
 
-  int32 VertexCount = Data.Vertices.Num();
-  int32 VertexInstanceCount = Data.Triangles.Num();
-  int32 PolygonCount = Data.Vertices.Num()/3;
-
-	FMeshDescription MeshDescription;
+  FMeshDescription MeshDescription;
   FStaticMeshAttributes AttributeGetter(MeshDescription);
   AttributeGetter.Register();
 
@@ -57,95 +57,87 @@ FMeshDescription UMapGenFunctionLibrary::BuildMeshDescriptionFromData(
   auto Colors = AttributeGetter.GetVertexInstanceColors();
   auto UVs = AttributeGetter.GetVertexInstanceUVs();
 
-  // Calculate the totals for each ProcMesh element type
-  FPolygonGroupID PolygonGroupForSection;
-  MeshDescription.ReserveNewVertices(VertexCount);
-  MeshDescription.ReserveNewVertexInstances(VertexInstanceCount);
-  MeshDescription.ReserveNewPolygons(PolygonCount);
-  MeshDescription.ReserveNewEdges(PolygonCount * 2);
+  MeshDescription.ReserveNewVertices(NumVertex);
+  MeshDescription.ReserveNewVertexInstances(NumIndices);
+  MeshDescription.ReserveNewPolygons(NumTri);
+#if ENGINE_MAJOR_VERSION > 4
+  MeshDescription.ReserveNewTriangles(NumTri);
+#endif
+  // Every inner edge is shared by two triangles
+  MeshDescription.ReserveNewEdges(NumTri * 3 / 2 + NumTri / 8);
   UVs.SetNumIndices(4);
 
   // Create Materials
-  TMap<UMaterialInterface*, FPolygonGroupID> UniqueMaterials;
-	const int32 NumSections = 1;
-	UniqueMaterials.Reserve(1);
   FPolygonGroupID NewPolygonGroup = MeshDescription.CreatePolygonGroup();
-
   if( MaterialInstance != nullptr ){
-    UMaterialInterface *Material = MaterialInstance;
-    UniqueMaterials.Add(Material, NewPolygonGroup);
-    PolygonGroupNames[NewPolygonGroup] = Material->GetFName();
+    PolygonGroupNames[NewPolygonGroup] = MaterialInstance->GetFName();
   }else{
     UE_LOG(LogCarlaMapGenFunctionLibrary, Error, TEXT("MaterialInstance is nullptr"));
   }
-  PolygonGroupForSection = NewPolygonGroup;
-
-
 
-  // Create the vertex
-  int32 NumVertex = Data.Vertices.Num();
-  TMap<int32, FVertexID> VertexIndexToVertexID;
-  VertexIndexToVertexID.Reserve(NumVertex);
+  // The elements of a new description get contiguous IDs, so vertex i of the
+  // data is FVertexID(i) and index i of the triangles FVertexInstanceID(i)
   for (int32 VertexIndex = 0; VertexIndex < NumVertex; ++VertexIndex)
   {
-    auto& Vert = Data.Vertices[VertexIndex];
-    const FVertexID VertexID = MeshDescription.CreateVertex();
-    VertexPositions[VertexID] = V3(Vert);
-    VertexIndexToVertexID.Add(VertexIndex, VertexID);
+    MeshDescription.CreateVertex();
+  }
+  for (int32 IndiceIndex = 0; IndiceIndex < NumIndices; ++IndiceIndex)
+  {
+    MeshDescription.CreateVertexInstance(FVertexID(Data.Triangles[IndiceIndex]));
   }
 
-  // Create the VertexInstance
-  int32 NumIndices = Data.Triangles.Num();
-  int32 NumTri = NumIndices / 3;
-  TMap<int32, FVertexInstanceID> IndiceIndexToVertexInstanceID;
-  IndiceIndexToVertexInstanceID.Reserve(NumVertex);
-  for (int32 IndiceIndex = 0; IndiceIndex < NumIndices; IndiceIndex++)
+  // The attributes of different elements can be written concurrently
+  const bool bHasNormals = Data.Normals.Num() == NumVertex;
+  const bool bHasTangents = ParamTangents.Num() == NumVertex;
+  const bool bHasUVs = Data.UV0.Num() == NumVertex;
+  constexpr int32 ChunkSize = 4096;
+  ParallelFor(FMath::DivideAndRoundUp(FMath::Max(NumVertex, NumIndices), ChunkSize), [&](int32 Chunk)
   {
-    const int32 VertexIndex = Data.Triangles[IndiceIndex];
-    const FVertexID VertexID = VertexIndexToVertexID[VertexIndex];
-    const FVertexInstanceID VertexInstanceID =
-    MeshDescription.CreateVertexInstance(VertexID);
-    IndiceIndexToVertexInstanceID.Add(IndiceIndex, VertexInstanceID);
-    Normals[VertexInstanceID] = V3(Data.Normals[VertexIndex]);
-
-    if(ParamTangents.Num() == Data.Vertices.Num())
+    const int32 First = Chunk * ChunkSize;
+    for (int32 VertexIndex = First; VertexIndex < FMath::Min(First + ChunkSize, NumVertex); ++VertexIndex)
     {
-      Tangents[VertexInstanceID] = V3(ParamTangents[VertexIndex].TangentX);
-      BinormalSigns[VertexInstanceID] =
-        ParamTangents[VertexIndex].bFlipTangentY ? -1.f : 1.f;
-    }else{
-
+      VertexPositions[FVertexID(VertexIndex)] = V3(Data.Vertices[VertexIndex]);
     }
-    Colors[VertexInstanceID] = FLinearColor(0,0,0);
-    if(Data.UV0.Num() == Data.Vertices.Num())
+    for (int32 IndiceIndex = First; IndiceIndex < FMath::Min(First + ChunkSize, NumIndices); ++IndiceIndex)
     {
-      UVs.Set(VertexInstanceID, 0, V2(Data.UV0[VertexIndex]));
-    }else{
-      UVs.Set(VertexInstanceID, 0, V2(0,0));
+      const int32 VertexIndex = Data.Triangles[IndiceIndex];
+      const FVertexInstanceID VertexInstanceID(IndiceIndex);
+      if (bHasNormals)
+      {
+        Normals[VertexInstanceID] = V3(Data.Normals[VertexIndex]);
+      }
+      if (bHasTangents)
+      {
+        Tangents[VertexInstanceID] = V3(ParamTangents[VertexIndex].TangentX);
+        BinormalSigns[VertexInstanceID] =
+          ParamTangents[VertexIndex].bFlipTangentY ? -1.f : 1.f;
+      }
+      Colors[VertexInstanceID] = FLinearColor(0,0,0);
+      UVs.Set(VertexInstanceID, 0, bHasUVs ? V2(Data.UV0[VertexIndex]) : V2(0,0));
+      UVs.Set(VertexInstanceID, 1, V2(0,0));
+      UVs.Set(VertexInstanceID, 2, V2(0,0));
+      UVs.Set(VertexInstanceID, 3, V2(0,0));
     }
-    UVs.Set(VertexInstanceID, 1, V2(0,0));
-    UVs.Set(VertexInstanceID, 2, V2(0,0));
-    UVs.Set(VertexInstanceID, 3, V2(0,0));
-  }
+  });
 
+  // Polygons create the edges, which is not thread safe
+#if ENGINE_MAJOR_VERSION > 4
+  FVertexInstanceID VertexInstanceIDs[3];
+#else
+  TArray<FVertexInstanceID> VertexInstanceIDs;
+  VertexInstanceIDs.SetNum(3);
+#endif
   for (int32 TriIdx = 0; TriIdx < NumTri; TriIdx++)
   {
-    FVertexID VertexIndexes[3];
-    TArray<FVertexInstanceID> VertexInstanceIDs;
-    VertexInstanceIDs.SetNum(3);
-
     for (int32 CornerIndex = 0; CornerIndex < 3; ++CornerIndex)
     {
-      const int32 IndiceIndex = (TriIdx * 3) + CornerIndex;
-      const int32 VertexIndex = Data.Triangles[IndiceIndex];
-      VertexIndexes[CornerIndex] = VertexIndexToVertexID[VertexIndex];
-      VertexInstanceIDs[CornerIndex] =
-        IndiceIndexToVertexInstanceID[IndiceIndex];
+      VertexInstanceIDs[CornerIndex] = FVertexInstanceID(TriIdx * 3 + CornerIndex);
     }
-
-    // Insert a polygon into the mesh
+#if ENGINE_MAJOR_VERSION > 4
+    MeshDescription.CreateTriangle(NewPolygonGroup, VertexInstanceIDs);
+#else
     MeshDescription.CreatePolygon(NewPolygonGroup, VertexInstanceIDs);
-
+#endif
   }
 
   return MeshDescription;
@@ -159,33 +151,60 @@ UStaticMesh* UMapGenFunctionLibrary::CreateMesh(
     FString FolderName,
     FName MeshName)
 {
-  IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+  TArray<FMapGenMeshRequest> Requests;
+  FMapGenMeshRequest& Request = Requests.AddDefaulted_GetRef();
+  Request.Data = Data;
+  Request.Tangents = ParamTangents;
+  Request.MaterialInstance = MaterialInstance;
+  Request.FolderName = MoveTemp(FolderName);
+  Request.MeshName = MeshName;
+  return CreateMeshes(Requests, MapName)[0];
+}
+
+TArray<UStaticMesh*> UMapGenFunctionLibrary::CreateMeshes(
+    const TArray<FMapGenMeshRequest>& Requests,
+    const FString& MapName)
+{
+  // The descriptions are plain data, only the assets need the game thread
+  const double DescriptionStart = FPlatformTime::Seconds();
+  TArray<FMeshDescription> Descriptions;
+  Descriptions.SetNum(Requests.Num());
+  ParallelFor(Requests.Num(), [&](int32 i)
+  {
+    const FMapGenMeshRequest& Request = Requests[i];
+    Descriptions[i] = BuildMeshDescriptionFromData(Request.Data, Request.Tangents, Request.MaterialInstance);
+  });
+  UE_LOG(LogCarlaMapGenFunctionLibrary, Log, TEXT("%d mesh descriptions built in %f seconds."),
+      Requests.Num(), FPlatformTime::Seconds() - DescriptionStart);
 
   UStaticMesh::FBuildMeshDescriptionsParams Params;
   Params.bBuildSimpleCollision = false;
 
-  FString PackageName = UGenerationPathsHelper::GetMapContentDirectoryPath(MapName) + FolderName + "/" + MeshName.ToString();
-
-  if (!PlatformFile.DirectoryExists(*PackageName))
+  TArray<UStaticMesh*> Meshes;
+  Meshes.Init(nullptr, Requests.Num());
+  TArray<UStaticMesh*> MeshesToBuild;
+  MeshesToBuild.Reserve(Requests.Num());
+  for (int32 i = 0; i < Requests.Num(); ++i)
   {
-    //PlatformFile.CreateDirectory(*PackageName);
-  }
-
-
-  FMeshDescription Description = BuildMeshDescriptionFromData(Data,ParamTangents, MaterialInstance);
+    const FMapGenMeshRequest& Request = Requests[i];
+    FMeshDescription& Description = Descriptions[i];
+    if (Description.Polygons().Num() == 0)
+    {
+      continue;
+    }
 
-  if (Description.Polygons().Num() > 0)
-  {
+    FString PackageName = UGenerationPathsHelper::GetMapContentDirectoryPath(MapName) + Request.FolderName + "/" + Request.MeshName.ToString();
     UPackage* Package = CreatePackage(*PackageName);
     check(Package);
-    UStaticMesh* Mesh = NewObject<UStaticMesh>( Package, MeshName, RF_Public | RF_Standalone);
+    UStaticMesh* Mesh = NewObject<UStaticMesh>( Package, Request.MeshName, RF_Public | RF_Standalone);
 
     Mesh->InitResources();
 
     Mesh->SetLightingGuid(FGuid::NewGuid());
-    Mesh->GetStaticMaterials().Add(FStaticMaterial(MaterialInstance));
+    Mesh->GetStaticMaterials().Add(FStaticMaterial(Request.MaterialInstance));
     Mesh->NaniteSettings.bEnabled = true;
     Mesh->BuildFromMeshDescriptions({ &Description }, Params);
+    Description.Empty();
     // Ensure Mesh has a BodySetup
     Mesh->CreateBodySetup();
     UBodySetup* BodySetup = Mesh->GetBodySetup();
@@ -196,27 +215,32 @@ UStaticMesh* UMapGenFunctionLibrary::CreateMesh(
         BodySetup->InvalidatePhysicsData();
         BodySetup->ClearPhysicsMeshes();
     }
-    // Build mesh from source
     Mesh->NeverStream = false;
-    TArray<UObject*> CreatedAssets;
-    CreatedAssets.Add(Mesh);
 
     // Notify asset registry of new asset
     FAssetRegistryModule::AssetCreated(Mesh);
-    //UPackage::SavePackage(Package, Mesh, EObjectFlags::RF_Public | EObjectFlags::RF_Standalone, *(MeshName.ToString()), GError, nullptr, true, true, SAVE_NoError);
+    Meshes[i] = Mesh;
+    MeshesToBuild.Add(Mesh);
+  }
+
+  // Build mesh from source, all of them at once
 #if ENGINE_MAJOR_VERSION > 4
-    TArray<UStaticMesh*> MeshToEnableNanite;
-    MeshToEnableNanite.Add(Mesh);
-    UStaticMesh::BatchBuild(MeshToEnableNanite);
+  UStaticMesh::BatchBuild(MeshesToBuild);
+#else
+  for (UStaticMesh* Mesh : MeshesToBuild)
+  {
+    Mesh->Build(false);
+  }
 #endif
-    // Finalize mesh
-    Mesh->Build(false); // Rebuilds mesh data, optionally pass true to mark as async
-    Mesh->PostEditChange(); 
-    Package->MarkPackageDirty();
+
+  // Finalize meshes
+  for (UStaticMesh* Mesh : MeshesToBuild)
+  {
+    Mesh->PostEditChange();
+    Mesh->GetOutermost()->MarkPackageDirty();
     Mesh->ComplexCollisionMesh = Mesh;
-    return Mesh;
   }
-  return nullptr;
+  return Meshes;
 }
 
 // Transverse Mercator projection, see e.g. https://proj.org/en/stable/operations/projections/tmerc.html
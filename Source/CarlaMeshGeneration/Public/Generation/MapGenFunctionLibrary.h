@@ -21,6 +21,16 @@
 
 DECLARE_LOG_CATEGORY_EXTERN(LogCarlaMapGenFunctionLibrary, Log, All);
 
+/// One static mesh to create with UMapGenFunctionLibrary::CreateMeshes.
+struct CARLAMESHGENERATION_API FMapGenMeshRequest
+{
+  FProceduralCustomMesh Data;
+  TArray<FProcMeshTangent> Tangents;
+  UMaterialInstance* MaterialInstance = nullptr;
+  FString FolderName;
+  FName MeshName;
+};
+
 UCLASS(BlueprintType)
 class CARLAMESHGENERATION_API UMapGenFunctionLibrary : public UBlueprintFunctionLibrary
 {
@@ -35,6 +45,13 @@ public:
       FString FolderName,
       FName MeshName);
 
+  /// Creates the static mesh of every request, building their mesh
+  /// descriptions in parallel and all of them with a single BatchBuild. The
+  /// result has an entry per request, nullptr where the mesh has no polygons.
+  static TArray<UStaticMesh*> CreateMeshes(
+      const TArray<FMapGenMeshRequest>& Requests,
+      const FString& MapName);
+
   static FMeshDescription BuildMeshDescriptionFromData(
       const FProceduralCustomMesh& Data,
       const TArray<FProcMeshTangent>& ParamTangents,
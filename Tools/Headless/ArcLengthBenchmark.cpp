@@ -0,0 +1,242 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Compares the arc length tables of GeometryParamPoly3 with the 1-D segment
+/// R-tree it used before, on every paramPoly3 geometry of an OpenDRIVE map.
+///
+/// Builds both structures for each geometry, evaluates PosFromDist at evenly
+/// spaced distances along it with each one and prints the time per build and
+/// per evaluation, and how far apart the two results are.
+///
+/// Usage: arc-length-benchmark <map.xodr> [evaluations per geometry]
+
+#include "Carla/Geom/Rtree.h"
+#include "Carla/Road/element/Geometry.h"
+#include "Carla/StopWatch.h"
+#include "Carla/pugixml/pugixml.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+  using carla::road::element::DirectedPoint;
+  using carla::road::element::GeometryParamPoly3;
+
+  struct ParamPoly3 {
+    double length;
+    double hdg;
+    carla::geom::Location start;
+    double aU, bU, cU, dU;
+    double aV, bV, cV, dV;
+    bool arc_length;
+  };
+
+  /// The paramPoly3 lookup as it was before the arc length tables: chord
+  /// lengths between samples inserted into a segment R-tree and a nearest
+  /// neighbour query per evaluation.
+  class RtreeParamPoly3 {
+  public:
+
+    explicit RtreeParamPoly3(const ParamPoly3 &geometry)
+      : _geometry(geometry) {
+      _poly_u.Set(geometry.aU, geometry.bU, geometry.cU, geometry.dU);
+      _poly_v.Set(geometry.aV, geometry.bV, geometry.cV, geometry.dV);
+      constexpr double interval_size = 0.5;
+      const size_t number_intervals =
+          std::max(static_cast<size_t>(geometry.length / interval_size), size_t(5));
+      double delta_p = 1.0 / number_intervals;
+      if (geometry.arc_length) {
+        delta_p *= geometry.length;
+      }
+      double param_p = 0;
+      double current_s = 0;
+      double last_u = _poly_u.Evaluate(param_p);
+      double last_v = _poly_v.Evaluate(param_p);
+      double last_s = 0;
+      Value last_val{last_u, last_v, last_s, _poly_u.Tangent(param_p), _poly_v.Tangent(param_p)};
+      for (size_t i = 0; i < number_intervals; ++i) {
+        param_p += delta_p;
+        const double current_u = _poly_u.Evaluate(param_p);
+        const double current_v = _poly_v.Evaluate(param_p);
+        const double du = current_u - last_u;
+        const double dv = current_v - last_v;
+        current_s += std::sqrt(du * du + dv * dv);
+        Value current_val{
+            current_u, current_v, current_s, _poly_u.Tangent(param_p), _poly_v.Tangent(param_p)};
+        _rtree.InsertElement(
+            Rtree::BSegment(
+                Rtree::BPoint(static_cast<float>(last_s)),
+                Rtree::BPoint(static_cast<float>(current_s))),
+            last_val,
+            current_val);
+        last_u = current_u;
+        last_v = current_v;
+        last_s = current_s;
+        last_val = current_val;
+        if (current_s > geometry.length) {
+          break;
+        }
+      }
+    }
+
+    DirectedPoint PosFromDist(double dist) const {
+      auto result = _rtree.GetNearestNeighbours(Rtree::BPoint(static_cast<float>(dist))).front();
+      auto &val1 = result.second.first;
+      auto &val2 = result.second.second;
+      const double rate = (val2.s - dist) / (val2.s - val1.s);
+      const double u = rate * val1.u + (1.0 - rate) * val2.u;
+      const double v = rate * val1.v + (1.0 - rate) * val2.v;
+      const double t_u = rate * val1.t_u + (1.0 - rate) * val2.t_u;
+      const double t_v = rate * val1.t_v + (1.0 - rate) * val2.t_v;
+      const double cos_a = std::cos(_geometry.hdg);
+      const double sin_a = std::sin(_geometry.hdg);
+      DirectedPoint p(_geometry.start, _geometry.hdg + std::atan2(t_v, t_u));
+      p.location.x += static_cast<float>(u * cos_a - v * sin_a);
+      p.location.y += static_cast<float>(v * cos_a + u * sin_a);
+      return p;
+    }
+
+  private:
+
+    struct Value {
+      double u = 0;
+      double v = 0;
+      double s = 0;
+      double t_u = 0;
+      double t_v = 0;
+    };
+
+    using Rtree = carla::geom::SegmentCloudRtree<Value, 1>;
+
+    ParamPoly3 _geometry;
+
+    carla::geom::CubicPolynomial _poly_u;
+
+    carla::geom::CubicPolynomial _poly_v;
+
+    Rtree _rtree;
+  };
+
+  std::vector<ParamPoly3> ReadParamPoly3(const char *path) {
+    std::vector<ParamPoly3> geometries;
+    pugi::xml_document xml;
+    if (!xml.load_file(path)) {
+      return geometries;
+    }
+    for (auto road : xml.child("OpenDRIVE").children("road")) {
+      for (auto node : road.child("planView").children("geometry")) {
+        auto poly = node.child("paramPoly3");
+        if (!poly) {
+          continue;
+        }
+        ParamPoly3 geometry;
+        geometry.length = node.attribute("length").as_double();
+        geometry.hdg = node.attribute("hdg").as_double();
+        geometry.start = carla::geom::Location(
+            node.attribute("x").as_float(), node.attribute("y").as_float(), 0.0f);
+        geometry.aU = poly.attribute("aU").as_double();
+        geometry.bU = poly.attribute("bU").as_double();
+        geometry.cU = poly.attribute("cU").as_double();
+        geometry.dU = poly.attribute("dU").as_double();
+        geometry.aV = poly.attribute("aV").as_double();
+        geometry.bV = poly.attribute("bV").as_double();
+        geometry.cV = poly.attribute("cV").as_double();
+        geometry.dV = poly.attribute("dV").as_double();
+        geometry.arc_length = std::string(poly.attribute("pRange").as_string("arcLength")) == "arcLength";
+        geometries.push_back(geometry);
+      }
+    }
+    return geometries;
+  }
+
+  template <typename Geometry>
+  double EvaluateAll(
+      const std::vector<std::unique_ptr<Geometry>> &geometries,
+      const std::vector<ParamPoly3> &descriptions,
+      size_t evaluations,
+      std::vector<DirectedPoint> &out) {
+    out.clear();
+    out.reserve(geometries.size() * evaluations);
+    carla::StopWatch stop_watch;
+    for (size_t i = 0u; i < geometries.size(); ++i) {
+      const double step = descriptions[i].length / static_cast<double>(evaluations);
+      for (size_t k = 0u; k < evaluations; ++k) {
+        out.push_back(geometries[i]->PosFromDist(static_cast<double>(k) * step));
+      }
+    }
+    stop_watch.Stop();
+    return static_cast<double>(stop_watch.GetElapsedTime<std::chrono::nanoseconds>());
+  }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <map.xodr> [evaluations per geometry]\n";
+    return 1;
+  }
+  const size_t evaluations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 1000u;
+  const auto descriptions = ReadParamPoly3(argv[1]);
+  if (descriptions.empty()) {
+    std::cerr << "No paramPoly3 geometry in " << argv[1] << "\n";
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<RtreeParamPoly3>> rtree_geometries;
+  carla::StopWatch rtree_build;
+  for (const auto &geometry : descriptions) {
+    rtree_geometries.push_back(std::make_unique<RtreeParamPoly3>(geometry));
+  }
+  rtree_build.Stop();
+
+  std::vector<std::unique_ptr<GeometryParamPoly3>> table_geometries;
+  carla::StopWatch table_build;
+  for (const auto &geometry : descriptions) {
+    table_geometries.push_back(std::make_unique<GeometryParamPoly3>(
+        0.0, geometry.length, geometry.hdg, geometry.start,
+        geometry.aU, geometry.bU, geometry.cU, geometry.dU,
+        geometry.aV, geometry.bV, geometry.cV, geometry.dV,
+        geometry.arc_length));
+  }
+  table_build.Stop();
+
+  std::vector<DirectedPoint> rtree_points;
+  std::vector<DirectedPoint> table_points;
+  const double rtree_time = EvaluateAll(rtree_geometries, descriptions, evaluations, rtree_points);
+  const double table_time = EvaluateAll(table_geometries, descriptions, evaluations, table_points);
+
+  double max_distance = 0.0;
+  for (size_t i = 0u; i < rtree_points.size(); ++i) {
+    max_distance = std::max(
+        max_distance,
+        static_cast<double>(rtree_points[i].location.Distance(table_points[i].location)));
+  }
+
+  const double count = static_cast<double>(rtree_points.size());
+  const double geometry_count = static_cast<double>(descriptions.size());
+  std::cout << descriptions.size() << " paramPoly3 geometries, " << evaluations
+            << " evaluations each\n\n"
+            << std::left << std::setw(12) << "" << std::right
+            << std::setw(16) << "build (us/geo)" << std::setw(16) << "eval (ns)" << "\n"
+            << std::fixed << std::setprecision(2)
+            << std::left << std::setw(12) << "r-tree" << std::right
+            << std::setw(16) << rtree_build.GetElapsedTime<std::chrono::microseconds>() / geometry_count
+            << std::setw(16) << rtree_time / count << "\n"
+            << std::left << std::setw(12) << "table" << std::right
+            << std::setw(16) << table_build.GetElapsedTime<std::chrono::microseconds>() / geometry_count
+            << std::setw(16) << table_time / count << "\n\n"
+            << "speedup " << rtree_time / table_time << "x, largest difference "
+            << std::setprecision(4) << max_distance << " m\n";
+  return 0;
+}
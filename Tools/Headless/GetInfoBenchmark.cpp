@@ -0,0 +1,140 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Compares InformationSet::GetInfo<T>, which binary searches the infos of
+/// type T, with the lookup it replaced, which walked back from s over the
+/// infos of every type visiting each one until it found a T.
+///
+/// Builds road info sets of 32 and 2048 records, a quarter of them lane
+/// widths (dense type) and a single speed record (sparse type), and prints
+/// the latency of each lookup at random distances. Fails if both lookups
+/// return different records.
+///
+/// Usage: getinfo-benchmark [lookups]
+
+#include "Carla/Road/InformationSet.h"
+#include "Carla/Road/element/RoadInfoElevation.h"
+#include "Carla/Road/element/RoadInfoLaneHeight.h"
+#include "Carla/Road/element/RoadInfoLaneOffset.h"
+#include "Carla/Road/element/RoadInfoLaneWidth.h"
+#include "Carla/Road/element/RoadInfoSpeed.h"
+#include "Carla/StopWatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+  using namespace carla::road;
+  using namespace carla::road::element;
+
+  /// @a count infos one meter apart, cycling over four types, with a single
+  /// speed record at the start.
+  std::vector<std::unique_ptr<RoadInfo>> MakeInfos(size_t count) {
+    std::vector<std::unique_ptr<RoadInfo>> infos;
+    infos.reserve(count);
+    infos.emplace_back(std::make_unique<RoadInfoSpeed>(0.0, 13.9));
+    for (size_t i = 1u; i < count; ++i) {
+      const double s = static_cast<double>(i);
+      switch (i % 4u) {
+        case 0u: infos.emplace_back(std::make_unique<RoadInfoLaneWidth>(s, 3.5, 0.0, 0.0, 0.0)); break;
+        case 1u: infos.emplace_back(std::make_unique<RoadInfoLaneOffset>(s, 0.0, 0.0, 0.0, 0.0)); break;
+        case 2u: infos.emplace_back(std::make_unique<RoadInfoElevation>(s, 0.0, 0.0, 0.0, 0.0)); break;
+        default: infos.emplace_back(std::make_unique<RoadInfoLaneHeight>(s, 0.0, 0.0)); break;
+      }
+    }
+    return infos;
+  }
+
+  /// The lookup of InformationSet before the type index.
+  template <typename T>
+  const T *GetInfoByVisiting(const RoadElementSet<std::unique_ptr<RoadInfo>> &set, double s) {
+    auto it = MakeRoadInfoIterator<T>(set.GetReverseSubset(s));
+    return it.IsAtEnd() ? nullptr : &*it;
+  }
+
+  struct Result {
+    double indexed_ns;
+    double visiting_ns;
+    bool same;
+  };
+
+  template <typename T>
+  Result Run(size_t count, const std::vector<double> &distances) {
+    const InformationSet indexed(MakeInfos(count));
+    const RoadElementSet<std::unique_ptr<RoadInfo>> visiting(MakeInfos(count));
+
+    // Compare the distances of the records, the records themselves are
+    // different objects in each set
+    double indexed_sum = 0.0;
+    carla::StopWatch indexed_time;
+    for (const double s : distances) {
+      const T *info = indexed.GetInfo<T>(s);
+      indexed_sum += info != nullptr ? info->GetDistance() : -1.0;
+    }
+    indexed_time.Stop();
+
+    double visiting_sum = 0.0;
+    carla::StopWatch visiting_time;
+    for (const double s : distances) {
+      const T *info = GetInfoByVisiting<T>(visiting, s);
+      visiting_sum += info != nullptr ? info->GetDistance() : -1.0;
+    }
+    visiting_time.Stop();
+
+    const double lookups = static_cast<double>(distances.size());
+    return {
+        static_cast<double>(indexed_time.GetElapsedTime<std::chrono::nanoseconds>()) / lookups,
+        static_cast<double>(visiting_time.GetElapsedTime<std::chrono::nanoseconds>()) / lookups,
+        indexed_sum == visiting_sum};
+  }
+
+  void Print(const char *name, size_t count, const Result &result) {
+    std::cout << std::left << std::setw(16) << name << std::right
+              << std::setw(8) << count
+              << std::setw(14) << result.indexed_ns
+              << std::setw(14) << result.visiting_ns << "\n";
+  }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const size_t lookup_count = argc > 1 ? std::max(1, std::atoi(argv[1])) : 1000000u;
+
+  std::cout << lookup_count << " lookups\n\n"
+            << std::left << std::setw(16) << "type" << std::right
+            << std::setw(8) << "infos" << std::setw(14) << "index (ns)"
+            << std::setw(14) << "visit (ns)" << "\n"
+            << std::fixed << std::setprecision(2);
+
+  bool same = true;
+  for (const size_t count : {32u, 2048u}) {
+    std::mt19937 random_engine(42u);
+    std::uniform_real_distribution<double> random_s(0.0, static_cast<double>(count));
+    std::vector<double> distances(lookup_count);
+    for (auto &s : distances) {
+      s = random_s(random_engine);
+    }
+
+    const Result dense = Run<RoadInfoLaneWidth>(count, distances);
+    Print("lane width", count, dense);
+    const Result sparse = Run<RoadInfoSpeed>(count, distances);
+    Print("speed", count, sparse);
+    same = same && dense.same && sparse.same;
+  }
+
+  if (!same) {
+    std::cerr << "The indexed and the visiting lookups returned different infos\n";
+    return 1;
+  }
+  return 0;
+}
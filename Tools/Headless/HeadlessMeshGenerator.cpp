@@ -0,0 +1,439 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Runs the road mesh generation of the plugin without Unreal Engine.
+///
+/// Loads an OpenDRIVE file, generates the road meshes, the lane markings and
+/// the tree positions of a tile, the same way UOpenDriveToMap does, writes
+/// the results to a directory and prints how long each stage took and how
+/// many heap allocations the road mesh generation made.
+
+#include "Carla/Geom/Mesh.h"
+#include "Carla/OpenDrive/OpenDriveParser.h"
+#include "Carla/RPC/OpendriveGenerationParameters.h"
+#include "Carla/Road/RoadMap.h"
+#include "Carla/StopWatch.h"
+#include "Carla/pugixml/pugixml.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+  /// Number of calls to the global operator new, from every thread.
+  std::atomic<size_t> allocation_count{0u};
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  allocation_count.fetch_add(1u, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size == 0u ? 1u : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+  return ::operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+  struct Options {
+    std::string xodr_path;
+    std::string output_dir;
+    /// Format of the written meshes: obj, ply or glb.
+    std::string format = "obj";
+    // Same convention as UOpenDriveToMap, the y of min_pos is above the y of
+    // max_pos. The default box covers the whole map.
+    carla::geom::Vector3D min_pos{-1e6f, 1e6f, -1e6f};
+    carla::geom::Vector3D max_pos{1e6f, -1e6f, 1e6f};
+    double vertex_distance = 0.5;
+    double vertex_width_resolution = 8.0;
+    float road_simplification = 0.0f;
+    float lane_mark_simplification = 15.0f;
+    float distance_between_trees = 50.0f;
+    float distance_from_road_edge = 3.0f;
+    int repeat = 1;
+    /// Generate the lane marks merged in a batch per material, as the
+    /// editor does, instead of a mesh per lane section.
+    bool batch_lane_marks = false;
+    /// Fail if the road mesh generation allocates more than this, on
+    /// average, per road of the map. Zero disables the check.
+    size_t max_allocations_per_road = 0u;
+  };
+
+  void PrintUsage(const char *program) {
+    std::cerr
+        << "Usage: " << program << " <map.xodr> [options]\n"
+        << "  --output <dir>              write the meshes and trees (.csv) to <dir>\n"
+        << "  --format <obj|ply|glb>      format of the written meshes, default obj\n"
+        << "  --tile <x> <y> <size>       generate the tile (x, y) of <size> meters, as GenerateTile\n"
+        << "  --min <x> <y> <z>           corner of the tile, in meters (as UOpenDriveToMap, y of\n"
+        << "  --max <x> <y> <z>           min is above y of max)\n"
+        << "  --vertex-distance <m>       default 0.5\n"
+        << "  --vertex-width <n>          vertices across each lane, default 8\n"
+        << "  --simplification <percent>  road mesh simplification, default 0\n"
+        << "  --repeat <n>                run the generation stages n times, default 1\n"
+        << "  --batch-lane-marks          merge the lane marks in a mesh per material and write\n"
+        << "                              the dashes as instances (LaneMarkDashes.csv)\n"
+        << "  --max-allocations-per-road <n>\n"
+        << "                              fail if generating the road meshes allocates more\n"
+        << "                              than n times per road, on average\n";
+  }
+
+  bool ParseOptions(int argc, char *argv[], Options &options) {
+    if (argc < 2) {
+      return false;
+    }
+    options.xodr_path = argv[1];
+    for (int i = 2; i < argc; ++i) {
+      const auto has = [&](int count) { return i + count < argc; };
+      const auto arg = [&]() { return static_cast<float>(std::atof(argv[++i])); };
+      if (std::strcmp(argv[i], "--output") == 0 && has(1)) {
+        options.output_dir = argv[++i];
+      } else if (std::strcmp(argv[i], "--format") == 0 && has(1)) {
+        options.format = argv[++i];
+        if (options.format != "obj" && options.format != "ply" && options.format != "glb") {
+          std::cerr << "Unknown mesh format " << options.format << "\n";
+          return false;
+        }
+      } else if (std::strcmp(argv[i], "--tile") == 0 && has(3)) {
+        const float x = arg();
+        const float y = arg();
+        const float size = arg();
+        options.min_pos = carla::geom::Vector3D(x * size, y * -size, 0.0f);
+        options.max_pos = carla::geom::Vector3D((x + 1.0f) * size, (y + 1.0f) * -size, 0.0f);
+      } else if (std::strcmp(argv[i], "--min") == 0 && has(3)) {
+        options.min_pos.x = arg();
+        options.min_pos.y = arg();
+        options.min_pos.z = arg();
+      } else if (std::strcmp(argv[i], "--max") == 0 && has(3)) {
+        options.max_pos.x = arg();
+        options.max_pos.y = arg();
+        options.max_pos.z = arg();
+      } else if (std::strcmp(argv[i], "--vertex-distance") == 0 && has(1)) {
+        options.vertex_distance = arg();
+      } else if (std::strcmp(argv[i], "--vertex-width") == 0 && has(1)) {
+        options.vertex_width_resolution = arg();
+      } else if (std::strcmp(argv[i], "--simplification") == 0 && has(1)) {
+        options.road_simplification = arg();
+      } else if (std::strcmp(argv[i], "--repeat") == 0 && has(1)) {
+        options.repeat = std::max(1, std::atoi(argv[++i]));
+      } else if (std::strcmp(argv[i], "--batch-lane-marks") == 0) {
+        options.batch_lane_marks = true;
+      } else if (std::strcmp(argv[i], "--max-allocations-per-road") == 0 && has(1)) {
+        options.max_allocations_per_road = std::strtoull(argv[++i], nullptr, 10);
+      } else {
+        std::cerr << "Unknown or incomplete option " << argv[i] << "\n";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const char *LaneTypeName(carla::road::Lane::LaneType type) {
+    using LaneType = carla::road::Lane::LaneType;
+    switch (type) {
+      case LaneType::None:          return "None";
+      case LaneType::Driving:       return "Driving";
+      case LaneType::Stop:          return "Stop";
+      case LaneType::Shoulder:      return "Shoulder";
+      case LaneType::Biking:        return "Biking";
+      case LaneType::Sidewalk:      return "Sidewalk";
+      case LaneType::Border:        return "Border";
+      case LaneType::Restricted:    return "Restricted";
+      case LaneType::Parking:       return "Parking";
+      case LaneType::Bidirectional: return "Bidirectional";
+      case LaneType::Median:        return "Median";
+      default:                      return "Other";
+    }
+  }
+
+  size_t CountRoads(const std::string &opendrive) {
+    pugi::xml_document xml;
+    if (!xml.load_string(opendrive.c_str())) {
+      return 0u;
+    }
+    const auto roads = xml.child("OpenDRIVE").children("road");
+    return static_cast<size_t>(std::distance(roads.begin(), roads.end()));
+  }
+
+  bool WriteFile(const std::string &path, const std::string &content) {
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+    if (!file) {
+      std::cerr << "Cannot write " << path << "\n";
+      return false;
+    }
+    return true;
+  }
+
+  /// Writes @a mesh to @a path_without_extension in the given format, the
+  /// binary ones are streamed to the file.
+  bool WriteMesh(
+      const carla::geom::Mesh &mesh,
+      const std::string &path_without_extension,
+      const std::string &format) {
+    const std::string path = path_without_extension + "." + format;
+    bool written = true;
+    if (format == "ply") {
+      written = mesh.WritePLY(path);
+    } else if (format == "glb") {
+      written = mesh.WriteGLB(path);
+    } else {
+      return WriteFile(path, mesh.GenerateOBJ());
+    }
+    if (!written) {
+      std::cerr << "Cannot write " << path << "\n";
+    }
+    return written;
+  }
+
+  /// Accumulates the time of each stage to print them as a table.
+  class Timings {
+  public:
+
+    template <typename F>
+    auto Measure(const std::string &stage, F &&stage_function) {
+      carla::StopWatch stop_watch;
+      auto result = stage_function();
+      stop_watch.Stop();
+      Add(stage, stop_watch.GetElapsedTime<std::chrono::microseconds>());
+      return result;
+    }
+
+    void Print() const {
+      size_t total = 0u;
+      std::cout << "\n" << std::left << std::setw(24) << "stage" << std::right
+                << std::setw(14) << "time (ms)" << "\n";
+      for (const auto &stage : _stages) {
+        std::cout << std::left << std::setw(24) << stage.first << std::right
+                  << std::setw(14) << std::fixed << std::setprecision(3)
+                  << stage.second / 1e3 << "\n";
+        total += stage.second;
+      }
+      std::cout << std::left << std::setw(24) << "total" << std::right
+                << std::setw(14) << total / 1e3 << "\n";
+    }
+
+  private:
+
+    void Add(const std::string &stage, size_t microseconds) {
+      for (auto &entry : _stages) {
+        if (entry.first == stage) {
+          entry.second += microseconds;
+          return;
+        }
+      }
+      _stages.emplace_back(stage, microseconds);
+    }
+
+    std::vector<std::pair<std::string, size_t>> _stages;
+  };
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  Timings timings;
+
+  const std::string opendrive = timings.Measure("read xodr", [&]() {
+    std::ifstream file(options.xodr_path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+  });
+  if (opendrive.empty()) {
+    std::cerr << "Cannot read " << options.xodr_path << "\n";
+    return 1;
+  }
+
+  const auto map = timings.Measure("parse and build map", [&]() {
+    return carla::opendrive::OpenDriveParser::Load(opendrive);
+  });
+  if (!map) {
+    std::cerr << "Cannot parse " << options.xodr_path << "\n";
+    return 1;
+  }
+
+  carla::rpc::OpendriveGenerationParameters road_parameters;
+  road_parameters.vertex_distance = options.vertex_distance;
+  road_parameters.vertex_width_resolution = options.vertex_width_resolution;
+  road_parameters.simplification_percentage = options.road_simplification;
+
+  carla::rpc::OpendriveGenerationParameters lane_mark_parameters = road_parameters;
+  lane_mark_parameters.simplification_percentage = options.lane_mark_simplification;
+
+  std::map<carla::road::Lane::LaneType, std::vector<std::unique_ptr<carla::geom::Mesh>>> road_meshes;
+  std::vector<std::unique_ptr<carla::geom::Mesh>> lane_mark_meshes;
+  std::vector<std::string> lane_mark_info;
+  std::vector<carla::road::LaneMarkBatch> lane_mark_batches;
+  std::vector<std::pair<carla::geom::Transform, std::string>> trees;
+  size_t road_mesh_allocations = 0u;
+  for (int run = 0; run < options.repeat; ++run) {
+    road_meshes.clear();
+    const size_t allocations_before = allocation_count.load();
+    road_meshes = timings.Measure("road meshes", [&]() {
+      return map->GenerateOrderedChunkedMeshInLocations(
+          road_parameters, options.min_pos, options.max_pos);
+    });
+    road_mesh_allocations += allocation_count.load() - allocations_before;
+    if (options.batch_lane_marks) {
+      lane_mark_batches = timings.Measure("lane mark batches", [&]() {
+        return map->GenerateLaneMarkBatches(
+            lane_mark_parameters, options.min_pos, options.max_pos);
+      });
+    } else {
+      lane_mark_info.clear();
+      lane_mark_meshes = timings.Measure("lane markings", [&]() {
+        return map->GenerateLineMarkings(
+            lane_mark_parameters, options.min_pos, options.max_pos, lane_mark_info);
+      });
+    }
+    trees = timings.Measure("tree positions", [&]() {
+      return map->GetTreesTransform(
+          options.min_pos, options.max_pos,
+          options.distance_between_trees, options.distance_from_road_edge);
+    });
+  }
+
+  size_t road_mesh_count = 0u;
+  size_t vertex_count = 0u;
+  size_t index_count = 0u;
+  for (const auto &lane_type_meshes : road_meshes) {
+    for (const auto &mesh : lane_type_meshes.second) {
+      ++road_mesh_count;
+      vertex_count += mesh->GetVerticesNum();
+      index_count += mesh->GetIndexesNum();
+    }
+  }
+  for (const auto &mesh : lane_mark_meshes) {
+    vertex_count += mesh->GetVerticesNum();
+    index_count += mesh->GetIndexesNum();
+  }
+  size_t dash_count = 0u;
+  for (const auto &batch : lane_mark_batches) {
+    vertex_count += batch.mesh.GetVerticesNum();
+    index_count += batch.mesh.GetIndexesNum();
+    dash_count += batch.dashes.size();
+  }
+
+  bool written = true;
+  if (!options.output_dir.empty()) {
+    written = timings.Measure("write meshes", [&]() {
+      bool ok = true;
+      for (const auto &lane_type_meshes : road_meshes) {
+        size_t index = 0u;
+        for (const auto &mesh : lane_type_meshes.second) {
+          if (mesh->GetVerticesNum() != 0u && mesh->IsValid()) {
+            ok &= WriteMesh(
+                *mesh,
+                options.output_dir + "/Road_" + LaneTypeName(lane_type_meshes.first) +
+                    "_" + std::to_string(index++),
+                options.format);
+          }
+        }
+      }
+      for (size_t i = 0u; i < lane_mark_meshes.size(); ++i) {
+        if (lane_mark_meshes[i]->GetVerticesNum() != 0u && lane_mark_meshes[i]->IsValid()) {
+          const std::string info = i < lane_mark_info.size() ? lane_mark_info[i] : "none";
+          ok &= WriteMesh(
+              *lane_mark_meshes[i],
+              options.output_dir + "/LaneMark_" + std::to_string(i) + "_" + info,
+              options.format);
+        }
+      }
+      if (options.batch_lane_marks) {
+        std::ostringstream dashes;
+        dashes << "x,y,z,yaw,length,width,material\n";
+        for (const auto &batch : lane_mark_batches) {
+          if (batch.mesh.GetVerticesNum() != 0u && batch.mesh.IsValid()) {
+            ok &= WriteMesh(
+                batch.mesh, options.output_dir + "/LaneMarks_" + batch.material, options.format);
+          }
+          for (const auto &dash : batch.dashes) {
+            dashes << dash.location.x << "," << dash.location.y << "," << dash.location.z << ","
+                   << dash.yaw << "," << dash.length << "," << dash.width << ","
+                   << batch.material << "\n";
+          }
+        }
+        ok &= WriteFile(options.output_dir + "/LaneMarkDashes.csv", dashes.str());
+      }
+      std::ostringstream csv;
+      csv << "x,y,z,pitch,yaw,roll,type\n";
+      for (const auto &tree : trees) {
+        const auto &transform = tree.first;
+        csv << transform.location.x << "," << transform.location.y << "," << transform.location.z << ","
+            << transform.rotation.pitch << "," << transform.rotation.yaw << "," << transform.rotation.roll << ","
+            << tree.second << "\n";
+      }
+      ok &= WriteFile(options.output_dir + "/Trees.csv", csv.str());
+      return ok;
+    });
+  }
+
+  std::cout << "\n" << options.xodr_path << ": "
+            << road_mesh_count << " road meshes, "
+            << lane_mark_meshes.size() << " lane marking meshes, ";
+  if (options.batch_lane_marks) {
+    std::cout << lane_mark_batches.size() << " lane mark batches, "
+              << dash_count << " dashes, ";
+  }
+  std::cout << trees.size() << " trees, "
+            << vertex_count << " vertices, "
+            << index_count / 3u << " triangles\n";
+  const size_t road_count = std::max<size_t>(CountRoads(opendrive), 1u);
+  const size_t allocations_per_road =
+      road_mesh_allocations / static_cast<size_t>(options.repeat) / road_count;
+  std::cout << "road meshes: " << allocations_per_road << " allocations per road ("
+            << road_count << " roads in the map)\n";
+  if (options.repeat > 1) {
+    std::cout << "generation stages accumulated over " << options.repeat << " runs\n";
+  }
+  timings.Print();
+
+  if (options.max_allocations_per_road != 0u &&
+      allocations_per_road > options.max_allocations_per_road) {
+    std::cerr << "\nThe road meshes made " << allocations_per_road
+              << " allocations per road, more than the limit of "
+              << options.max_allocations_per_road << "\n";
+    return 1;
+  }
+  return written ? 0 : 1;
+}
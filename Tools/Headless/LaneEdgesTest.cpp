@@ -0,0 +1,91 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Checks the batched Lane::GetCornerPositions against the single sample one
+/// on every lane of an OpenDRIVE map.
+///
+/// The samples of each lane are built as MeshFactory builds them, adding
+/// the step to s, and the last lane section of each road gets two more past
+/// the end of the road: one by a float rounding error and one by a full
+/// step. Both versions have to clamp them to the road the same way.
+///
+/// Usage: lane-edges-test <map.xodr> [step]
+
+#include "Carla/Geom/Math.h"
+#include "Carla/OpenDrive/OpenDriveParser.h"
+#include "Carla/Road/RoadMap.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <map.xodr> [step]\n";
+    return 1;
+  }
+  const double step = argc > 2 ? std::atof(argv[2]) : 0.3;
+
+  std::ifstream file(argv[1], std::ios::binary);
+  const std::string opendrive(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  auto map = carla::opendrive::OpenDriveParser::Load(opendrive);
+  if (!map) {
+    std::cerr << "Could not load " << argv[1] << "\n";
+    return 1;
+  }
+
+  constexpr float tolerance = 1e-3f;
+  size_t lanes = 0u, samples = 0u, mismatches = 0u;
+  for (const auto &road_pair : map->GetMapData().GetRoads()) {
+    const auto &road = road_pair.second;
+    const double road_length = road.GetLength();
+    for (const auto &lane_section : road.GetLaneSections()) {
+      const double s_start = lane_section.GetDistance();
+      const double s_end = s_start + lane_section.GetLength();
+      std::vector<double> s_values;
+      float s_current = static_cast<float>(s_start);
+      while (s_current < s_end) {
+        s_values.emplace_back(s_current);
+        s_current += static_cast<float>(step);
+      }
+      if (std::abs(s_end - road_length) < 1e-6) {
+        s_values.emplace_back(std::nextafter(road_length, road_length + 1.0));
+        s_values.emplace_back(road_length + step);
+      }
+
+      for (const auto &lane_pair : lane_section.GetLanes()) {
+        const auto &lane = lane_pair.second;
+        if (lane.GetId() == 0) {
+          continue;
+        }
+        ++lanes;
+        const auto batch = lane.GetCornerPositions(s_values);
+        for (size_t i = 0u; i < s_values.size(); ++i) {
+          const auto single = lane.GetCornerPositions(s_values[i]);
+          const auto batched = batch[i];
+          ++samples;
+          if (carla::geom::Math::Distance(single.first, batched.first) > tolerance ||
+              carla::geom::Math::Distance(single.second, batched.second) > tolerance) {
+            if (mismatches++ == 0u) {
+              std::cerr << "Road " << road.GetId() << " lane " << lane.GetId()
+                        << " differs at s = " << s_values[i] << " (length "
+                        << road_length << ")\n";
+            }
+          }
+        }
+      }
+    }
+  }
+
+  std::cout << lanes << " lanes, " << samples << " samples, "
+            << mismatches << " mismatches\n";
+  return mismatches == 0u ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Checks that Map::GenerateLaneMarkBatches only drops the lane mark pieces
+/// that duplicate a merged one.
+///
+/// Generates the lane mark batches of the whole map and, separately, every
+/// piece of every road the same way. A piece is merged if its dash or all the
+/// vertices of its solid run are in the batches. Fails if a piece that was
+/// not merged is farther than the duplicate distance from every merged one,
+/// which happens when a dropped piece drops the next one, e.g. along roads
+/// split in many short lane sections.
+///
+/// Usage: lane-mark-batch-test <map.xodr>
+
+#include "Carla/Geom/Math.h"
+#include "Carla/OpenDrive/OpenDriveParser.h"
+#include "Carla/RPC/OpendriveGenerationParameters.h"
+#include "Carla/Road/MeshFactory.h"
+#include "Carla/Road/RoadMap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+  using carla::geom::Vector3D;
+
+  /// Same default as MergeLaneMarkPieces.
+  constexpr float DUPLICATE_DISTANCE = 2.5f;
+
+  using PositionKey = std::tuple<float, float, float>;
+
+  PositionKey MakeKey(const Vector3D &position) {
+    return PositionKey(position.x, position.y, position.z);
+  }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <map.xodr>\n";
+    return 1;
+  }
+
+  std::ifstream file(argv[1], std::ios::binary);
+  const std::string opendrive(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  auto map = carla::opendrive::OpenDriveParser::Load(opendrive);
+  if (!map) {
+    std::cerr << "Could not load " << argv[1] << "\n";
+    return 1;
+  }
+
+  carla::rpc::OpendriveGenerationParameters parameters;
+  parameters.vertex_distance = 0.5;
+  parameters.vertex_width_resolution = 8.0;
+  parameters.simplification_percentage = 15.0f;
+  const Vector3D min_pos(-1e6f, 1e6f, -1e6f);
+  const Vector3D max_pos(1e6f, -1e6f, 1e6f);
+  const auto batches = map->GenerateLaneMarkBatches(parameters, min_pos, max_pos);
+
+  std::set<PositionKey> merged_vertices;
+  std::vector<Vector3D> merged_dashes;
+  for (const auto &batch : batches) {
+    for (const auto &vertex : batch.mesh.GetVertices()) {
+      merged_vertices.insert(MakeKey(vertex));
+    }
+    for (const auto &dash : batch.dashes) {
+      merged_dashes.push_back(dash.location);
+    }
+  }
+
+  carla::geom::MeshFactory mesh_factory(parameters);
+  std::vector<carla::road::LaneMarkPiece> pieces;
+  for (const auto &road_pair : map->GetMapData().GetRoads()) {
+    if (!road_pair.second.IsJunction()) {
+      mesh_factory.GenerateLaneMarkPiecesForRoad(road_pair.second, pieces);
+    }
+  }
+
+  std::vector<Vector3D> merged;
+  std::vector<Vector3D> dropped;
+  for (const auto &piece : pieces) {
+    if (piece.edges.size() < 4u) {
+      continue;
+    }
+    const Vector3D centroid = piece.GetCentroid();
+    bool is_merged = false;
+    if (piece.dash) {
+      const Vector3D start = (piece.edges[0] + piece.edges[1]) * 0.5f;
+      const Vector3D end = (piece.edges[2] + piece.edges[3]) * 0.5f;
+      if (carla::geom::Math::Distance(start, end) <= 0.0f) {
+        continue;
+      }
+      is_merged = std::any_of(merged_dashes.begin(), merged_dashes.end(), [&](const Vector3D &dash) {
+        return carla::geom::Math::Distance(dash, centroid) < 1e-3f;
+      });
+    } else {
+      is_merged = std::all_of(piece.edges.begin(), piece.edges.end(), [&](const Vector3D &edge) {
+        return merged_vertices.count(MakeKey(edge)) != 0u;
+      });
+    }
+    (is_merged ? merged : dropped).push_back(centroid);
+  }
+
+  size_t lost = 0u;
+  for (const auto &centroid : dropped) {
+    const bool has_duplicate = std::any_of(merged.begin(), merged.end(), [&](const Vector3D &other) {
+      return carla::geom::Math::Distance(centroid, other) < DUPLICATE_DISTANCE;
+    });
+    if (!has_duplicate && lost++ == 0u) {
+      std::cerr << "The piece at (" << centroid.x << ", " << centroid.y
+                << ") was dropped with no merged piece closer than "
+                << DUPLICATE_DISTANCE << " m\n";
+    }
+  }
+
+  std::cout << pieces.size() << " pieces, " << merged.size() << " merged, "
+            << dropped.size() << " dropped as duplicates, " << lost
+            << " dropped without a merged duplicate\n";
+  return lost == 0u ? 0 : 1;
+}
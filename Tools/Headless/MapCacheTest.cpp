@@ -0,0 +1,67 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Writes the binary map cache (.xodr.bin) of an OpenDRIVE map, as
+/// UOpenDriveToMap does, and checks that it is valid for the map and that
+/// a second map loaded from the same file serializes to the same bytes.
+///
+/// Uninitialized bytes in the cache usually hold addresses, which only
+/// change from one process to the next, so ctest runs this twice and
+/// compares both files.
+///
+/// Usage: map-cache-test <map.xodr> <output.xodr.bin>
+
+#include "Carla/OpenDrive/OpenDriveParser.h"
+#include "Carla/Road/MapCache.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using carla::road::MapCache;
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " <map.xodr> <output.xodr.bin>\n";
+    return 1;
+  }
+
+  std::ifstream file(argv[1], std::ios::binary);
+  const std::string opendrive(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  const uint64_t hash = MapCache::ComputeHash(opendrive);
+
+  std::vector<uint8_t> caches[2];
+  for (auto &cache : caches) {
+    auto map = carla::opendrive::OpenDriveParser::Load(opendrive);
+    if (!map) {
+      std::cerr << "Could not load " << argv[1] << "\n";
+      return 1;
+    }
+    cache = MapCache::Serialize(*map, hash);
+  }
+  if (caches[0] != caches[1]) {
+    std::cerr << "The caches built twice from " << argv[1] << " differ\n";
+    return 1;
+  }
+  if (!MapCache(caches[0].data(), caches[0].size()).IsValidFor(hash)) {
+    std::cerr << "The cache of " << argv[1] << " is not valid for it\n";
+    return 1;
+  }
+
+  std::ofstream output(argv[2], std::ios::binary);
+  output.write(reinterpret_cast<const char *>(caches[0].data()),
+      static_cast<std::streamsize>(caches[0].size()));
+  if (!output) {
+    std::cerr << "Could not write " << argv[2] << "\n";
+    return 1;
+  }
+  std::cout << caches[0].size() << " bytes written to " << argv[2] << "\n";
+  return 0;
+}
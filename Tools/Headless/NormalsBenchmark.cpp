@@ -0,0 +1,270 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Compares the normals and tangents MeshFactory generates with the road
+/// meshes against the ones computed after the generation.
+///
+/// Generates the road meshes of the map and computes their normals and
+/// tangents the way UKismetProceduralMeshLibrary::CalculateTangentsForMesh
+/// does, welding the vertices that share a position through a hash map, and
+/// with geom::Mesh::ComputeNormalsAndTangents, which walks the indexes once.
+/// Prints the time of each and the mean angle between their normals and the
+/// ones of the generation, and fails if the generated normals are more than
+/// a degree away from the computed ones.
+///
+/// Then adds a smooth height field to the vertices, as the heightmap does in
+/// the plugin, bends the generated normals with
+/// geom::Mesh::DisplaceNormalsAndTangents from its slopes, and fails as well
+/// if they are more than a degree away from the ones computed from the
+/// displaced triangles.
+///
+/// Usage: normals-benchmark <map.xodr>
+
+#include "Carla/Geom/Math.h"
+#include "Carla/OpenDrive/OpenDriveParser.h"
+#include "Carla/Road/RoadMap.h"
+#include "Carla/StopWatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+  using carla::geom::Math;
+  using carla::geom::Mesh;
+  using carla::geom::Vector3D;
+
+  using MeshList = std::vector<std::unique_ptr<Mesh>>;
+
+  /// Key of a position rounded to a tenth of a millimeter.
+  struct PositionKey {
+    int64_t x, y, z;
+
+    bool operator==(const PositionKey &rhs) const {
+      return x == rhs.x && y == rhs.y && z == rhs.z;
+    }
+  };
+
+  struct PositionKeyHash {
+    size_t operator()(const PositionKey &key) const {
+      return std::hash<int64_t>()(key.x) ^
+          (std::hash<int64_t>()(key.y) << 1) ^
+          (std::hash<int64_t>()(key.z) << 2);
+    }
+  };
+
+  PositionKey MakeKey(const Vector3D &position) {
+    return PositionKey{
+        std::llround(position.x * 1e4),
+        std::llround(position.y * 1e4),
+        std::llround(position.z * 1e4)};
+  }
+
+  /// Normals and tangents of @a mesh as the Unreal tangent pass computes
+  /// them: face normals and tangents summed over every triangle of every
+  /// vertex at the same position.
+  void WeldedNormalsAndTangents(
+      const Mesh &mesh,
+      std::vector<Vector3D> &normals,
+      std::vector<Vector3D> &tangents) {
+    const auto &vertices = mesh.GetVertices();
+    const auto &indexes = mesh.GetIndexes();
+    const auto &uvs = mesh.GetUVs();
+    const size_t triangle_count = indexes.size() / 3u;
+
+    std::vector<Vector3D> face_normals(triangle_count);
+    std::vector<Vector3D> face_tangents(triangle_count);
+    std::vector<std::vector<size_t>> vertex_triangles(vertices.size());
+    for (size_t t = 0u; t < triangle_count; ++t) {
+      const size_t i0 = indexes[3u * t] - 1u;
+      const size_t i1 = indexes[3u * t + 1u] - 1u;
+      const size_t i2 = indexes[3u * t + 2u] - 1u;
+      const Vector3D edge1 = vertices[i1] - vertices[i0];
+      const Vector3D edge2 = vertices[i2] - vertices[i0];
+      Vector3D normal = Math::Cross(edge1, edge2).MakeSafeUnitVector(1e-6f);
+      if (normal.z < 0.0f) {
+        normal *= -1.0f;
+      }
+      face_normals[t] = normal;
+      Vector3D tangent(1.0f, 0.0f, 0.0f);
+      if (uvs.size() == vertices.size()) {
+        const float du1 = uvs[i1].x - uvs[i0].x, dv1 = uvs[i1].y - uvs[i0].y;
+        const float du2 = uvs[i2].x - uvs[i0].x, dv2 = uvs[i2].y - uvs[i0].y;
+        const float determinant = du1 * dv2 - du2 * dv1;
+        if (std::abs(determinant) > 1e-12f) {
+          tangent = (edge1 * dv2 - edge2 * dv1) * (1.0f / determinant);
+        }
+      }
+      face_tangents[t] = tangent.MakeSafeUnitVector(1e-6f);
+      vertex_triangles[i0].push_back(t);
+      vertex_triangles[i1].push_back(t);
+      vertex_triangles[i2].push_back(t);
+    }
+
+    std::unordered_map<PositionKey, std::vector<size_t>, PositionKeyHash> duplicates;
+    for (size_t v = 0u; v < vertices.size(); ++v) {
+      duplicates[MakeKey(vertices[v])].push_back(v);
+    }
+
+    normals.assign(vertices.size(), Vector3D());
+    tangents.assign(vertices.size(), Vector3D());
+    for (size_t v = 0u; v < vertices.size(); ++v) {
+      for (size_t duplicate : duplicates[MakeKey(vertices[v])]) {
+        for (size_t t : vertex_triangles[duplicate]) {
+          normals[v] += face_normals[t];
+          tangents[v] += face_tangents[t];
+        }
+      }
+      normals[v] = normals[v].MakeSafeUnitVector(1e-6f);
+      tangents[v] = tangents[v].MakeSafeUnitVector(1e-6f);
+    }
+  }
+
+  /// Hills of a few meters, steeper than most roads.
+  float Height(const Vector3D &position) {
+    return 4.0f * std::sin(position.x / 30.0f) * std::cos(position.y / 40.0f);
+  }
+
+  carla::geom::Vector2D HeightSlope(const Vector3D &position) {
+    return carla::geom::Vector2D(
+        4.0f / 30.0f * std::cos(position.x / 30.0f) * std::cos(position.y / 40.0f),
+        -4.0f / 40.0f * std::sin(position.x / 30.0f) * std::sin(position.y / 40.0f));
+  }
+
+  template <typename F>
+  double Measure(F &&function) {
+    carla::StopWatch stop_watch;
+    function();
+    stop_watch.Stop();
+    return static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) * 1e-3;
+  }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <map.xodr>\n";
+    return 1;
+  }
+
+  std::ifstream file(argv[1], std::ios::binary);
+  const std::string opendrive(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  auto map = carla::opendrive::OpenDriveParser::Load(opendrive);
+  if (!map) {
+    std::cerr << "Could not load " << argv[1] << "\n";
+    return 1;
+  }
+
+  carla::rpc::OpendriveGenerationParameters parameters;
+  auto road_meshes = map->GenerateOrderedChunkedMeshInLocations(
+      parameters,
+      carla::geom::Vector3D(-1e6f, 1e6f, -1e6f),
+      carla::geom::Vector3D(1e6f, -1e6f, 1e6f));
+  MeshList meshes;
+  size_t vertex_count = 0u;
+  size_t generated_count = 0u;
+  for (auto &lane_type_meshes : road_meshes) {
+    for (auto &mesh : lane_type_meshes.second) {
+      if (mesh && mesh->GetIndexesNum() >= 3u) {
+        vertex_count += mesh->GetVerticesNum();
+        generated_count += mesh->HasNormalsAndTangents() ? 1u : 0u;
+        meshes.push_back(std::move(mesh));
+      }
+    }
+  }
+
+  std::vector<std::vector<Vector3D>> welded_normals(meshes.size());
+  std::vector<std::vector<Vector3D>> welded_tangents(meshes.size());
+  const double welded_ms = Measure([&]() {
+    for (size_t i = 0u; i < meshes.size(); ++i) {
+      WeldedNormalsAndTangents(*meshes[i], welded_normals[i], welded_tangents[i]);
+    }
+  });
+
+  std::vector<std::vector<Vector3D>> computed_normals(meshes.size());
+  std::vector<std::vector<Vector3D>> computed_tangents(meshes.size());
+  const double computed_ms = Measure([&]() {
+    for (size_t i = 0u; i < meshes.size(); ++i) {
+      meshes[i]->ComputeNormalsAndTangents(computed_normals[i], computed_tangents[i]);
+    }
+  });
+
+  // Mean angle between the normals generated with the meshes and the
+  // computed ones. The welded ones also smooth the edges of the curbs, where
+  // the vertices are split on purpose, so they only give a reference.
+  auto mean_degrees = [&](const std::vector<std::vector<Vector3D>> &reference) {
+    double angle_sum = 0.0;
+    size_t angle_count = 0u;
+    for (size_t i = 0u; i < meshes.size(); ++i) {
+      if (!meshes[i]->HasNormalsAndTangents()) {
+        continue;
+      }
+      const auto &generated = meshes[i]->GetNormals();
+      for (size_t v = 0u; v < generated.size(); ++v) {
+        const float dot = Math::Dot(generated[v], reference[i][v]);
+        angle_sum += std::acos(std::max(-1.0f, std::min(1.0f, dot)));
+        ++angle_count;
+      }
+    }
+    return angle_count == 0u ? 0.0 : Math::ToDegrees(angle_sum / static_cast<double>(angle_count));
+  };
+  const double computed_degrees = mean_degrees(computed_normals);
+  const double welded_degrees = mean_degrees(welded_normals);
+
+  std::cout << meshes.size() << " road meshes, " << vertex_count << " vertices, "
+            << generated_count << " with generated normals\n\n"
+            << std::fixed << std::setprecision(2)
+            << std::left << std::setw(28) << "" << std::right
+            << std::setw(12) << "time (ms)" << std::setw(28) << "angle to generated (deg)" << "\n"
+            << std::left << std::setw(28) << "welded (Unreal)" << std::right
+            << std::setw(12) << welded_ms << std::setw(28) << welded_degrees << "\n"
+            << std::left << std::setw(28) << "ComputeNormalsAndTangents" << std::right
+            << std::setw(12) << computed_ms << std::setw(28) << computed_degrees << "\n";
+
+  if (generated_count == 0u || computed_degrees > 1.0) {
+    std::cerr << "The generated normals do not match the surface of the meshes\n";
+    return 1;
+  }
+
+  std::vector<std::vector<carla::geom::Vector2D>> slopes(meshes.size());
+  for (size_t i = 0u; i < meshes.size(); ++i) {
+    for (auto &vertex : meshes[i]->GetVertices()) {
+      slopes[i].push_back(HeightSlope(vertex));
+      vertex.z += Height(vertex);
+    }
+  }
+  const double displaced_ms = Measure([&]() {
+    for (size_t i = 0u; i < meshes.size(); ++i) {
+      if (meshes[i]->HasNormalsAndTangents()) {
+        meshes[i]->DisplaceNormalsAndTangents(slopes[i]);
+      }
+    }
+  });
+  for (size_t i = 0u; i < meshes.size(); ++i) {
+    meshes[i]->ComputeNormalsAndTangents(computed_normals[i], computed_tangents[i]);
+  }
+  const double displaced_degrees = mean_degrees(computed_normals);
+  std::cout << std::left << std::setw(28) << "DisplaceNormalsAndTangents" << std::right
+            << std::setw(12) << displaced_ms << std::setw(28) << displaced_degrees
+            << "  (after adding a height field)\n";
+
+  if (displaced_degrees > 1.0) {
+    std::cerr << "The displaced normals do not match the surface of the displaced meshes\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,179 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Compares the balancing algorithms of the waypoint R-tree of road::Map.
+///
+/// Loads an OpenDRIVE map, takes the segments Map::CreateRtree generated for
+/// it and builds a tree with each of the linear, quadratic and rstar
+/// parameters, inserting the segments one by one and with the packing
+/// algorithm. Prints the build time of each tree and the latency of the
+/// nearest segment query GetClosestWaypointOnRoad makes, at random positions
+/// of the map, and the latency of GetClosestWaypointOnRoad itself.
+///
+/// Usage: rtree-benchmark <map.xodr> [queries]
+
+#include "Carla/OpenDrive/OpenDriveParser.h"
+#include "Carla/Road/RoadMap.h"
+#include "Carla/StopWatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+  namespace bgi = boost::geometry::index;
+
+  using carla::road::Map;
+  using carla::road::element::Waypoint;
+
+  constexpr int32_t DrivingLane = static_cast<int32_t>(carla::road::Lane::LaneType::Driving);
+
+  struct Result {
+    double build_ms;
+    double query_ns;
+    double checksum;
+  };
+
+  template <typename Parameters>
+  Result Run(
+      const Map &map,
+      const std::vector<Map::RtreeElement> &elements,
+      const std::vector<carla::geom::Location> &queries,
+      bool bulk_load) {
+    using Rtree = carla::geom::SegmentCloudRtree<Waypoint, 3, Parameters>;
+    Rtree rtree;
+    carla::StopWatch build;
+    if (bulk_load) {
+      rtree.BulkLoad(elements);
+    } else {
+      rtree.InsertElements(elements);
+    }
+    build.Stop();
+
+    // Same query as Map::GetClosestWaypointOnRoad
+    double checksum = 0.0;
+    carla::StopWatch query;
+    for (const auto &location : queries) {
+      const typename Rtree::BPoint point(location.x, location.y, location.z);
+      auto result = rtree.GetNearestNeighboursWithFilter(
+          point,
+          [&](const typename Rtree::TreeElement &element) {
+            const auto &lane = map.GetLane(element.second.first);
+            return (DrivingLane & static_cast<int32_t>(lane.GetType())) > 0;
+          });
+      if (!result.empty()) {
+        checksum += boost::geometry::distance(point, result.front().first);
+      }
+    }
+    query.Stop();
+    return {
+        static_cast<double>(build.GetElapsedTime<std::chrono::microseconds>()) * 1e-3,
+        static_cast<double>(query.GetElapsedTime<std::chrono::nanoseconds>()) /
+            static_cast<double>(queries.size()),
+        checksum};
+  }
+
+  void Print(const char *name, const Result &result) {
+    std::cout << std::left << std::setw(24) << name << std::right
+              << std::setw(14) << result.build_ms
+              << std::setw(14) << result.query_ns << "\n";
+  }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <map.xodr> [queries]\n";
+    return 1;
+  }
+  const size_t query_count = argc > 2 ? std::max(1, std::atoi(argv[2])) : 100000u;
+
+  std::ifstream file(argv[1], std::ios::binary);
+  const std::string opendrive(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  carla::StopWatch load;
+  auto map = carla::opendrive::OpenDriveParser::Load(opendrive);
+  load.Stop();
+  if (!map) {
+    std::cerr << "Could not load " << argv[1] << "\n";
+    return 1;
+  }
+  const auto elements = map->GetRtreeElements();
+
+  // Random positions within the bounds of the segments
+  float min_x = std::numeric_limits<float>::max(), max_x = std::numeric_limits<float>::lowest();
+  float min_y = min_x, max_y = max_x;
+  for (const auto &element : elements) {
+    for (const auto &point : {element.first.first, element.first.second}) {
+      min_x = std::min(min_x, point.get<0>());
+      max_x = std::max(max_x, point.get<0>());
+      min_y = std::min(min_y, point.get<1>());
+      max_y = std::max(max_y, point.get<1>());
+    }
+  }
+  std::mt19937 random_engine(42u);
+  std::uniform_real_distribution<float> random_x(min_x, max_x);
+  std::uniform_real_distribution<float> random_y(min_y, max_y);
+  std::vector<carla::geom::Location> queries;
+  queries.reserve(query_count);
+  for (size_t i = 0u; i < query_count; ++i) {
+    queries.emplace_back(random_x(random_engine), random_y(random_engine), 0.0f);
+  }
+
+  std::cout << elements.size() << " segments, map loaded in "
+            << load.GetElapsedTime<std::chrono::milliseconds>() << " ms, "
+            << query_count << " queries\n\n"
+            << std::left << std::setw(24) << "" << std::right
+            << std::setw(14) << "build (ms)" << std::setw(14) << "query (ns)" << "\n"
+            << std::fixed << std::setprecision(2);
+
+  std::vector<Result> results;
+  results.push_back(Run<bgi::linear<16>>(*map, elements, queries, false));
+  Print("linear<16> insert", results.back());
+  results.push_back(Run<bgi::linear<16>>(*map, elements, queries, true));
+  Print("linear<16> pack", results.back());
+  results.push_back(Run<bgi::quadratic<16>>(*map, elements, queries, false));
+  Print("quadratic<16> insert", results.back());
+  results.push_back(Run<bgi::quadratic<16>>(*map, elements, queries, true));
+  Print("quadratic<16> pack", results.back());
+  results.push_back(Run<bgi::rstar<16>>(*map, elements, queries, false));
+  Print("rstar<16> insert", results.back());
+  results.push_back(Run<bgi::rstar<16>>(*map, elements, queries, true));
+  Print("rstar<16> pack", results.back());
+
+  carla::StopWatch closest;
+  size_t found = 0u;
+  for (const auto &location : queries) {
+    if (map->GetClosestWaypointOnRoad(location, DrivingLane)) {
+      ++found;
+    }
+  }
+  closest.Stop();
+  std::cout << "\nMap::GetClosestWaypointOnRoad "
+            << static_cast<double>(closest.GetElapsedTime<std::chrono::nanoseconds>()) /
+                   static_cast<double>(query_count)
+            << " ns (" << found << " found)\n";
+
+  // Every tree has to find segments at the same distance, the segments
+  // themselves may differ on ties
+  for (const auto &result : results) {
+    if (std::abs(result.checksum - results.front().checksum) > 1e-6 * results.front().checksum) {
+      std::cerr << "The trees found segments at different distances\n";
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,180 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Compares geom::Simplification with the Fast-Quadric wrapper it replaced,
+/// on the road meshes of an OpenDRIVE map.
+///
+/// Generates the road meshes of the map, simplifies a copy of them with the
+/// previous wrapper, with the edge collapse heap one mesh after the other and
+/// with the parallel driver, and prints the triangles processed per second
+/// and the triangles left by each one.
+///
+/// Usage: simplification-benchmark <map.xodr> [fraction of triangles to keep]
+
+#include "Carla/Geom/Simplification.h"
+#include "Carla/OpenDrive/OpenDriveParser.h"
+#include "Carla/Road/RoadMap.h"
+#include "Carla/Simplify/Simplify.h"
+#include "Carla/StopWatch.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+  using carla::geom::Mesh;
+
+  using MeshList = std::vector<std::unique_ptr<Mesh>>;
+
+  /// geom::Simplification::Simplificate as it was before the edge collapse
+  /// heap, copying the indexes once per triangle.
+  void FastQuadricSimplificate(float simplification_percentage, const std::unique_ptr<Mesh> &pmesh) {
+    Simplify::SimplificationObject Simplification;
+    for (carla::geom::Vector3D &current_vertex : pmesh->GetVertices()) {
+      Simplify::Vertex v;
+      v.p.x = current_vertex.x;
+      v.p.y = current_vertex.y;
+      v.p.z = current_vertex.z;
+      Simplification.vertices.push_back(v);
+    }
+
+    for (size_t i = 0; i < pmesh->GetIndexes().size() - 2; i += 3) {
+      Simplify::Triangle t;
+      t.material = 0;
+      auto indices = pmesh->GetIndexes();
+      t.v[0] = (indices[i]) - 1;
+      t.v[1] = (indices[i + 1]) - 1;
+      t.v[2] = (indices[i + 2]) - 1;
+      Simplification.triangles.push_back(t);
+    }
+
+    float target_size = Simplification.triangles.size();
+    Simplification.simplify_mesh((target_size * simplification_percentage));
+
+    pmesh->GetVertices().clear();
+    pmesh->GetIndexes().clear();
+
+    for (Simplify::Vertex &current_vertex : Simplification.vertices) {
+      carla::geom::Vector3D v;
+      v.x = current_vertex.p.x;
+      v.y = current_vertex.p.y;
+      v.z = current_vertex.p.z;
+      pmesh->AddVertex(v);
+    }
+
+    for (size_t i = 0; i < Simplification.triangles.size(); ++i) {
+      pmesh->GetIndexes().push_back((Simplification.triangles[i].v[0]) + 1);
+      pmesh->GetIndexes().push_back((Simplification.triangles[i].v[1]) + 1);
+      pmesh->GetIndexes().push_back((Simplification.triangles[i].v[2]) + 1);
+    }
+  }
+
+  MeshList Copy(const MeshList &meshes) {
+    MeshList copy;
+    copy.reserve(meshes.size());
+    for (const auto &mesh : meshes) {
+      copy.push_back(std::make_unique<Mesh>(*mesh));
+    }
+    return copy;
+  }
+
+  size_t CountTriangles(const MeshList &meshes) {
+    size_t count = 0u;
+    for (const auto &mesh : meshes) {
+      count += mesh->GetIndexesNum() / 3u;
+    }
+    return count;
+  }
+
+  template <typename F>
+  MeshList Run(const char *name, const MeshList &meshes, size_t triangles, F &&simplify) {
+    MeshList copy = Copy(meshes);
+    carla::StopWatch stop_watch;
+    simplify(copy);
+    stop_watch.Stop();
+    const double seconds =
+        static_cast<double>(stop_watch.GetElapsedTime<std::chrono::microseconds>()) * 1e-6;
+    std::cout << std::left << std::setw(24) << name << std::right
+              << std::setw(14) << seconds * 1e3
+              << std::setw(16) << static_cast<double>(triangles) / seconds
+              << std::setw(14) << CountTriangles(copy) << "\n";
+    return copy;
+  }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <map.xodr> [fraction of triangles to keep]\n";
+    return 1;
+  }
+  const float ratio = argc > 2 ? static_cast<float>(std::atof(argv[2])) : 0.15f;
+
+  std::ifstream file(argv[1], std::ios::binary);
+  const std::string opendrive(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  auto map = carla::opendrive::OpenDriveParser::Load(opendrive);
+  if (!map) {
+    std::cerr << "Could not load " << argv[1] << "\n";
+    return 1;
+  }
+
+  carla::rpc::OpendriveGenerationParameters parameters;
+  auto road_meshes = map->GenerateOrderedChunkedMeshInLocations(
+      parameters,
+      carla::geom::Vector3D(-1e6f, 1e6f, -1e6f),
+      carla::geom::Vector3D(1e6f, -1e6f, 1e6f));
+  MeshList meshes;
+  for (auto &lane_type_meshes : road_meshes) {
+    for (auto &mesh : lane_type_meshes.second) {
+      if (mesh && mesh->GetIndexesNum() >= 3u) {
+        meshes.push_back(std::move(mesh));
+      }
+    }
+  }
+  const size_t triangles = CountTriangles(meshes);
+  std::cout << meshes.size() << " road meshes, " << triangles << " triangles, keeping "
+            << ratio * 100.0f << "%\n\n"
+            << std::left << std::setw(24) << "" << std::right
+            << std::setw(14) << "time (ms)" << std::setw(16) << "triangles/s"
+            << std::setw(14) << "triangles" << "\n"
+            << std::fixed << std::setprecision(0);
+
+  Run("fast quadric", meshes, triangles, [&](MeshList &copy) {
+    for (const auto &mesh : copy) {
+      FastQuadricSimplificate(ratio, mesh);
+    }
+  });
+  const carla::geom::Simplification simplification(ratio);
+  const MeshList serial = Run("edge collapse heap", meshes, triangles, [&](MeshList &copy) {
+    for (const auto &mesh : copy) {
+      simplification.Simplificate(mesh);
+    }
+  });
+  const MeshList parallel = Run("edge collapse parallel", meshes, triangles, [&](MeshList &copy) {
+    simplification.Simplificate(copy);
+  });
+
+  // Each mesh is simplified on its own, so the driver has to give the same
+  // result as the serial loop
+  for (size_t i = 0u; i < meshes.size(); ++i) {
+    if (!serial[i]->IsValid() ||
+        serial[i]->GetIndexes() != parallel[i]->GetIndexes() ||
+        serial[i]->GetMaterials().size() != meshes[i]->GetMaterials().size() ||
+        serial[i]->GetIndexesNum() > meshes[i]->GetIndexesNum()) {
+      std::cerr << "Mesh " << i << " was not simplified consistently\n";
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,365 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Writes a synthetic OpenDRIVE map to benchmark the mesh generation.
+///
+/// The map is a grid of N x N junctions. Each pair of neighbouring junctions
+/// is joined by a straight two-way road with sidewalks and an elevation
+/// profile. Every junction connects each incoming road with the other ones
+/// through straight and arc connecting roads. The output only depends on the
+/// arguments, so the maps can be rebuilt identically on every machine.
+///
+/// With --param-poly3 every road is written as a paramPoly3 instead, the
+/// way maps converted from OpenStreetMap are: the straight roads as a linear
+/// polynomial and the turns as the cubic Bezier approximation of the arc.
+///
+/// With --section-length the roads between junctions are split in lane
+/// sections of that many meters, as maps with many short sections are.
+///
+/// Usage: synthetic-xodr <grid size> <output.xodr> [block length]
+///            [--param-poly3] [--section-length <m>]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+  constexpr double PI = 3.14159265358979323846;
+
+  constexpr double JUNCTION_RADIUS = 10.0;
+
+  constexpr double DRIVING_WIDTH = 3.5;
+
+  constexpr double SIDEWALK_WIDTH = 2.0;
+
+  constexpr double ELEVATION_AMPLITUDE = 2.0;
+
+  /// Distance of the inner control points of a cubic Bezier approximating a
+  /// quarter of circle, relative to its radius.
+  constexpr double BEZIER_ARC_FACTOR = 0.5522847498;
+
+  /// Directions of the arms of a junction, in counter-clockwise order.
+  enum Arm { East = 0, North = 1, West = 2, South = 3 };
+
+  struct ArmRoad {
+    int road_id = -1;
+    /// Whether the road starts (true) or ends (false) at this junction.
+    bool starts_here = false;
+  };
+
+  struct Node {
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+    ArmRoad arms[4];
+  };
+
+  std::string LaneXml(
+      int id,
+      const char *type,
+      double width,
+      const char *mark,
+      int predecessor = 0,
+      int successor = 0) {
+    std::ostringstream out;
+    out << "          <lane id=\"" << id << "\" type=\"" << type << "\" level=\"false\">\n";
+    if (predecessor != 0 || successor != 0) {
+      out << "            <link>\n";
+      if (predecessor != 0) {
+        out << "              <predecessor id=\"" << predecessor << "\"/>\n";
+      }
+      if (successor != 0) {
+        out << "              <successor id=\"" << successor << "\"/>\n";
+      }
+      out << "            </link>\n";
+    }
+    if (width > 0.0) {
+      out << "            <width sOffset=\"0\" a=\"" << width << "\" b=\"0\" c=\"0\" d=\"0\"/>\n";
+    }
+    out << "            <roadMark sOffset=\"0\" type=\"" << mark
+        << "\" weight=\"standard\" color=\"standard\" width=\"0.15\" laneChange=\"none\"/>\n";
+    out << "          </lane>\n";
+    return out.str();
+  }
+
+  class Writer {
+  public:
+
+    Writer(int grid_size, double block_length, bool param_poly3, double section_length)
+      : _grid_size(grid_size),
+        _block_length(block_length),
+        _param_poly3(param_poly3),
+        _section_length(section_length),
+        _nodes(static_cast<size_t>(grid_size * grid_size)) {
+      for (int j = 0; j < grid_size; ++j) {
+        for (int i = 0; i < grid_size; ++i) {
+          Node &node = GetNode(i, j);
+          node.x = i * block_length;
+          node.y = j * block_length;
+          node.z = ELEVATION_AMPLITUDE * std::sin(0.7 * i) * std::cos(0.5 * j);
+        }
+      }
+    }
+
+    std::string Write() {
+      _out << std::setprecision(12);
+      _out << "<?xml version=\"1.0\" standalone=\"yes\"?>\n";
+      _out << "<OpenDRIVE>\n";
+      _out << "  <header revMajor=\"1\" revMinor=\"4\" name=\"SyntheticGrid" << _grid_size
+           << "\" version=\"1\">\n";
+      _out << "    <geoReference><![CDATA[+proj=tmerc +lat_0=42 +lon_0=2 +k=1 +x_0=0 +y_0=0 "
+              "+datum=WGS84 +units=m +no_defs]]></geoReference>\n";
+      _out << "  </header>\n";
+      // Roads between neighbouring junctions, heading east and north
+      for (int j = 0; j < _grid_size; ++j) {
+        for (int i = 0; i < _grid_size; ++i) {
+          if (i + 1 < _grid_size) {
+            WriteBlockRoad(GetNode(i, j), GetNode(i + 1, j), East, j * _grid_size + i, j * _grid_size + i + 1);
+          }
+          if (j + 1 < _grid_size) {
+            WriteBlockRoad(GetNode(i, j), GetNode(i, j + 1), North, j * _grid_size + i, (j + 1) * _grid_size + i);
+          }
+        }
+      }
+      for (int node = 0; node < _grid_size * _grid_size; ++node) {
+        WriteJunction(node);
+      }
+      _out << _junctions.str();
+      _out << "</OpenDRIVE>\n";
+      return _out.str();
+    }
+
+  private:
+
+    Node &GetNode(int i, int j) {
+      return _nodes[static_cast<size_t>(j * _grid_size + i)];
+    }
+
+    static double ArmAngle(int arm) {
+      return arm * PI / 2.0;
+    }
+
+    void WriteRoadHeader(int id, double length, int junction) {
+      _out << "  <road name=\"Road " << id << "\" length=\"" << length << "\" id=\"" << id
+           << "\" junction=\"" << junction << "\">\n";
+    }
+
+    /// A straight line, parametrized by its arc length.
+    void WriteStraightGeometry() {
+      if (_param_poly3) {
+        _out << "<paramPoly3 aU=\"0\" bU=\"1\" cU=\"0\" dU=\"0\" "
+                "aV=\"0\" bV=\"0\" cV=\"0\" dV=\"0\" pRange=\"arcLength\"/>";
+      } else {
+        _out << "<line/>";
+      }
+    }
+
+    /// A quarter of circle of @a radius, to the left if @a curvature_sign is
+    /// positive.
+    void WriteTurnGeometry(double radius, double curvature_sign) {
+      if (_param_poly3) {
+        // Power basis of the Bezier (0, 0), (kR, 0), (R, R - kR), (R, R)
+        const double k = BEZIER_ARC_FACTOR;
+        _out << "<paramPoly3 aU=\"0\" bU=\"" << 3.0 * k * radius
+             << "\" cU=\"" << 3.0 * radius * (1.0 - 2.0 * k)
+             << "\" dU=\"" << radius * (3.0 * k - 2.0)
+             << "\" aV=\"0\" bV=\"0\" cV=\"" << curvature_sign * 3.0 * radius * (1.0 - k)
+             << "\" dV=\"" << curvature_sign * radius * (3.0 * k - 2.0)
+             << "\" pRange=\"normalized\"/>";
+      } else {
+        _out << "<arc curvature=\"" << curvature_sign / radius << "\"/>";
+      }
+    }
+
+    void WriteElevation(double z0, double z1, double length) {
+      // Cubic with zero slope at both ends
+      const double dz = z1 - z0;
+      _out << "    <elevationProfile>\n";
+      _out << "      <elevation s=\"0\" a=\"" << z0 << "\" b=\"0\" c=\"" << 3.0 * dz / (length * length)
+           << "\" d=\"" << -2.0 * dz / (length * length * length) << "\"/>\n";
+      _out << "    </elevationProfile>\n";
+      _out << "    <lateralProfile/>\n";
+    }
+
+    void WriteBlockRoad(Node &from, Node &to, Arm direction, int from_junction, int to_junction) {
+      const int id = _next_road_id++;
+      const double length = _block_length - 2.0 * JUNCTION_RADIUS;
+      const double hdg = ArmAngle(direction);
+      const double x = from.x + JUNCTION_RADIUS * std::cos(hdg);
+      const double y = from.y + JUNCTION_RADIUS * std::sin(hdg);
+      from.arms[direction] = ArmRoad{id, true};
+      to.arms[(direction + 2) % 4] = ArmRoad{id, false};
+
+      WriteRoadHeader(id, length, -1);
+      _out << "    <link>\n";
+      _out << "      <predecessor elementType=\"junction\" elementId=\"" << from_junction << "\"/>\n";
+      _out << "      <successor elementType=\"junction\" elementId=\"" << to_junction << "\"/>\n";
+      _out << "    </link>\n";
+      _out << "    <type s=\"0\" type=\"town\"><speed max=\"50\" unit=\"km/h\"/></type>\n";
+      _out << "    <planView>\n";
+      _out << "      <geometry s=\"0\" x=\"" << x << "\" y=\"" << y << "\" hdg=\"" << hdg
+           << "\" length=\"" << length << "\">";
+      WriteStraightGeometry();
+      _out << "</geometry>\n";
+      _out << "    </planView>\n";
+      WriteElevation(from.z, to.z, length);
+      _out << "    <lanes>\n";
+      _out << "      <laneOffset s=\"0\" a=\"0\" b=\"0\" c=\"0\" d=\"0\"/>\n";
+      const int section_count = _section_length > 0.0 ?
+          std::max(1, static_cast<int>(std::ceil(length / _section_length))) : 1;
+      for (int section = 0; section < section_count; ++section) {
+        // Each lane continues in the same lane of the next section
+        const auto link = [&](int lane) { return section > 0 ? lane : 0; };
+        const auto next = [&](int lane) { return section + 1 < section_count ? lane : 0; };
+        _out << "      <laneSection s=\"" << section * _section_length << "\">\n";
+        _out << "        <left>\n";
+        _out << LaneXml(2, "sidewalk", SIDEWALK_WIDTH, "none", link(2), next(2));
+        _out << LaneXml(1, "driving", DRIVING_WIDTH, "solid", link(1), next(1));
+        _out << "        </left>\n";
+        _out << "        <center>\n";
+        _out << LaneXml(0, "none", 0.0, "broken");
+        _out << "        </center>\n";
+        _out << "        <right>\n";
+        _out << LaneXml(-1, "driving", DRIVING_WIDTH, "solid", link(-1), next(-1));
+        _out << LaneXml(-2, "sidewalk", SIDEWALK_WIDTH, "none", link(-2), next(-2));
+        _out << "        </right>\n";
+        _out << "      </laneSection>\n";
+      }
+      _out << "    </lanes>\n";
+      _out << "    <objects/>\n";
+      _out << "    <signals/>\n";
+      _out << "  </road>\n";
+    }
+
+    /// Connects every arm of the junction with every other arm: a straight
+    /// road to the opposite arm and a quarter of circle to the side ones.
+    void WriteJunction(int node_index) {
+      const Node &node = _nodes[static_cast<size_t>(node_index)];
+      _junctions << "  <junction id=\"" << node_index << "\" name=\"Junction " << node_index << "\">\n";
+      int connection_id = 0;
+      for (int in = 0; in < 4; ++in) {
+        const ArmRoad &incoming = node.arms[in];
+        if (incoming.road_id < 0) {
+          continue;
+        }
+        for (int out = 0; out < 4; ++out) {
+          const ArmRoad &outgoing = node.arms[out];
+          if (out == in || outgoing.road_id < 0) {
+            continue;
+          }
+          // Lanes driving into and out of the junction
+          const int from_lane = incoming.starts_here ? 1 : -1;
+          const int to_lane = outgoing.starts_here ? -1 : 1;
+          const int id = _next_road_id++;
+          const double hdg = ArmAngle(in) + PI;
+          const double x = node.x + JUNCTION_RADIUS * std::cos(ArmAngle(in));
+          const double y = node.y + JUNCTION_RADIUS * std::sin(ArmAngle(in));
+          const int turn = (out - in + 4) % 4; // 2 straight, 1 right, 3 left
+          const double length = turn == 2 ? 2.0 * JUNCTION_RADIUS : JUNCTION_RADIUS * PI / 2.0;
+
+          WriteRoadHeader(id, length, node_index);
+          _out << "    <link>\n";
+          _out << "      <predecessor elementType=\"road\" elementId=\"" << incoming.road_id
+               << "\" contactPoint=\"" << (incoming.starts_here ? "start" : "end") << "\"/>\n";
+          _out << "      <successor elementType=\"road\" elementId=\"" << outgoing.road_id
+               << "\" contactPoint=\"" << (outgoing.starts_here ? "start" : "end") << "\"/>\n";
+          _out << "    </link>\n";
+          _out << "    <planView>\n";
+          _out << "      <geometry s=\"0\" x=\"" << x << "\" y=\"" << y << "\" hdg=\"" << hdg
+               << "\" length=\"" << length << "\">";
+          if (turn == 2) {
+            WriteStraightGeometry();
+          } else {
+            WriteTurnGeometry(JUNCTION_RADIUS, turn == 1 ? -1.0 : 1.0);
+          }
+          _out << "</geometry>\n";
+          _out << "    </planView>\n";
+          WriteElevation(node.z, node.z, length);
+          _out << "    <lanes>\n";
+          _out << "      <laneSection s=\"0\">\n";
+          _out << "        <center>\n";
+          _out << LaneXml(0, "none", 0.0, "none");
+          _out << "        </center>\n";
+          _out << "        <right>\n";
+          _out << LaneXml(-1, "driving", DRIVING_WIDTH, "none", from_lane, to_lane);
+          _out << "        </right>\n";
+          _out << "      </laneSection>\n";
+          _out << "    </lanes>\n";
+          _out << "  </road>\n";
+
+          _junctions << "    <connection id=\"" << connection_id++ << "\" incomingRoad=\""
+                     << incoming.road_id << "\" connectingRoad=\"" << id
+                     << "\" contactPoint=\"start\">\n";
+          _junctions << "      <laneLink from=\"" << from_lane << "\" to=\"-1\"/>\n";
+          _junctions << "    </connection>\n";
+        }
+      }
+      _junctions << "  </junction>\n";
+    }
+
+    const int _grid_size;
+
+    const double _block_length;
+
+    const bool _param_poly3;
+
+    /// Length of the lane sections of the roads between junctions, a single
+    /// section if zero.
+    const double _section_length;
+
+    std::vector<Node> _nodes;
+
+    int _next_road_id = 0;
+
+    std::ostringstream _out;
+
+    std::ostringstream _junctions;
+  };
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  bool param_poly3 = false;
+  double section_length = 0.0;
+  std::vector<const char *> arguments;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--param-poly3") == 0) {
+      param_poly3 = true;
+    } else if (std::strcmp(argv[i], "--section-length") == 0 && i + 1 < argc) {
+      section_length = std::atof(argv[++i]);
+    } else {
+      arguments.push_back(argv[i]);
+    }
+  }
+  if (arguments.size() < 2u || section_length < 0.0) {
+    std::cerr << "Usage: " << argv[0]
+              << " <grid size> <output.xodr> [block length] [--param-poly3]"
+                 " [--section-length <m>]\n";
+    return 1;
+  }
+  const int grid_size = std::atoi(arguments[0]);
+  const double block_length = arguments.size() > 2u ? std::atof(arguments[2]) : 100.0;
+  if (grid_size < 2 || block_length <= 2.0 * JUNCTION_RADIUS) {
+    std::cerr << "The grid size must be at least 2 and the block length greater than "
+              << 2.0 * JUNCTION_RADIUS << " m\n";
+    return 1;
+  }
+  std::ofstream file(arguments[1], std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot write " << arguments[1] << "\n";
+    return 1;
+  }
+  file << Writer(grid_size, block_length, param_poly3, section_length).Write();
+  return file ? 0 : 1;
+}
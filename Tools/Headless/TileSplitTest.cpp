@@ -0,0 +1,162 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Checks that splitting a map into tiles generates each road, junction,
+/// lane mark and tree once.
+///
+/// Generates the road meshes, the lane marks (per road and batched) and the
+/// tree positions of the whole map as a single tile, then of every tile of
+/// <tile size> meters covering it, laid out as UOpenDriveToMap lays them
+/// from the origin, and fails if the totals of the tiles differ from the
+/// single tile.
+///
+/// Usage: tile-split-test <map.xodr> [tile size]
+
+#include "Carla/Geom/Mesh.h"
+#include "Carla/OpenDrive/OpenDriveParser.h"
+#include "Carla/RPC/OpendriveGenerationParameters.h"
+#include "Carla/Road/RoadMap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+  struct Totals {
+    size_t road_meshes = 0u;
+    size_t road_vertices = 0u;
+    size_t lane_mark_meshes = 0u;
+    size_t lane_mark_vertices = 0u;
+    size_t batched_lane_mark_vertices = 0u;
+    size_t dashes = 0u;
+    size_t trees = 0u;
+
+    void Add(const Totals &rhs) {
+      road_meshes += rhs.road_meshes;
+      road_vertices += rhs.road_vertices;
+      lane_mark_meshes += rhs.lane_mark_meshes;
+      lane_mark_vertices += rhs.lane_mark_vertices;
+      batched_lane_mark_vertices += rhs.batched_lane_mark_vertices;
+      dashes += rhs.dashes;
+      trees += rhs.trees;
+    }
+  };
+
+  Totals GenerateTile(
+      const carla::road::Map &map,
+      const carla::geom::Vector3D &min_pos,
+      const carla::geom::Vector3D &max_pos) {
+    carla::rpc::OpendriveGenerationParameters road_parameters;
+    road_parameters.vertex_distance = 0.5;
+    road_parameters.vertex_width_resolution = 8.0;
+    road_parameters.simplification_percentage = 0.0f;
+    carla::rpc::OpendriveGenerationParameters lane_mark_parameters = road_parameters;
+    lane_mark_parameters.simplification_percentage = 15.0f;
+
+    Totals totals;
+    const auto road_meshes =
+        map.GenerateOrderedChunkedMeshInLocations(road_parameters, min_pos, max_pos);
+    for (const auto &lane_type_meshes : road_meshes) {
+      for (const auto &mesh : lane_type_meshes.second) {
+        ++totals.road_meshes;
+        totals.road_vertices += mesh->GetVerticesNum();
+      }
+    }
+    std::vector<std::string> lane_mark_info;
+    const auto lane_marks =
+        map.GenerateLineMarkings(lane_mark_parameters, min_pos, max_pos, lane_mark_info);
+    for (const auto &mesh : lane_marks) {
+      ++totals.lane_mark_meshes;
+      totals.lane_mark_vertices += mesh->GetVerticesNum();
+    }
+    for (const auto &batch : map.GenerateLaneMarkBatches(lane_mark_parameters, min_pos, max_pos)) {
+      totals.batched_lane_mark_vertices += batch.mesh.GetVerticesNum();
+      totals.dashes += batch.dashes.size();
+    }
+    totals.trees = map.GetTreesTransform(min_pos, max_pos, 50.0f, 3.0f).size();
+    return totals;
+  }
+
+  bool Check(const char *name, size_t single_tile, size_t tiles) {
+    std::cout << "  " << name << ": " << single_tile << " in a single tile, "
+              << tiles << " in the tiles\n";
+    return single_tile == tiles;
+  }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <map.xodr> [tile size]\n";
+    return 1;
+  }
+  const double tile_size = argc > 2 ? std::atof(argv[2]) : 150.0;
+  if (!(tile_size > 0.0)) {
+    std::cerr << "The tile size has to be positive\n";
+    return 1;
+  }
+
+  std::ifstream file(argv[1], std::ios::binary);
+  const std::string opendrive(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  auto map = carla::opendrive::OpenDriveParser::Load(opendrive);
+  if (!map) {
+    std::cerr << "Could not load " << argv[1] << "\n";
+    return 1;
+  }
+
+  // Extents of the lane centers, the locations deciding the tile of each
+  // road and junction are inside them
+  double min_x = 1e9, min_y = 1e9, max_x = -1e9, max_y = -1e9;
+  for (const auto &waypoint : map->GenerateWaypoints(1.0)) {
+    const auto location = map->ComputeTransform(waypoint).location;
+    min_x = std::min<double>(min_x, location.x);
+    min_y = std::min<double>(min_y, location.y);
+    max_x = std::max<double>(max_x, location.x);
+    max_y = std::max<double>(max_y, location.y);
+  }
+  const double first_x = std::floor(min_x / tile_size) * tile_size;
+  const double first_y = std::floor(min_y / tile_size) * tile_size;
+  const int tiles_x = static_cast<int>(std::floor((max_x - first_x) / tile_size)) + 1;
+  const int tiles_y = static_cast<int>(std::floor((max_y - first_y) / tile_size)) + 1;
+
+  const auto corner = [&](int i, int j) {
+    return carla::geom::Vector3D(
+        static_cast<float>(first_x + i * tile_size),
+        static_cast<float>(first_y + j * tile_size),
+        0.0f);
+  };
+  const Totals single_tile = GenerateTile(*map, corner(0, 0), corner(tiles_x, tiles_y));
+  Totals tiles;
+  for (int i = 0; i < tiles_x; ++i) {
+    for (int j = 0; j < tiles_y; ++j) {
+      tiles.Add(GenerateTile(*map, corner(i, j), corner(i + 1, j + 1)));
+    }
+  }
+
+  std::cout << argv[1] << " split in " << tiles_x << " x " << tiles_y
+            << " tiles of " << tile_size << " m\n";
+  bool same = true;
+  same &= Check("road meshes", single_tile.road_meshes, tiles.road_meshes);
+  same &= Check("road vertices", single_tile.road_vertices, tiles.road_vertices);
+  same &= Check("lane mark meshes", single_tile.lane_mark_meshes, tiles.lane_mark_meshes);
+  same &= Check("lane mark vertices", single_tile.lane_mark_vertices, tiles.lane_mark_vertices);
+  same &= Check("batched lane mark vertices",
+      single_tile.batched_lane_mark_vertices, tiles.batched_lane_mark_vertices);
+  same &= Check("lane mark dashes", single_tile.dashes, tiles.dashes);
+  same &= Check("trees", single_tile.trees, tiles.trees);
+  if (!same) {
+    std::cerr << "The tiles generated a different map than the single tile\n";
+    return 1;
+  }
+  return 0;
+}
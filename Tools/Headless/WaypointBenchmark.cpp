@@ -0,0 +1,284 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Compares the waypoint queries of road::Map, which walk the FlatMapData of
+/// the map, with the same queries going through the hash maps, multimaps and
+/// maps of MapData, as they did before.
+///
+/// Generates the waypoints of the map every two meters and runs each query
+/// on all of them in a shuffled order, so consecutive queries do not share
+/// cache lines. Prints the latency of each query and, where the kernel
+/// allows reading the hardware counters, the cache misses per query. Fails
+/// if both give different results.
+///
+/// Usage: waypoint-benchmark <map.xodr> [distance of GetNext in meters]
+
+#include "Carla/OpenDrive/OpenDriveParser.h"
+#include "Carla/Road/RoadMap.h"
+#include "Carla/Road/element/RoadInfoLaneWidth.h"
+#include "Carla/StopWatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+  using carla::road::Lane;
+  using carla::road::MapData;
+  using carla::road::element::Waypoint;
+
+  constexpr double EPSILON = 10.0 * std::numeric_limits<double>::epsilon();
+
+  /// Last level cache misses of this thread, if the kernel lets us read them.
+  class CacheMissCounter {
+  public:
+
+#ifdef __linux__
+    CacheMissCounter() {
+      perf_event_attr attributes = {};
+      attributes.type = PERF_TYPE_HARDWARE;
+      attributes.size = sizeof(attributes);
+      attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+      attributes.disabled = 1;
+      attributes.exclude_kernel = 1;
+      attributes.exclude_hv = 1;
+      _fd = static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+    }
+
+    ~CacheMissCounter() {
+      if (_fd >= 0) {
+        close(_fd);
+      }
+    }
+
+    bool IsAvailable() const {
+      return _fd >= 0;
+    }
+
+    void Start() {
+      if (_fd >= 0) {
+        ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+
+    uint64_t Stop() {
+      uint64_t count = 0u;
+      if (_fd >= 0) {
+        ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(_fd, &count, sizeof(count)) != sizeof(count)) {
+          count = 0u;
+        }
+      }
+      return count;
+    }
+
+  private:
+
+    int _fd = -1;
+#else
+    bool IsAvailable() const {
+      return false;
+    }
+
+    void Start() {}
+
+    uint64_t Stop() {
+      return 0u;
+    }
+#endif
+  };
+
+  // Map::GetLane, GetSuccessors, GetNext and GetLaneWidth as they were
+  // before FlatMapData, looking the lanes up in MapData.
+
+  const Lane &NodeGetLane(const MapData &data, const Waypoint &waypoint) {
+    return data.GetRoad(waypoint.road_id).GetLaneById(waypoint.section_id, waypoint.lane_id);
+  }
+
+  std::vector<Waypoint> NodeGetSuccessors(const MapData &data, const Waypoint &waypoint) {
+    const auto &next_lanes = NodeGetLane(data, waypoint).GetNextLanes();
+    std::vector<Waypoint> result;
+    result.reserve(next_lanes.size());
+    for (const auto *next_lane : next_lanes) {
+      const double distance = next_lane->GetId() <= 0 ?
+          next_lane->GetDistance() + 10.0 * EPSILON :
+          next_lane->GetDistance() + next_lane->GetLength() - 10.0 * EPSILON;
+      result.emplace_back(Waypoint{
+          next_lane->GetRoad()->GetId(),
+          next_lane->GetLaneSection()->GetId(),
+          next_lane->GetId(),
+          distance});
+    }
+    return result;
+  }
+
+  std::vector<Waypoint> NodeGetNext(const MapData &data, const Waypoint &waypoint, double distance) {
+    if (distance <= EPSILON) {
+      return {waypoint};
+    }
+    const auto &lane = NodeGetLane(data, waypoint);
+    const bool forward = (waypoint.lane_id <= 0);
+    const double signed_distance = forward ? distance : -distance;
+    const double relative_s = waypoint.s - lane.GetDistance();
+    const double remaining_lane_length = forward ? lane.GetLength() - relative_s : relative_s;
+    if (distance <= remaining_lane_length) {
+      Waypoint result = waypoint;
+      result.s += signed_distance;
+      result.s += forward ? -EPSILON : EPSILON;
+      return {result};
+    }
+    std::vector<Waypoint> result;
+    for (const auto &successor : NodeGetSuccessors(data, waypoint)) {
+      bool is_broken = false;
+      for (const auto &future_successor : NodeGetSuccessors(data, successor)) {
+        if (future_successor.road_id == waypoint.road_id &&
+            future_successor.lane_id == waypoint.lane_id &&
+            future_successor.section_id == waypoint.section_id) {
+          is_broken = true;
+          break;
+        }
+      }
+      if (!is_broken) {
+        const auto next = NodeGetNext(data, successor, distance - remaining_lane_length);
+        result.insert(result.end(), next.begin(), next.end());
+      }
+    }
+    return result;
+  }
+
+  double NodeGetLaneWidth(const MapData &data, const Waypoint &waypoint) {
+    const auto *width = NodeGetLane(data, waypoint).GetInfo<carla::road::element::RoadInfoLaneWidth>(waypoint.s);
+    return width->GetPolynomial().Evaluate(waypoint.s);
+  }
+
+  /// Comparable value of each kind of query result.
+  double Checksum(const Lane &lane) {
+    return static_cast<double>(lane.GetId()) + lane.GetDistance();
+  }
+
+  double Checksum(const std::vector<Waypoint> &waypoints) {
+    double sum = static_cast<double>(waypoints.size());
+    for (const auto &waypoint : waypoints) {
+      sum += waypoint.road_id + waypoint.section_id + waypoint.lane_id + waypoint.s;
+    }
+    return sum;
+  }
+
+  double Checksum(double value) {
+    return value;
+  }
+
+  struct Result {
+
+    double nanoseconds_per_query;
+
+    double misses_per_query;
+
+    std::vector<double> checksums;
+  };
+
+  template <typename F>
+  Result Run(const std::vector<Waypoint> &waypoints, CacheMissCounter &counter, F &&query) {
+    Result result;
+    result.checksums.reserve(waypoints.size());
+    carla::StopWatch stop_watch;
+    counter.Start();
+    for (const auto &waypoint : waypoints) {
+      result.checksums.push_back(Checksum(query(waypoint)));
+    }
+    const uint64_t misses = counter.Stop();
+    stop_watch.Stop();
+    const double count = static_cast<double>(std::max<size_t>(waypoints.size(), 1u));
+    result.nanoseconds_per_query =
+        static_cast<double>(stop_watch.GetElapsedTime<std::chrono::nanoseconds>()) / count;
+    result.misses_per_query = static_cast<double>(misses) / count;
+    return result;
+  }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <map.xodr> [distance of GetNext in meters]\n";
+    return 1;
+  }
+  const double next_distance = argc > 2 ? std::atof(argv[2]) : 5.0;
+
+  std::ifstream file(argv[1], std::ios::binary);
+  const std::string opendrive(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  auto map = carla::opendrive::OpenDriveParser::Load(opendrive);
+  if (!map) {
+    std::cerr << "Could not load " << argv[1] << "\n";
+    return 1;
+  }
+  const MapData &data = map->GetMapData();
+
+  std::vector<Waypoint> waypoints = map->GenerateWaypoints(2.0);
+  std::shuffle(waypoints.begin(), waypoints.end(), std::mt19937(42u));
+
+  CacheMissCounter counter;
+  std::cout << data.GetFlatData().GetRoadCount() << " roads, "
+            << data.GetFlatData().GetLaneCount() << " lanes, "
+            << waypoints.size() << " waypoints in a shuffled order\n\n"
+            << std::left << std::setw(16) << "" << std::right
+            << std::setw(16) << "MapData (ns)" << std::setw(16) << "flat (ns)"
+            << std::setw(18) << "MapData misses" << std::setw(14) << "flat misses" << "\n"
+            << std::fixed << std::setprecision(1);
+
+  bool same_results = true;
+  auto compare = [&](const char *name, const Result &node, const Result &flat) {
+    std::cout << std::left << std::setw(16) << name << std::right
+              << std::setw(16) << node.nanoseconds_per_query
+              << std::setw(16) << flat.nanoseconds_per_query;
+    if (counter.IsAvailable()) {
+      std::cout << std::setprecision(2)
+                << std::setw(18) << node.misses_per_query
+                << std::setw(14) << flat.misses_per_query
+                << std::setprecision(1);
+    } else {
+      std::cout << std::setw(18) << "n/a" << std::setw(14) << "n/a";
+    }
+    std::cout << "\n";
+    if (node.checksums != flat.checksums) {
+      std::cerr << name << " gives different results\n";
+      same_results = false;
+    }
+  };
+
+  compare("GetLane",
+      Run(waypoints, counter, [&](const Waypoint &w) -> const Lane & { return NodeGetLane(data, w); }),
+      Run(waypoints, counter, [&](const Waypoint &w) -> const Lane & { return map->GetLane(w); }));
+  compare("GetSuccessors",
+      Run(waypoints, counter, [&](const Waypoint &w) { return NodeGetSuccessors(data, w); }),
+      Run(waypoints, counter, [&](const Waypoint &w) { return map->GetSuccessors(w); }));
+  compare("GetNext",
+      Run(waypoints, counter, [&](const Waypoint &w) { return NodeGetNext(data, w, next_distance); }),
+      Run(waypoints, counter, [&](const Waypoint &w) { return map->GetNext(w, next_distance); }));
+  compare("GetLaneWidth",
+      Run(waypoints, counter, [&](const Waypoint &w) { return NodeGetLaneWidth(data, w); }),
+      Run(waypoints, counter, [&](const Waypoint &w) { return map->GetLaneWidth(w); }));
+
+  return same_results ? 0 : 1;
+}
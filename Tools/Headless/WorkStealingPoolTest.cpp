@@ -0,0 +1,82 @@
+// Copyright (c) 2024 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+/// Checks that an exception thrown by an item of WorkStealingPool::ParallelFor
+/// on a worker thread reaches the calling thread, that the items not started
+/// yet are skipped, and that the pool still runs loops afterwards.
+///
+/// The items of the calling thread sleep, so the worker threads get to run
+/// theirs even on a single core.
+///
+/// Usage: work-stealing-pool-test
+
+#include "Carla/WorkStealingPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+  /// Runs a loop whose items throw when @a throws(worker) is true, and
+  /// returns the message of the exception that reached the caller, or an
+  /// empty string if none did. @a started counts the items that ran.
+  template <typename F>
+  std::string RunThrowingLoop(
+      carla::WorkStealingPool &pool,
+      F &&throws,
+      std::atomic<size_t> &started) {
+    try {
+      pool.ParallelFor(200u, [&](size_t, size_t worker) {
+        ++started;
+        if (throws(worker)) {
+          throw std::runtime_error("item failed on worker " + std::to_string(worker));
+        }
+        if (worker == 0u) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      });
+    } catch (const std::runtime_error &e) {
+      return e.what();
+    }
+    return {};
+  }
+
+} // namespace
+
+int main() {
+  carla::WorkStealingPool pool(4u);
+  bool ok = true;
+
+  std::atomic<size_t> started{0u};
+  const std::string on_worker = RunThrowingLoop(
+      pool, [](size_t worker) { return worker != 0u; }, started);
+  std::cout << "throw on a worker thread: " << (on_worker.empty() ? "not caught" : on_worker) << "\n";
+  ok &= on_worker.rfind("item failed on worker ", 0u) == 0u && on_worker != "item failed on worker 0";
+
+  // Each worker can start at most the item it was running when the first
+  // one threw
+  started = 0u;
+  const std::string every_item = RunThrowingLoop(
+      pool, [](size_t) { return true; }, started);
+  std::cout << "throw on every item: " << (every_item.empty() ? "not caught" : every_item)
+            << ", " << started.load() << " of 200 items started\n";
+  ok &= !every_item.empty() && started.load() <= pool.GetWorkerCount();
+
+  std::atomic<size_t> sum{0u};
+  pool.ParallelFor(1000u, [&](size_t item, size_t) { sum += item; });
+  std::cout << "loop after the exceptions: sum " << sum.load() << "\n";
+  ok &= sum.load() == 1000u * 999u / 2u;
+
+  if (!ok) {
+    std::cerr << "The exceptions of the items did not reach the caller\n";
+    return 1;
+  }
+  return 0;
+}